@@ -39,6 +39,7 @@ public class CPathfinding : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"Landscape",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
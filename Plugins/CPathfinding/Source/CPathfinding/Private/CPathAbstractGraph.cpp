@@ -0,0 +1,327 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathAbstractGraph.h"
+#include "CPathLeafGraph.h"
+#include "CPathVisitedTable.h"
+#include "CPathVolume.h"
+#include "Async/ParallelFor.h"
+#include <queue>
+#include <unordered_map>
+
+CPathAbstractGraph::CPathAbstractGraph()
+{
+}
+
+CPathAbstractGraph::~CPathAbstractGraph()
+{
+}
+
+void CPathAbstractGraph::Build(ACPathVolume* Volume, const CPathLeafGraph& LeafGraph, uint32 InClusterSize)
+{
+	checkf(LeafGraph.IsBuilt(), TEXT("CPATH - Abstract Graph:::Leaf graph must be built first"));
+
+	ClusterSize = FMath::Max(InClusterSize, (uint32)1);
+	for (int i = 0; i < 3; i++)
+	{
+		ClusterCount[i] = (Volume->NodeCount[i] + ClusterSize - 1) / ClusterSize;
+	}
+
+	uint32 OuterCount = Volume->GetOuterTreeCount();
+	ClusterByOuterIndex.resize(OuterCount);
+	for (uint32 OuterIndex = 0; OuterIndex < OuterCount; OuterIndex++)
+	{
+		// Padding of MortonOrder has no leafs, so it's never asked for its cluster
+		if (!Volume->IsOuterTreeInVolume(OuterIndex))
+		{
+			ClusterByOuterIndex[OuterIndex] = InvalidNode;
+			continue;
+		}
+
+		FVector XYZ = Volume->LocalCoordsInt3FromOuterIndex(OuterIndex);
+		uint32 X = (uint32)XYZ.X / ClusterSize;
+		uint32 Y = (uint32)XYZ.Y / ClusterSize;
+		uint32 Z = (uint32)XYZ.Z / ClusterSize;
+		ClusterByOuterIndex[OuterIndex] = X * ClusterCount[1] * ClusterCount[2] + Y * ClusterCount[2] + Z;
+	}
+
+	NodeByLeaf.clear();
+	NodeByLeaf.resize(OuterCount);
+	Clusters.clear();
+	Clusters.resize(ClusterCount[0] * ClusterCount[1] * ClusterCount[2]);
+
+	ParallelFor((int32)Clusters.size(), [this, Volume, &LeafGraph](int32 ClusterIndex)
+	{
+		BuildClusterNodes(Volume, LeafGraph, ClusterIndex);
+	});
+
+	ParallelFor((int32)Clusters.size(), [this, Volume, &LeafGraph](int32 ClusterIndex)
+	{
+		BuildClusterEdges(Volume, LeafGraph, ClusterIndex);
+	});
+
+	bIsBuilt = true;
+}
+
+void CPathAbstractGraph::Rebuild(ACPathVolume* Volume, const CPathLeafGraph& LeafGraph, const std::set<uint32>& OuterIndices)
+{
+	if (!bIsBuilt)
+		return;
+
+	std::set<uint32> ClustersToRebuild;
+	for (uint32 OuterIndex : OuterIndices)
+	{
+		ClustersToRebuild.insert(ClusterByOuterIndex[OuterIndex]);
+	}
+
+	// Edges of adjacent clusters point at node indexes of the rebuilt ones
+	std::set<uint32> ClustersToRelink;
+	for (uint32 ClusterIndex : ClustersToRebuild)
+	{
+		BuildClusterNodes(Volume, LeafGraph, ClusterIndex);
+		ClustersToRelink.insert(ClusterIndex);
+
+		uint32 Neighbours[6];
+		uint32 NeighbourCount = GetClusterNeighbours(ClusterIndex, Neighbours);
+		ClustersToRelink.insert(Neighbours, Neighbours + NeighbourCount);
+	}
+
+	for (uint32 ClusterIndex : ClustersToRelink)
+	{
+		BuildClusterEdges(Volume, LeafGraph, ClusterIndex);
+	}
+}
+
+void CPathAbstractGraph::Clear()
+{
+	bIsBuilt = false;
+	Clusters.clear();
+	Clusters.shrink_to_fit();
+	ClusterByOuterIndex.clear();
+	ClusterByOuterIndex.shrink_to_fit();
+	NodeByLeaf.clear();
+	NodeByLeaf.shrink_to_fit();
+}
+
+bool CPathAbstractGraph::FindCorridor(CPathLeafRef StartLeafRef, CPathLeafRef EndLeafRef, CPathVisitedTable& OutCorridor) const
+{
+	uint32 StartOuter = (uint32)(StartLeafRef >> CPathLeafGraph::LocalBits);
+	uint32 EndOuter = (uint32)(EndLeafRef >> CPathLeafGraph::LocalBits);
+	uint32 EndCluster = ClusterByOuterIndex[EndOuter];
+	uint32 EndNode = NodeByLeaf[EndOuter][EndLeafRef & CPathLeafGraph::LocalMask];
+	FVector EndCenter = Clusters[EndCluster].Nodes[EndNode].Center;
+
+	// Abstract nodes are identified by Cluster << 32 | Node
+	struct Record
+	{
+		float DistanceSoFar;
+		uint64 Previous;
+		bool bClosed;
+	};
+	std::unordered_map<uint64, Record> Records;
+	std::priority_queue<std::pair<float, uint64>, std::vector<std::pair<float, uint64>>, std::greater<std::pair<float, uint64>>> Queue;
+
+	uint64 StartKey = ((uint64)ClusterByOuterIndex[StartOuter] << 32) | NodeByLeaf[StartOuter][StartLeafRef & CPathLeafGraph::LocalMask];
+	uint64 EndKey = ((uint64)EndCluster << 32) | EndNode;
+	Records[StartKey] = { 0, StartKey, false };
+	Queue.push({ 0, StartKey });
+
+	bool bFound = false;
+	while (!Queue.empty())
+	{
+		uint64 CurrentKey = Queue.top().second;
+		Queue.pop();
+
+		Record& Current = Records[CurrentKey];
+		if (Current.bClosed)
+			continue;
+		Current.bClosed = true;
+
+		if (CurrentKey == EndKey)
+		{
+			bFound = true;
+			break;
+		}
+
+		float CurrentDistance = Current.DistanceSoFar;
+		for (const Edge& CurrEdge : Clusters[CurrentKey >> 32].Nodes[CurrentKey & 0xFFFFFFFF].Edges)
+		{
+			uint64 NeighbourKey = ((uint64)CurrEdge.Cluster << 32) | CurrEdge.Node;
+			float NewDistance = CurrentDistance + CurrEdge.Cost;
+
+			auto Found = Records.find(NeighbourKey);
+			if (Found == Records.end() || (!Found->second.bClosed && NewDistance < Found->second.DistanceSoFar))
+			{
+				Records[NeighbourKey] = { NewDistance, CurrentKey, false };
+				float Heuristic = (float)FVector::Distance(Clusters[CurrEdge.Cluster].Nodes[CurrEdge.Node].Center, EndCenter);
+				Queue.push({ NewDistance + Heuristic, NeighbourKey });
+			}
+		}
+	}
+
+	if (!bFound)
+		return false;
+
+	// Clusters next to the path are added as well, so that the leaf path can cut corners between clusters
+	uint64 CurrentKey = EndKey;
+	while (true)
+	{
+		uint32 ClusterIndex = (uint32)(CurrentKey >> 32);
+		OutCorridor.Add(ClusterIndex, 0);
+
+		uint32 Neighbours[6];
+		uint32 NeighbourCount = GetClusterNeighbours(ClusterIndex, Neighbours);
+		for (uint32 i = 0; i < NeighbourCount; i++)
+		{
+			OutCorridor.Add(Neighbours[i], 0);
+		}
+
+		if (CurrentKey == StartKey)
+			break;
+		CurrentKey = Records[CurrentKey].Previous;
+	}
+	return true;
+}
+
+void CPathAbstractGraph::GetOuterIndexes(ACPathVolume* Volume, uint32 ClusterIndex, std::vector<uint32>& OutIndexes) const
+{
+	OutIndexes.clear();
+
+	uint32 CX = ClusterIndex / (ClusterCount[1] * ClusterCount[2]);
+	uint32 CY = (ClusterIndex / ClusterCount[2]) % ClusterCount[1];
+	uint32 CZ = ClusterIndex % ClusterCount[2];
+
+	for (uint32 X = CX * ClusterSize; X < FMath::Min((CX + 1) * ClusterSize, Volume->NodeCount[0]); X++)
+	{
+		for (uint32 Y = CY * ClusterSize; Y < FMath::Min((CY + 1) * ClusterSize, Volume->NodeCount[1]); Y++)
+		{
+			for (uint32 Z = CZ * ClusterSize; Z < FMath::Min((CZ + 1) * ClusterSize, Volume->NodeCount[2]); Z++)
+			{
+				OutIndexes.push_back(Volume->LocalCoordsInt3ToIndex(FVector(X, Y, Z)));
+			}
+		}
+	}
+}
+
+uint32 CPathAbstractGraph::GetClusterNeighbours(uint32 ClusterIndex, uint32 OutNeighbours[6]) const
+{
+	uint32 CX = ClusterIndex / (ClusterCount[1] * ClusterCount[2]);
+	uint32 CY = (ClusterIndex / ClusterCount[2]) % ClusterCount[1];
+	uint32 CZ = ClusterIndex % ClusterCount[2];
+	uint32 StrideX = ClusterCount[1] * ClusterCount[2];
+	uint32 StrideY = ClusterCount[2];
+
+	uint32 Count = 0;
+	if (CX > 0)						OutNeighbours[Count++] = ClusterIndex - StrideX;
+	if (CX + 1 < ClusterCount[0])	OutNeighbours[Count++] = ClusterIndex + StrideX;
+	if (CY > 0)						OutNeighbours[Count++] = ClusterIndex - StrideY;
+	if (CY + 1 < ClusterCount[1])	OutNeighbours[Count++] = ClusterIndex + StrideY;
+	if (CZ > 0)						OutNeighbours[Count++] = ClusterIndex - 1;
+	if (CZ + 1 < ClusterCount[2])	OutNeighbours[Count++] = ClusterIndex + 1;
+	return Count;
+}
+
+void CPathAbstractGraph::BuildClusterNodes(ACPathVolume* Volume, const CPathLeafGraph& LeafGraph, uint32 ClusterIndex)
+{
+	std::vector<AbstractNode>& Nodes = Clusters[ClusterIndex].Nodes;
+	Nodes.clear();
+
+	std::vector<uint32> OuterIndexes;
+	GetOuterIndexes(Volume, ClusterIndex, OuterIndexes);
+	for (uint32 OuterIndex : OuterIndexes)
+	{
+		NodeByLeaf[OuterIndex].assign(LeafGraph.GetSliceLeafCount(OuterIndex), InvalidNode);
+	}
+
+	// Flood fill through leafs of this cluster, every fill is a new node
+	std::vector<CPathLeafRef> Stack;
+	for (uint32 OuterIndex : OuterIndexes)
+	{
+		for (uint32 LocalIndex = 0; LocalIndex < (uint32)NodeByLeaf[OuterIndex].size(); LocalIndex++)
+		{
+			if (NodeByLeaf[OuterIndex][LocalIndex] != InvalidNode)
+				continue;
+
+			uint32 NodeIndex = (uint32)Nodes.size();
+			FVector CenterSum = FVector(0, 0, 0);
+			uint32 LeafCount = 0;
+
+			NodeByLeaf[OuterIndex][LocalIndex] = NodeIndex;
+			Stack.push_back(CPathLeafGraph::MakeLeafRef(OuterIndex, LocalIndex));
+			while (Stack.size())
+			{
+				CPathLeafRef LeafRef = Stack.back();
+				Stack.pop_back();
+				CenterSum += LeafGraph.GetLeaf(LeafRef).Center;
+				LeafCount++;
+
+				const CPathLeafRef* Neighbours = LeafGraph.GetNeighbours(LeafRef);
+				for (uint32 i = 0; i < LeafGraph.GetLeaf(LeafRef).NeighbourCount; i++)
+				{
+					// Other clusters may be building at the same time, their NodeByLeaf can't be touched
+					uint32 NeighbourOuter = (uint32)(Neighbours[i] >> CPathLeafGraph::LocalBits);
+					if (ClusterByOuterIndex[NeighbourOuter] != ClusterIndex)
+						continue;
+
+					uint32& NeighbourNode = NodeByLeaf[NeighbourOuter][Neighbours[i] & CPathLeafGraph::LocalMask];
+					if (NeighbourNode == InvalidNode)
+					{
+						NeighbourNode = NodeIndex;
+						Stack.push_back(Neighbours[i]);
+					}
+				}
+			}
+
+			Nodes.emplace_back();
+			Nodes.back().Center = CenterSum / LeafCount;
+		}
+	}
+	Nodes.shrink_to_fit();
+}
+
+void CPathAbstractGraph::BuildClusterEdges(ACPathVolume* Volume, const CPathLeafGraph& LeafGraph, uint32 ClusterIndex)
+{
+	std::vector<AbstractNode>& Nodes = Clusters[ClusterIndex].Nodes;
+	for (AbstractNode& Node : Nodes)
+	{
+		Node.Edges.clear();
+	}
+
+	std::vector<uint32> OuterIndexes;
+	GetOuterIndexes(Volume, ClusterIndex, OuterIndexes);
+	for (uint32 OuterIndex : OuterIndexes)
+	{
+		for (uint32 LocalIndex = 0; LocalIndex < (uint32)NodeByLeaf[OuterIndex].size(); LocalIndex++)
+		{
+			CPathLeafRef LeafRef = CPathLeafGraph::MakeLeafRef(OuterIndex, LocalIndex);
+			AbstractNode& Node = Nodes[NodeByLeaf[OuterIndex][LocalIndex]];
+
+			const CPathLeafRef* Neighbours = LeafGraph.GetNeighbours(LeafRef);
+			for (uint32 i = 0; i < LeafGraph.GetLeaf(LeafRef).NeighbourCount; i++)
+			{
+				uint32 NeighbourOuter = (uint32)(Neighbours[i] >> CPathLeafGraph::LocalBits);
+				uint32 NeighbourCluster = ClusterByOuterIndex[NeighbourOuter];
+				if (NeighbourCluster == ClusterIndex)
+					continue;
+
+				uint32 NeighbourNode = NodeByLeaf[NeighbourOuter][Neighbours[i] & CPathLeafGraph::LocalMask];
+
+				// Many leafs share the same portal, there are only a few edges per node so linear search is fine
+				bool bAlreadyLinked = false;
+				for (const Edge& CurrEdge : Node.Edges)
+				{
+					if (CurrEdge.Cluster == NeighbourCluster && CurrEdge.Node == NeighbourNode)
+					{
+						bAlreadyLinked = true;
+						break;
+					}
+				}
+
+				if (!bAlreadyLinked)
+				{
+					float Cost = (float)FVector::Distance(Node.Center, Clusters[NeighbourCluster].Nodes[NeighbourNode].Center);
+					Node.Edges.push_back({ NeighbourCluster, NeighbourNode, Cost });
+				}
+			}
+		}
+	}
+}
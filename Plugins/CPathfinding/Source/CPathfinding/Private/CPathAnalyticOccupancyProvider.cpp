@@ -0,0 +1,37 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathAnalyticOccupancyProvider.h"
+
+bool UCPathAnalyticOccupancyProvider::IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const
+{
+	FBox Query(Center - Extent, Center + Extent);
+	// IsValid of boxes is ignored, it's easy to forget in the details panel
+	for (const FBox& Box : Boxes)
+	{
+		if (Box.Intersect(Query))
+			return false;
+	}
+
+	for (const FCPathAnalyticSphere& Sphere : Spheres)
+	{
+		if (Query.ComputeSquaredDistanceToPoint(Sphere.Center) < FMath::Square(Sphere.Radius))
+			return false;
+	}
+	return true;
+}
+
+uint32 UCPathAnalyticOccupancyProvider::GetBakeHash() const
+{
+	uint32 Hash = Super::GetBakeHash();
+	for (const FBox& Box : Boxes)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Box.Min));
+		Hash = HashCombine(Hash, GetTypeHash(Box.Max));
+	}
+	for (const FCPathAnalyticSphere& Sphere : Spheres)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Sphere.Center));
+		Hash = HashCombine(Hash, GetTypeHash(Sphere.Radius));
+	}
+	return Hash;
+}
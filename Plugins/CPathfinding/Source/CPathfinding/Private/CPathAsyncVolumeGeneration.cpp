@@ -3,37 +3,40 @@
 
 #include "CPathAsyncVolumeGeneration.h"
 #include "CPathVolume.h"
+#include "CPathGeneratorPool.h"
+#include "CPathOccupancyProvider.h"
 #include "GenericPlatform/GenericPlatformProcess.h"
-#include "Templates/Function.h"
 #include "Engine/World.h"
 #include <thread>
 
-FCPathAsyncVolumeGenerator::FCPathAsyncVolumeGenerator(ACPathVolume* Volume, uint32 StartIndex, uint32 EndIndex, uint8 ThreadID, FString ThreadName, bool Obstacles)
-	:
-	FCPathAsyncVolumeGenerator(Volume)
-{
-	bObstacles = Obstacles;
-	FirstIndex = StartIndex;
-	LastIndex = EndIndex;
-	GenThreadID = ThreadID;
-	Name = ThreadName;
-}
+static thread_local const FCPathAsyncVolumeGenerator* CurrentGenerator = nullptr;
 
-// Sets default values
-FCPathAsyncVolumeGenerator::FCPathAsyncVolumeGenerator(ACPathVolume* Volume)
-	:
-	WakeUpCondition([this]() { return WakeUpCondition(); })
+FCPathAsyncVolumeGenerator::FCPathAsyncVolumeGenerator(CPathGeneratorPool* Pool, uint8 ThreadID)
 {
-	VolumeRef = Volume;
-	
+	PoolRef = Pool;
+	GenThreadID = ThreadID;
+	Name = GetNameFromID(ThreadID);
+	if (PoolRef)
+	{
+		Semaphore = FGenericPlatformProcess::GetSynchEventFromPool();
+		ThreadRef = FRunnableThread::Create(this, *Name);
+	}
 }
 
 FCPathAsyncVolumeGenerator::~FCPathAsyncVolumeGenerator()
 {
 	RequestedKill.store(true);
+	if (Semaphore)
+		Semaphore->Trigger();
 	if (ThreadRef)
+	{
 		ThreadRef->Kill(true);
+		delete ThreadRef;
+	}
 	ThreadRef = nullptr;
+	if (Semaphore)
+		FGenericPlatformProcess::ReturnSynchEventToPool(Semaphore);
+	Semaphore = nullptr;
 }
 
 bool FCPathAsyncVolumeGenerator::Init()
@@ -43,45 +46,61 @@ bool FCPathAsyncVolumeGenerator::Init()
 
 uint32 FCPathAsyncVolumeGenerator::Run()
 {
-	bIncreasedGenRunning = true;
-	VolumeRef->GeneratorsRunning++;
+	while (!RequestedKill.load())
+	{
+		std::shared_ptr<CPathGenerationJob> Job = PoolRef->JoinJob();
+		if (!Job)
+		{
+			Semaphore->Wait();
+			continue;
+		}
+
+		WorkOnJob(*Job);
+		PoolRef->LeaveJob(Job);
+	}
+	return 0;
+}
+
+void FCPathAsyncVolumeGenerator::Stop()
+{
+	RequestedKill.store(true);
+	if (Semaphore)
+		Semaphore->Trigger();
+}
+
+void FCPathAsyncVolumeGenerator::Exit()
+{
+}
+
+void FCPathAsyncVolumeGenerator::WorkOnJob(CPathGenerationJob& Job)
+{
+	VolumeRef = Job.Volume;
+	RegeneratingObstacles = Job.bObstacles;
+	FMemory::Memzero(OctreeCountAtDepth, sizeof(OctreeCountAtDepth));
 
 	// Waiting for pathfinders to finish.
-	// Generators have priority over pathfinders, so we block further pathfinders from starting by incrementing GeneratorsRunning first	
-	while (!ShouldWakeUp())
+	// Generators have priority over pathfinders, GeneratorsRunning was incremented when the job was submitted, so no new ones start
+	while (!ShouldWakeUp(Job))
 		std::this_thread::sleep_for(std::chrono::milliseconds(5));
-	
-		
-	if(RequestedKill.load())
-		return 0;
 
 #ifdef LOG_GENERATORS
 	auto GenerationStart = TIMENOW;
 #endif
-	
-	if (LastIndex > 0)
+
+	// Padding of MortonOrder isn't in any brick, so it stays occupied
+	while (!Job.Cancelled.load() && !RequestedKill.load())
 	{
-		if (bObstacles)
-		{
-			auto StartIter = VolumeRef->TreesToRegenerate.begin();
-			for (uint32 i = 0; i < FirstIndex; i++)
-				StartIter++;
-
-			auto EndIter = StartIter;
-			for (uint32 i = FirstIndex; i < LastIndex; i++)
-				EndIter++;
-
-			for (auto Iter = StartIter; Iter != EndIter && !RequestedKill.load(); Iter++)
-			{
-				RefreshTree(*Iter);
-			}
-		}
-		else
+		uint32 First = Job.NextItem.fetch_add(Job.ChunkSize);
+		if (First >= Job.ItemCount)
+			break;
+
+		uint32 Last = FMath::Min(First + Job.ChunkSize, Job.ItemCount);
+		for (uint32 Item = First; Item < Last && !Job.Cancelled.load(); Item++)
 		{
-			for (uint32 OuterIndex = FirstIndex; OuterIndex < LastIndex && !RequestedKill.load(); OuterIndex++)
-			{
-				RefreshTree(OuterIndex);
-			}
+			if (Job.bObstacles)
+				RefreshTree(Job.OuterIndexes[Item]);
+			else
+				RefreshBrick(Item);
 		}
 	}
 
@@ -97,42 +116,77 @@ uint32 FCPathAsyncVolumeGenerator::Run()
 	UE_LOG(LogTemp, Warning, TEXT("%s generated %d nodes in %lfms"), *Name, NodeCount, GenerationTime);
 #endif
 
-	if (bIncreasedGenRunning)
-		VolumeRef->GeneratorsRunning--;
-	bIncreasedGenRunning = false;
-	return 0;
+	VolumeRef->OctreeAllocator.Flush(AllocatorCache);
+
+	for (int Depth = 0; Depth <= MAX_DEPTH; Depth++)
+		Job.OctreeCountAtDepth[Depth] += OctreeCountAtDepth[Depth];
 }
 
-void FCPathAsyncVolumeGenerator::Stop()
+const FCPathAsyncVolumeGenerator* FCPathAsyncVolumeGenerator::GetCurrent()
 {
-	RequestedKill.store(true);
-
-	// Preventing a potential deadlock if the process is somehow killed without waiting
-	if (bIncreasedGenRunning)
-		if(IsValid(VolumeRef))
-			VolumeRef->GeneratorsRunning--;
-
-	bIncreasedGenRunning = false;
+	return CurrentGenerator;
 }
 
-void FCPathAsyncVolumeGenerator::Exit()
+void FCPathAsyncVolumeGenerator::WakeUp()
 {
-	ThreadExited.store(true);
+	if (Semaphore)
+		Semaphore->Trigger();
 }
 
-bool FCPathAsyncVolumeGenerator::HasFinishedWorking()
+void FCPathAsyncVolumeGenerator::RefreshTree(uint32 OuterIndex)
 {
-	return ThreadExited.load();
+	// Trees of a homogeneous brick are shared, the brick needs its own before anything is written
+	uint64 OuterSlot = VolumeRef->GetOuterSlot(OuterIndex);
+	VolumeRef->MaterializeBrick(CPathBrickMap::GetBrickIndex(OuterSlot));
+	CPathOctree* OctreeRef = VolumeRef->BrickMap.GetTree(OuterSlot);
+
+	// Blocks of a deduplicated tree can be shared with other trees
+	VolumeRef->OctreeDAG.MakePrivate(VolumeRef, OuterIndex, AllocatorCache);
+	FVector Location = VolumeRef->WorldLocationFromTreeID(OuterIndex);
+
+	// Providers that answer a whole tree at once do it here, RecheckOctreeAtDepth then only looks it up
+	const UCPathOccupancyProvider* Provider = VolumeRef->OccupancyProvider;
+	if (Provider)
+	{
+		Batch.Init(VolumeRef, Location);
+		if (Provider->FillOuterTree(VolumeRef, Batch))
+			CurrentBatch = &Batch;
+	}
+
+	// One query for everything the tree's subtrees can touch, RecheckOctreeAtDepth then tests just that
+	if (VolumeRef->GeometryCulledGeneration && VolumeRef->UsesPhysicsOccupancy(RegeneratingObstacles))
+	{
+		Gather.Collect(VolumeRef, Location);
+		CurrentGather = &Gather;
+	}
+
+	CurrentGenerator = this;
+	RefreshTreeRec(OctreeRef, OuterSlot, OuterIndex, 0, Location);
+	CurrentGenerator = nullptr;
+	CurrentGather = nullptr;
+	CurrentBatch = nullptr;
 }
 
-void FCPathAsyncVolumeGenerator::RefreshTree(uint32 OuterIndex)
+void FCPathAsyncVolumeGenerator::RefreshBrick(uint32 BrickIndex)
 {
-	CPathOctree* OctreeRef = &VolumeRef->Octrees[OuterIndex];
-	if (!OctreeRef)
+	uint32 OuterIndexes[CPathBrickMap::TreesPerBrick];
+	uint32 InVolumeCount = VolumeRef->GetBrickOuterIndexes(BrickIndex, OuterIndexes);
+
+	// One overlap test instead of one per tree, most bricks of a mostly empty volume end here
+	FVector Center, Extent;
+	VolumeRef->GetBrickBounds(BrickIndex, Center, Extent);
+	if (VolumeRef->IsBrickEmpty(Center, Extent))
 	{
+		VolumeRef->BrickMap.SetHomogeneous(BrickIndex, true);
+		OctreeCountAtDepth[0] += InVolumeCount;
 		return;
 	}
-	RefreshTreeRec(OctreeRef, 0, VolumeRef->WorldLocationFromTreeID(OuterIndex));
+
+	for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick && !RequestedKill.load(); LocalIndex++)
+	{
+		if (OuterIndexes[LocalIndex] != ACPathVolume::InvalidOuterIndex)
+			RefreshTree(OuterIndexes[LocalIndex]);
+	}
 }
 
 FString FCPathAsyncVolumeGenerator::GetNameFromID(uint8 ID)
@@ -140,17 +194,23 @@ FString FCPathAsyncVolumeGenerator::GetNameFromID(uint8 ID)
 	return FString::Printf(TEXT("GeneratorThread %d"), (int)ID);
 }
 
-bool FCPathAsyncVolumeGenerator::RefreshTreeRec(CPathOctree* OctreeRef, uint32 Depth, FVector TreeLocation)
+bool FCPathAsyncVolumeGenerator::RefreshTreeRec(CPathOctree* OctreeRef, uint64 OuterSlot, CPathTreeID TreeID, uint32 Depth, FVector TreeLocation)
 {
-
-	bool IsFree = VolumeRef->RecheckOctreeAtDepth(OctreeRef, TreeLocation, Depth);
+	// Outer trees are split between workers of the job, so nobody else writes to this tree's occupancy
+	uint32 UserData = VolumeRef->Occupancy.GetData(OuterSlot, TreeID);
+	bool IsFree = VolumeRef->RecheckOctreeAtDepth(UserData, TreeLocation, Depth);
+	VolumeRef->Occupancy.SetIsFree(OuterSlot, TreeID, IsFree);
+	VolumeRef->Occupancy.SetUserData(OuterSlot, TreeID, UserData);
 
 	OctreeCountAtDepth[Depth]++;
 
 	if (IsFree)
 	{
-		delete[] OctreeRef->Children;
-		OctreeRef->Children = nullptr;
+		if (OctreeRef->Children)
+		{
+			VolumeRef->OctreeAllocator.Free(OctreeRef->Children, AllocatorCache);
+			OctreeRef->Children = nullptr;
+		}
 		return true;
 	}
 	else if (++Depth <= (uint32)VolumeRef->OctreeDepth)
@@ -158,13 +218,15 @@ bool FCPathAsyncVolumeGenerator::RefreshTreeRec(CPathOctree* OctreeRef, uint32 D
 		float HalfSize = VolumeRef->GetVoxelSizeByDepth(Depth) / 2.f;
 
 		if (!OctreeRef->Children)
-			OctreeRef->Children = new CPathOctree[8];
+			OctreeRef->Children = VolumeRef->OctreeAllocator.Allocate(AllocatorCache);
 		uint8 FreeChildren = 0;
 		// Checking children
 		for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
 		{
 			FVector Location = TreeLocation + VolumeRef->LookupTable_ChildPositionOffsetMaskByIndex[ChildIndex] * HalfSize;
-			FreeChildren += RefreshTreeRec(&OctreeRef->Children[ChildIndex], Depth, Location);
+			CPathTreeID ChildID = TreeID;
+			VolumeRef->ReplaceChildIndexAndDepth(ChildID, Depth, ChildIndex);
+			FreeChildren += RefreshTreeRec(&OctreeRef->Children[ChildIndex], OuterSlot, ChildID, Depth, Location);
 		}
 
 		if (FreeChildren)
@@ -173,7 +235,7 @@ bool FCPathAsyncVolumeGenerator::RefreshTreeRec(CPathOctree* OctreeRef, uint32 D
 		}
 		else
 		{
-			delete[] OctreeRef->Children;
+			VolumeRef->OctreeAllocator.Free(OctreeRef->Children, AllocatorCache);
 			OctreeRef->Children = nullptr;
 			return false;
 		}
@@ -182,9 +244,9 @@ bool FCPathAsyncVolumeGenerator::RefreshTreeRec(CPathOctree* OctreeRef, uint32 D
 	return false;
 }
 
-bool FCPathAsyncVolumeGenerator::ShouldWakeUp()
+bool FCPathAsyncVolumeGenerator::ShouldWakeUp(const CPathGenerationJob& Job)
 {
-	return VolumeRef->PathfindersRunning.load() == 0 || RequestedKill.load();
+	return VolumeRef->PathfindersRunning.load() == 0 || Job.Cancelled.load() || RequestedKill.load();
 }
 
 
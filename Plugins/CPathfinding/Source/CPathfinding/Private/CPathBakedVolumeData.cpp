@@ -0,0 +1,25 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathBakedVolumeData.h"
+
+UCPathBakedVolumeData::UCPathBakedVolumeData()
+{
+}
+
+void UCPathBakedVolumeData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+	OctreeData.Serialize(Ar, this);
+}
+
+void UCPathBakedVolumeData::SetOctreeData(const TArray<uint8>& Bytes)
+{
+	// Not inline, so that loading the level doesn't read the octree until the volume asks for it
+	OctreeData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+	OctreeData.Lock(LOCK_READ_WRITE);
+	void* Dest = OctreeData.Realloc(Bytes.Num());
+	FMemory::Memcpy(Dest, Bytes.GetData(), Bytes.Num());
+	OctreeData.Unlock();
+
+	BakedBytes = Bytes.Num();
+}
@@ -0,0 +1,81 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathBrickMap.h"
+
+CPathBrickMap::CPathBrickMap()
+{
+}
+
+CPathBrickMap::~CPathBrickMap()
+{
+}
+
+void CPathBrickMap::Init(const uint32 InNodeCount[3])
+{
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		NodeCount[Axis] = InNodeCount[Axis];
+		BrickCount[Axis] = (NodeCount[Axis] + BrickSize - 1) / BrickSize;
+	}
+
+	States.assign(GetBrickCount() + 1, EBrickState::Blocked);
+	Trees.clear();
+	Trees.resize(GetBrickCount() + 1);
+}
+
+void CPathBrickMap::Clear()
+{
+	States.clear();
+	States.shrink_to_fit();
+	Trees.clear();
+	Trees.shrink_to_fit();
+}
+
+void CPathBrickMap::GetBrickRange(uint32 BrickIndex, uint32 OutFirst[3], uint32 OutEnd[3]) const
+{
+	uint32 BrickCoords[3];
+	BrickCoords[2] = BrickIndex % BrickCount[2];
+	BrickIndex /= BrickCount[2];
+	BrickCoords[1] = BrickIndex % BrickCount[1];
+	BrickCoords[0] = BrickIndex / BrickCount[1];
+
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		OutFirst[Axis] = BrickCoords[Axis] * BrickSize;
+		OutEnd[Axis] = FMath::Min(OutFirst[Axis] + BrickSize, NodeCount[Axis]);
+	}
+}
+
+void CPathBrickMap::Materialize(uint32 BrickIndex)
+{
+	checkf(BrickIndex < GetBrickCount(), TEXT("CPATH - Brick Map:::Trees outside of the volume can't be materialized"));
+
+	if (States[BrickIndex] == EBrickState::Mixed)
+		return;
+
+	Trees[BrickIndex] = std::make_unique<CPathOctree[]>(TreesPerBrick);
+	States[BrickIndex] = EBrickState::Mixed;
+}
+
+void CPathBrickMap::SetHomogeneous(uint32 BrickIndex, bool IsFree)
+{
+	Trees[BrickIndex].reset();
+	States[BrickIndex] = IsFree ? EBrickState::Free : EBrickState::Blocked;
+}
+
+uint32 CPathBrickMap::GetMixedBrickCount() const
+{
+	uint32 Count = 0;
+	for (const std::unique_ptr<CPathOctree[]>& BrickTrees : Trees)
+	{
+		if (BrickTrees)
+			Count++;
+	}
+	return Count;
+}
+
+int64 CPathBrickMap::GetAllocatedBytes() const
+{
+	return (int64)States.size() * (sizeof(EBrickState) + sizeof(std::unique_ptr<CPathOctree[]>))
+		+ (int64)GetMixedBrickCount() * TreesPerBrick * sizeof(CPathOctree);
+}
@@ -0,0 +1,118 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathCache.h"
+#include "CPathDefines.h"
+#include "Misc/ScopeLock.h"
+#include <algorithm>
+
+CPathCache::CPathCache()
+{
+}
+
+CPathCache::~CPathCache()
+{
+}
+
+void CPathCache::SetCapacity(uint32 InCapacity)
+{
+	FScopeLock Lock(&Mutex);
+	Capacity.store(InCapacity);
+	while (Entries.size() > InCapacity)
+	{
+		EntriesByKey.erase(Entries.back().EntryKey);
+		Entries.pop_back();
+	}
+}
+
+bool CPathCache::Find(CPathTreeID StartLeaf, CPathTreeID EndLeaf, int32 UserData, float AgentRadius, bool AnyAngle, std::vector<CPathCachedNode>& OutNodes)
+{
+	FScopeLock Lock(&Mutex);
+	auto Found = EntriesByKey.find({ StartLeaf, EndLeaf, UserData, AgentRadius, AnyAngle });
+	if (Found == EntriesByKey.end())
+		return false;
+
+	// Moving to the front, iterators stay valid
+	Entries.splice(Entries.begin(), Entries, Found->second);
+	OutNodes = Found->second->Nodes;
+	return true;
+}
+
+void CPathCache::Add(CPathTreeID StartLeaf, CPathTreeID EndLeaf, int32 UserData, float AgentRadius, bool AnyAngle, std::vector<CPathCachedNode>&& Nodes, uint32 InRegeneration)
+{
+	FScopeLock Lock(&Mutex);
+	if (Capacity.load() == 0 || InRegeneration != Regeneration)
+		return;
+
+	Key NewKey = { StartLeaf, EndLeaf, UserData, AgentRadius, AnyAngle };
+	auto Found = EntriesByKey.find(NewKey);
+	if (Found != EntriesByKey.end())
+	{
+		Entries.erase(Found->second);
+		EntriesByKey.erase(Found);
+	}
+
+	Entries.emplace_front();
+	Entry& NewEntry = Entries.front();
+	NewEntry.EntryKey = NewKey;
+	NewEntry.Nodes = std::move(Nodes);
+	for (const CPathCachedNode& Node : NewEntry.Nodes)
+	{
+		NewEntry.OuterIndices.push_back((uint32)(Node.TreeID & DEPTH_0_MASK));
+	}
+	std::sort(NewEntry.OuterIndices.begin(), NewEntry.OuterIndices.end());
+	NewEntry.OuterIndices.erase(std::unique(NewEntry.OuterIndices.begin(), NewEntry.OuterIndices.end()), NewEntry.OuterIndices.end());
+	EntriesByKey[NewKey] = Entries.begin();
+
+	if (Entries.size() > Capacity.load())
+	{
+		EntriesByKey.erase(Entries.back().EntryKey);
+		Entries.pop_back();
+	}
+}
+
+void CPathCache::Invalidate(const std::set<uint32>& OuterIndices, uint32 NewRegeneration)
+{
+	FScopeLock Lock(&Mutex);
+	Regeneration = NewRegeneration;
+
+	// Both are sorted, so checking for a common index is linear
+	for (auto Iter = Entries.begin(); Iter != Entries.end();)
+	{
+		auto PathIter = Iter->OuterIndices.begin();
+		auto RegenIter = OuterIndices.begin();
+		bool bAffected = false;
+		while (PathIter != Iter->OuterIndices.end() && RegenIter != OuterIndices.end())
+		{
+			if (*PathIter < *RegenIter)
+				PathIter++;
+			else if (*RegenIter < *PathIter)
+				RegenIter++;
+			else
+			{
+				bAffected = true;
+				break;
+			}
+		}
+
+		if (bAffected)
+		{
+			EntriesByKey.erase(Iter->EntryKey);
+			Iter = Entries.erase(Iter);
+		}
+		else
+			Iter++;
+	}
+}
+
+void CPathCache::Clear()
+{
+	FScopeLock Lock(&Mutex);
+	Entries.clear();
+	EntriesByKey.clear();
+}
+
+uint32 CPathCache::Num()
+{
+	FScopeLock Lock(&Mutex);
+	return (uint32)Entries.size();
+}
@@ -0,0 +1,211 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathClosestFreeLeafTable.h"
+#include "CPathVolume.h"
+#include "CPathOctree.h"
+#include "CPathVisitedTable.h"
+#include "Async/ParallelFor.h"
+#include <algorithm>
+#include <queue>
+
+CPathClosestFreeLeafTable::CPathClosestFreeLeafTable()
+{
+}
+
+CPathClosestFreeLeafTable::~CPathClosestFreeLeafTable()
+{
+}
+
+void CPathClosestFreeLeafTable::Build(ACPathVolume* Volume)
+{
+	uint32 OuterCount = Volume->GetOuterTreeCount();
+	Slices.clear();
+	Slices.resize(OuterCount);
+
+	ParallelFor((int32)OuterCount, [this, Volume](int32 OuterIndex)
+	{
+		CPathVisitedTable Visited(256);
+		BuildSlice(Volume, OuterIndex, Visited);
+	});
+
+	bIsBuilt = true;
+}
+
+void CPathClosestFreeLeafTable::Rebuild(ACPathVolume* Volume, const std::set<uint32>& OuterIndices)
+{
+	if (!bIsBuilt)
+		return;
+
+	// Occupied leafs of adjacent trees may have had their closest free leaf in the regenerated ones, or may have a closer one now
+	std::set<uint32> SlicesToRebuild;
+	for (uint32 OuterIndex : OuterIndices)
+	{
+		SlicesToRebuild.insert(OuterIndex);
+		for (int Direction = 0; Direction < 6; Direction++)
+		{
+			uint32 NeighbourIndex;
+			if (Volume->FindOuterNeighbourIndex(OuterIndex, (ENeighbourDirection)Direction, NeighbourIndex))
+			{
+				SlicesToRebuild.insert(NeighbourIndex);
+			}
+		}
+	}
+
+	CPathVisitedTable Visited(256);
+	for (uint32 OuterIndex : SlicesToRebuild)
+	{
+		BuildSlice(Volume, OuterIndex, Visited);
+	}
+}
+
+void CPathClosestFreeLeafTable::Clear()
+{
+	bIsBuilt = false;
+	Slices.clear();
+	Slices.shrink_to_fit();
+}
+
+bool CPathClosestFreeLeafTable::Find(CPathTreeID TreeID, CPathTreeID& OutFreeTreeID, float& OutDistance) const
+{
+	uint32 OuterIndex = (uint32)(TreeID & DEPTH_0_MASK);
+	if (OuterIndex >= Slices.size())
+		return false;
+
+	const std::vector<Entry>& Entries = Slices[OuterIndex].Entries;
+	auto Found = std::lower_bound(Entries.begin(), Entries.end(), TreeID,
+		[](const Entry& CurrEntry, CPathTreeID ID) { return CurrEntry.TreeID < ID; });
+
+	if (Found == Entries.end() || Found->TreeID != TreeID)
+		return false;
+
+	OutFreeTreeID = Found->FreeTreeID;
+	OutDistance = Found->Distance;
+	return true;
+}
+
+// Adds all occupied leafs under Tree to Leafs
+static void CollectOccupiedLeafs(ACPathVolume* Volume, CPathOctree* Tree, CPathTreeID TreeID, uint32 Depth, std::vector<CPathTreeID>& Leafs)
+{
+	if (Tree->Children)
+	{
+		Depth++;
+		for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+		{
+			CPathTreeID ChildID = TreeID;
+			Volume->ReplaceChildIndexAndDepth(ChildID, Depth, ChildIndex);
+			CollectOccupiedLeafs(Volume, &Tree->Children[ChildIndex], ChildID, Depth, Leafs);
+		}
+	}
+	else if (!Volume->IsTreeFree(TreeID))
+	{
+		Leafs.push_back(TreeID);
+	}
+}
+
+void CPathClosestFreeLeafTable::BuildSlice(ACPathVolume* Volume, uint32 OuterIndex, CPathVisitedTable& Visited)
+{
+	Slice& CurrSlice = Slices[OuterIndex];
+	CurrSlice.Entries.clear();
+	if (!Volume->IsOuterTreeInVolume(OuterIndex))
+		return;
+
+	std::vector<CPathTreeID> OccupiedLeafs;
+	CollectOccupiedLeafs(Volume, Volume->GetOuterTree(OuterIndex), OuterIndex, 0, OccupiedLeafs);
+	if (OccupiedLeafs.empty())
+	{
+		CurrSlice.Entries.shrink_to_fit();
+		return;
+	}
+	uint32 CenterLeafCount = (uint32)OccupiedLeafs.size();
+
+	uint32 Region[7] = { OuterIndex };
+	uint32 RegionSize = 1;
+	for (int Direction = 0; Direction < 6; Direction++)
+	{
+		uint32 NeighbourIndex;
+		if (Volume->FindOuterNeighbourIndex(OuterIndex, (ENeighbourDirection)Direction, NeighbourIndex))
+		{
+			Region[RegionSize++] = NeighbourIndex;
+			CollectOccupiedLeafs(Volume, Volume->GetOuterTree(NeighbourIndex), NeighbourIndex, 0, OccupiedLeafs);
+		}
+	}
+	auto IsInRegion = [&Region, RegionSize](CPathTreeID TreeID)
+	{
+		uint32 TreeOuter = (uint32)(TreeID & DEPTH_0_MASK);
+		for (uint32 i = 0; i < RegionSize; i++)
+		{
+			if (Region[i] == TreeOuter)
+				return true;
+		}
+		return false;
+	};
+
+	struct QueueEntry
+	{
+		float Distance;
+		CPathTreeID TreeID;
+		CPathTreeID FreeTreeID;
+
+		bool operator>(const QueueEntry& Other) const
+		{
+			return Distance > Other.Distance;
+		}
+	};
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> Pq;
+
+	// Distance from the center of an occupied leaf to the border of a free one, same as in FindClosestFreeLeaf
+	auto CalcDistance = [Volume](CPathTreeID OccupiedID, CPathTreeID FreeID)
+	{
+		return (float)FVector::Distance(Volume->WorldLocationFromTreeID(OccupiedID), Volume->WorldLocationFromTreeID(FreeID))
+			- Volume->GetVoxelSizeByDepth(Volume->ExtractDepth(FreeID)) / 2.f;
+	};
+
+	// Seeding with free leafs adjacent to occupied ones
+	std::vector<CPathTreeID> Neighbours;
+	for (CPathTreeID TreeID : OccupiedLeafs)
+	{
+		Volume->FindNeighbourLeafs(TreeID, Neighbours, true);
+		for (CPathTreeID NeighbourID : Neighbours)
+		{
+			if (IsInRegion(NeighbourID))
+			{
+				Pq.push({ CalcDistance(TreeID, NeighbourID), TreeID, NeighbourID });
+			}
+		}
+	}
+
+	// Visited marks occupied leafs that already have their closest free leaf
+	Visited.Reset();
+	while (Pq.size() > 0)
+	{
+		QueueEntry Current = Pq.top();
+		Pq.pop();
+		if (!Visited.Add(Current.TreeID, 0))
+			continue;
+
+		if ((Current.TreeID & DEPTH_0_MASK) == OuterIndex)
+		{
+			CurrSlice.Entries.push_back({ Current.TreeID, Current.FreeTreeID, Current.Distance });
+
+			// Nothing else to do once every occupied leaf of this tree has its free leaf
+			if (CurrSlice.Entries.size() == CenterLeafCount)
+				break;
+		}
+
+		Volume->FindNeighbourLeafs(Current.TreeID, Neighbours, false);
+		for (CPathTreeID NeighbourID : Neighbours)
+		{
+			if (!IsInRegion(NeighbourID) || Visited.Contains(NeighbourID))
+				continue;
+
+			if (!Volume->IsTreeFree(NeighbourID))
+			{
+				Pq.push({ CalcDistance(NeighbourID, Current.FreeTreeID), NeighbourID, Current.FreeTreeID });
+			}
+		}
+	}
+
+	std::sort(CurrSlice.Entries.begin(), CurrSlice.Entries.end(),
+		[](const Entry& A, const Entry& B) { return A.TreeID < B.TreeID; });
+	CurrSlice.Entries.shrink_to_fit();
+}
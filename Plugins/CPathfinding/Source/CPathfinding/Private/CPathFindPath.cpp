@@ -4,11 +4,9 @@
 #include "CPathVolume.h"
 #include "Engine/HitResult.h"
 #include <thread>
-#include <queue>
-#include <deque>
 #include <vector>
-#include <unordered_set>
 #include <memory>
+#include <algorithm>
 #include "Algo/Reverse.h"
 #include "TimerManager.h"
 #include "Engine/World.h"
@@ -49,6 +47,29 @@ void CPathAStar::DeleteInstance(UWorld* World)
 }
 
 ECPathfindingFailReason CPathAStar::FindPath(ACPathVolume* VolumeRef, FCPathResult* Result, FVector Start, FVector End, uint32 SmoothingPasses, int32 UserData, float TimeLimit, bool RequestRawPath, bool RequestUserPath)
+{
+	FCPathRequest Request;
+	Request.VolumeRef = VolumeRef;
+	Request.Start = Start;
+	Request.End = End;
+	Request.SmoothingPasses = SmoothingPasses;
+	Request.UserData = UserData;
+	Request.TimeLimit = TimeLimit;
+	Request.RequestRawPath = RequestRawPath;
+	Request.RequestUserPath = RequestUserPath;
+	return FindPath(Request, Result);
+}
+
+ECPathfindingFailReason CPathAStar::FindPath(const FCPathRequest& Request, FCPathResult* Result)
+{
+	DefaultContext.Reset(Request);
+
+	// One slice as long as the whole budget
+	FindPathSliced(DefaultContext, Result, Request.TimeLimit);
+	return Result->FailReason;
+}
+
+bool CPathAStar::FindPathSliced(CPathSearchContext& Context, FCPathResult* Result, float SliceTimeLimit)
 {
 	bStop = false;
 
@@ -56,164 +77,414 @@ ECPathfindingFailReason CPathAStar::FindPath(ACPathVolume* VolumeRef, FCPathResu
 	checkf(Result != nullptr, TEXT("CPATH - FindPath:::The result struct was nullptr"));
 #endif
 
+	ACPathVolume* VolumeRef = Context.Request.VolumeRef;
 	if (!IsValid(VolumeRef))
 	{
 		Result->FailReason = ECPathfindingFailReason::VolumeNotValid;
-		return ECPathfindingFailReason::VolumeNotValid;
-		
+		return true;
 	}
 	if (!VolumeRef->InitialGenerationCompleteAtom.load())
 	{
 		Result->FailReason = ECPathfindingFailReason::VolumeNotGenerated;
-		return ECPathfindingFailReason::VolumeNotGenerated;
+		return true;
 	}
 
 	auto TimeStart = TIMENOW;
+	double SearchedBefore = Context.SearchedTime;
 
-	// time limit in miliseconds
-	double TimeLimitMS = TimeLimit * 1000;
+	// time limits in miliseconds
+	double TimeLimitMS = Context.Request.TimeLimit * 1000;
+	double SliceLimitMS = FMath::Min((double)SliceTimeLimit * 1000, TimeLimitMS - Context.SearchedTime);
 
 	CurrentVolumeRef = VolumeRef;
+	CurrentMinClearance = Context.Request.AgentRadius > VolumeRef->AgentRadius && VolumeRef->LeafGraph.IsBuilt() ? Context.Request.AgentRadius : 0;
+
+	// Clearance is capped at the size of an outer tree, bigger agents are treated as if they had that radius
+	CurrentMinClearance = FMath::Min(CurrentMinClearance, VolumeRef->GetVoxelSizeByDepth(0));
+
+	// Octree could have changed since the last slice, so nodes in the context may not exist anymore
+	if (Context.bStarted && Context.VolumeRegeneration != VolumeRef->RegenerationCount.load())
+	{
+		Context.bStarted = false;
+		Context.RestartCount++;
+	}
+
+	if (!Context.bStarted)
+	{
+		if (BeginSearch(Context, Result) != ECPathfindingFailReason::None)
+		{
+			Context.SearchedTime = SearchedBefore + TIMEDIFF(TimeStart, TIMENOW);
+			Result->SearchDuration = Context.SearchedTime;
+			return true;
+		}
+	}
+	TargetLocation = Context.Forward.TargetLocation;
+
+	const bool bBidirectional = Context.Request.Bidirectional;
+	CPathAStarNode* FoundPathEnd = Context.CachedPathEnd;
+	bool bSliceEnded = false;
+
+	// A* loop
+	while (!bStop && !FoundPathEnd)
+	{
+		// In bidirectional search, the side with less open nodes goes next.
+		// If that side runs out of nodes, the other one can't reach it either.
+		CPathSearchFrontier* Frontier = &Context.Forward;
+		if (bBidirectional && Context.Backward.OpenList.Num() < Context.Forward.OpenList.Num())
+			Frontier = &Context.Backward;
+
+		if (Frontier->OpenList.IsEmpty())
+			break;
+
+		if (!bBidirectional)
+		{
+			FoundPathEnd = ExpandFrontier(Context, Context.Forward, nullptr);
+			if (FoundPathEnd)
+				break;
+		}
+		else
+		{
+			CPathSearchFrontier* Other = Frontier == &Context.Forward ? &Context.Backward : &Context.Forward;
+			CPathAStarNode* MeetingNode = ExpandFrontier(Context, *Frontier, Other);
+			if (MeetingNode)
+			{
+				CPathAStarNode* OtherNode = &Other->NodeArena[Other->VisitedNodes.Find(MeetingNode->TreeID)];
+				if (Frontier == &Context.Forward)
+					FoundPathEnd = JoinPaths(MeetingNode, OtherNode);
+				else
+					FoundPathEnd = JoinPaths(OtherNode, MeetingNode);
+				break;
+			}
+		}
+
+		if (TIMEDIFF(TimeStart, TIMENOW) >= SliceLimitMS)
+		{
+			bSliceEnded = true;
+			break;
+		}
+	}
+
+	Context.SearchedTime = SearchedBefore + TIMEDIFF(TimeStart, TIMENOW);
+	Result->SearchDuration = Context.SearchedTime;
+
+	// Pathfinidng has been interrupted due to premature thread kill
+	if (bStop)
+	{
+		Result->FailReason = ECPathfindingFailReason::Unknown;
+		return true;
+	}
+
+	if (bSliceEnded && !FoundPathEnd)
+	{
+		if (Context.SearchedTime >= TimeLimitMS)
+		{
+			Result->FailReason = ECPathfindingFailReason::Timeout;
+			return true;
+		}
+		// Open list is kept as is, next slice continues from here
+		return false;
+	}
+
+	if (!FoundPathEnd)
+	{
+		Result->FailReason = ECPathfindingFailReason::EndLocationUnreachable;
+		return true;
+	}
+
+	if (!Context.CachedPathEnd)
+	{
+		AddToCache(Context, FoundPathEnd);
+	}
+	FinishSearch(Context, Result, FoundPathEnd);
 
-	// The A* priority queue
-	std::priority_queue<CPathAStarNode, std::deque<CPathAStarNode>, std::greater<CPathAStarNode>> Pq;
+	Context.SearchedTime = SearchedBefore + TIMEDIFF(TimeStart, TIMENOW);
+	Result->SearchDuration = Context.SearchedTime;
 
-	// Nodes visited OR added to priority queue
-	std::unordered_set<CPathAStarNode, CPathAStarNode::Hash> VisitedNodes;
+#ifdef LOG_PATHFINDERS
+	UE_LOG(LogTemp, Warning, TEXT("FindPath:  time= %lfms  NodesVisited= %d  NodesProcessed= %d  Restarts= %d"), Context.SearchedTime,
+		Context.Forward.VisitedNodes.Num() + Context.Backward.VisitedNodes.Num(), Context.Forward.NodeArena.Num() + Context.Backward.NodeArena.Num(), Context.RestartCount);
+#endif
+	return true;
+}
 
-	// Nodes that were consumed from priority queue
-	std::vector<std::unique_ptr<CPathAStarNode>> ProcessedNodes;
+ECPathfindingFailReason CPathAStar::BeginSearch(CPathSearchContext& Context, FCPathResult* Result)
+{
+	ACPathVolume* VolumeRef = Context.Request.VolumeRef;
+
+	Context.Forward.Reset();
+	Context.Backward.Reset();
+	Context.VolumeRegeneration = VolumeRef->RegenerationCount.load();
 
 	// Finding start and end node
-	uint32 TempID;
-	if (!VolumeRef->FindClosestFreeLeaf(Start, TempID))
+	CPathTreeID TempID;
+	if (!VolumeRef->FindClosestFreeLeaf(Context.Request.Start, TempID, -1, &ClosestLeafVisited))
 	{
 		Result->FailReason = ECPathfindingFailReason::WrongStartLocation;
 		return ECPathfindingFailReason::WrongStartLocation;
 	}
 
 	CPathAStarNode StartNode(TempID);
-	StartNode.WorldLocation = Start;
+	StartNode.WorldLocation = Context.Request.Start;
 
-	if (!VolumeRef->FindClosestFreeLeaf(End, TempID))
+	if (!VolumeRef->FindClosestFreeLeaf(Context.Request.End, TempID, -1, &ClosestLeafVisited))
 	{
 		Result->FailReason = ECPathfindingFailReason::WrongEndLocation;
 		return ECPathfindingFailReason::WrongEndLocation;
 	}
 
-	// Initializing priority queue
-	CPathAStarNode TargetNode(TempID);
-	TargetLocation = VolumeRef->WorldLocationFromTreeID(TargetNode.TreeID);
-	TargetNode.WorldLocation = TargetLocation;
-	CalcFitness(TargetNode);
-	CalcFitness(StartNode);
-	Pq.push(StartNode);
-	VisitedNodes.insert(StartNode);
-	CPathAStarNode* FoundPathEnd = nullptr;
+	Context.TargetNode = CPathAStarNode(TempID);
+	TargetLocation = VolumeRef->WorldLocationFromTreeID(Context.TargetNode.TreeID);
+	Context.Forward.TargetLocation = TargetLocation;
+	Context.TargetNode.WorldLocation = TargetLocation;
+	CalcFitness(Context.TargetNode);
 
-	// A* loop
-	while (Pq.size() > 0 && !bStop)
+	// Same leafs were searched for recently, the path only needs to be rebuilt
+	Context.CachedPathEnd = nullptr;
+	if (VolumeRef->PathCache.Find(StartNode.TreeID, TempID, Context.Request.UserData, Context.Request.AgentRadius, Context.Request.AnyAngle, CachedPathBuffer))
 	{
-		CPathAStarNode CurrentNode = Pq.top();
-		Pq.pop();
-		ProcessedNodes.push_back(std::make_unique<CPathAStarNode>(CurrentNode));
-
-		if (CurrentNode == TargetNode)
+		CPathAStarNode* Previous = nullptr;
+		for (const CPathCachedNode& CachedNode : CachedPathBuffer)
 		{
-			FoundPathEnd = ProcessedNodes.back().get();
-			break;
+			CPathAStarNode* Node = Context.Forward.NodeArena.Add(CPathAStarNode(CachedNode.TreeID, CachedNode.TreeUserData));
+			Node->WorldLocation = Previous ? CachedNode.WorldLocation : Context.Request.Start;
+			Node->PreviousNode = Previous;
+			if (Previous)
+			{
+				VolumeRef->CalcFitness(*Node, TargetLocation, Context.Request.UserData);
+			}
+			Previous = Node;
 		}
+		Context.CachedPathEnd = Previous;
+		Context.bStarted = true;
+		return ECPathfindingFailReason::None;
+	}
 
-		std::vector<CPathAStarNode> Neighbours = VolumeRef->FindFreeNeighbourLeafs(CurrentNode);
-		for (CPathAStarNode NewTreeNode : Neighbours)
+	// Long searches are limited to a corridor of clusters, if the volume has them.
+	// Clusters don't know about clearance, so bigger agents search without them.
+	Context.bUseCorridor = false;
+	const CPathAbstractGraph& AbstractGraph = VolumeRef->AbstractGraph;
+	if (AbstractGraph.IsBuilt() && Context.Request.AgentRadius <= VolumeRef->AgentRadius)
+	{
+		CPathLeafRef StartLeaf = VolumeRef->LeafGraph.FindLeaf(StartNode.TreeID);
+		CPathLeafRef EndLeaf = VolumeRef->LeafGraph.FindLeaf(TempID);
+		if (StartLeaf != CPathLeafGraph::InvalidLeaf && EndLeaf != CPathLeafGraph::InvalidLeaf
+			&& AbstractGraph.GetClusterByOuterIndex(VolumeRef->ExtractOuterIndex(StartNode.TreeID)) != AbstractGraph.GetClusterByOuterIndex(VolumeRef->ExtractOuterIndex(TempID)))
 		{
-
-			if (!VisitedNodes.count(NewTreeNode))
+			Context.Corridor.Reset();
+			if (!AbstractGraph.FindCorridor(StartLeaf, EndLeaf, Context.Corridor))
 			{
-				NewTreeNode.PreviousNode = ProcessedNodes.back().get();
-				NewTreeNode.WorldLocation = VolumeRef->WorldLocationFromTreeID(NewTreeNode.TreeID);
-
-				// CalcFitness(NewNode); - this is inline and not virtual so in theory faster, but not extendable.
-				// Also from my testing, the speed difference between the two was unnoticeable at 150000 nodes processed.
-
-				VolumeRef->CalcFitness(NewTreeNode, TargetLocation, UserData);
-				VisitedNodes.insert(NewTreeNode);
-				Pq.push(NewTreeNode);
+				// Clusters are not connected, so no need to search the whole volume to find that out
+				Result->FailReason = ECPathfindingFailReason::EndLocationUnreachable;
+				return ECPathfindingFailReason::EndLocationUnreachable;
 			}
+			Context.bUseCorridor = true;
 		}
+	}
 
-		if (TIMEDIFF(TimeStart, TIMENOW) >= TimeLimitMS)
-		{
-			Result->FailReason = ECPathfindingFailReason::Timeout;
-			break;
-		}
+	// Initializing priority queue
+	CalcFitness(StartNode);
+	uint32 NodeIndex;
+	Context.Forward.NodeArena.Add(StartNode, NodeIndex);
+	Context.Forward.VisitedNodes.Add(StartNode.TreeID, NodeIndex);
+	Context.Forward.OpenList.Push(NodeIndex, StartNode.FitnessResult);
+
+	// Backward search starts at the target and heads to the start
+	if (Context.Request.Bidirectional)
+	{
+		Context.Backward.TargetLocation = StartNode.WorldLocation;
+		Context.Backward.NodeArena.Add(Context.TargetNode, NodeIndex);
+		Context.Backward.VisitedNodes.Add(Context.TargetNode.TreeID, NodeIndex);
+		Context.Backward.OpenList.Push(NodeIndex, 0);
 	}
 
-	Result->SearchDuration = TIMEDIFF(TimeStart, TIMENOW);
+	Context.bStarted = true;
+	return ECPathfindingFailReason::None;
+}
+
+CPathAStarNode* CPathAStar::ExpandFrontier(CPathSearchContext& Context, CPathSearchFrontier& Frontier, const CPathSearchFrontier* Other)
+{
+	ACPathVolume* VolumeRef = Context.Request.VolumeRef;
+	const int32 UserData = Context.Request.UserData;
+	CPathNodeArena& NodeArena = Frontier.NodeArena;
+	CPathVisitedTable& VisitedNodes = Frontier.VisitedNodes;
+	CPathOpenList& OpenList = Frontier.OpenList;
+
+	CPathAStarNode* CurrentNode = &NodeArena[OpenList.Pop()];
 
-	// Pathfinidng has been interrupted due to premature thread kill or timeout
-	if (bStop)
+	// Any angle parents are assumed visible when nodes are added, and only checked for nodes that are expanded
+	const bool bAnyAngle = Context.Request.AnyAngle;
+	if (bAnyAngle && CurrentNode->PreviousNode && !VolumeRef->HasLineOfSight(CurrentNode->PreviousNode->WorldLocation, CurrentNode->WorldLocation, CurrentMinClearance))
 	{
-		if (Result->FailReason != ECPathfindingFailReason::Timeout)
-		{
-			Result->FailReason = ECPathfindingFailReason::Unknown;
-			return ECPathfindingFailReason::Unknown;
-		}
+		FixAnyAngleParent(Context, Frontier, *CurrentNode);
 	}
-	else if (Result->FailReason == ECPathfindingFailReason::Timeout)
+
+	if (Other ? Other->VisitedNodes.Contains(CurrentNode->TreeID) : *CurrentNode == Context.TargetNode)
 	{
-		return ECPathfindingFailReason::Timeout;
+		return CurrentNode;
 	}
 
-	if (FoundPathEnd)
+	uint32 NodeIndex;
+	VolumeRef->FindFreeNeighbourLeafs(*CurrentNode, NeighbourBuffer);
+	for (CPathAStarNode NewTreeNode : NeighbourBuffer)
 	{
-		// Adding last node that exactly reflects user's requested location
-		uint32 LastTreeID;
-		if (VolumeRef->FindLeafByWorldLocation(End, LastTreeID, false))
+		NewTreeNode.PreviousNode = bAnyAngle && CurrentNode->PreviousNode ? CurrentNode->PreviousNode : CurrentNode;
+		NodeIndex = VisitedNodes.Find(NewTreeNode.TreeID);
+
+		if (NodeIndex == CPathVisitedTable::InvalidIndex)
 		{
-			ProcessedNodes.push_back(std::make_unique<CPathAStarNode>(CPathAStarNode(LastTreeID)));
-			ProcessedNodes.back()->WorldLocation = End;
-			ProcessedNodes.back()->PreviousNode = FoundPathEnd;
-			FoundPathEnd = ProcessedNodes.back().get();
-			VolumeRef->CalcFitness(*FoundPathEnd, TargetLocation, UserData);
-		}
+			if (Context.bUseCorridor && !Context.Corridor.Contains(VolumeRef->AbstractGraph.GetClusterByOuterIndex(VolumeRef->ExtractOuterIndex(NewTreeNode.TreeID))))
+				continue;
 
-		// For debugging
-		if (RequestRawPath)
+			// Leafs too close to obstacles for this agent
+			if (CurrentMinClearance > 0 && NewTreeNode.GraphLeaf != CPathLeafGraph::InvalidLeaf
+				&& VolumeRef->LeafGraph.GetLeaf(NewTreeNode.GraphLeaf).Clearance < CurrentMinClearance)
+				continue;
+
+			// CalcFitness(NewNode); - this is inline and not virtual so in theory faster, but not extendable.
+			// Also from my testing, the speed difference between the two was unnoticeable at 150000 nodes processed.
+
+			VolumeRef->CalcFitness(NewTreeNode, Frontier.TargetLocation, UserData);
+			NodeArena.Add(NewTreeNode, NodeIndex);
+			VisitedNodes.Add(NewTreeNode.TreeID, NodeIndex);
+			OpenList.Push(NodeIndex, NewTreeNode.FitnessResult);
+		}
+		else
 		{
-			auto CurrNode = FoundPathEnd;
-			while (CurrNode)
+			// The node was already reached, but maybe this way is shorter
+			CPathAStarNode& ReachedNode = NodeArena[NodeIndex];
+			VolumeRef->CalcFitness(NewTreeNode, Frontier.TargetLocation, UserData);
+
+			if (NewTreeNode.DistanceSoFar < ReachedNode.DistanceSoFar)
 			{
-				Result->RawPathNodes.Add(*CurrNode);
-				CurrNode = CurrNode->PreviousNode;
+				// Overwriting in place keeps PreviousNode pointers of nodes reached through it valid.
+				// If the node was closed, this reopens it.
+				ReachedNode = NewTreeNode;
+				OpenList.PushOrDecrease(NodeIndex, ReachedNode.FitnessResult);
 			}
 		}
-		Result->RawPathLength = FoundPathEnd->DistanceSoFar;
-		// Post processing to remove unnecessary nodes
-		for (uint32 i = 0; i < SmoothingPasses; i++)
+	}
+	return nullptr;
+}
+
+void CPathAStar::FixAnyAngleParent(CPathSearchContext& Context, CPathSearchFrontier& Frontier, CPathAStarNode& Node)
+{
+	ACPathVolume* VolumeRef = Context.Request.VolumeRef;
+
+	// Closed neighbours are preferred, their paths won't change anymore. The node that added this one is always visited,
+	// but it may have been reopened since, so open neighbours are the fallback.
+	CPathAStarNode Best = Node;
+	Best.DistanceSoFar = TNumericLimits<float>::Max();
+	bool BestIsOpen = true;
+	bool Found = false;
+
+	VolumeRef->FindFreeNeighbourLeafs(Node, NeighbourBuffer);
+	for (const CPathAStarNode& Neighbour : NeighbourBuffer)
+	{
+		uint32 NeighbourIndex = Frontier.VisitedNodes.Find(Neighbour.TreeID);
+		if (NeighbourIndex == CPathVisitedTable::InvalidIndex)
+			continue;
+
+		CPathAStarNode Candidate = Node;
+		Candidate.PreviousNode = &Frontier.NodeArena[NeighbourIndex];
+		VolumeRef->CalcFitness(Candidate, Frontier.TargetLocation, Context.Request.UserData);
+
+		bool IsOpen = Frontier.OpenList.Contains(NeighbourIndex);
+		bool IsBetter = IsOpen == BestIsOpen ? Candidate.DistanceSoFar < Best.DistanceSoFar : !IsOpen;
+		if (!IsBetter)
+			continue;
+
+		// A neighbour reached through this node before it was reopened would make a loop
+		bool LeadsThroughNode = false;
+		for (const CPathAStarNode* Ancestor = Candidate.PreviousNode; Ancestor && !LeadsThroughNode; Ancestor = Ancestor->PreviousNode)
 		{
-			SmoothenPath(FoundPathEnd);
+			LeadsThroughNode = Ancestor == &Node;
 		}
-		Result->SearchDuration = TIMEDIFF(TimeStart, TIMENOW);
-		Result->FailReason = ECPathfindingFailReason::None;
+		if (LeadsThroughNode)
+			continue;
+
+		Best = Candidate;
+		BestIsOpen = IsOpen;
+		Found = true;
 	}
-	else
+
+	if (Found)
 	{
-		Result->FailReason = ECPathfindingFailReason::EndLocationUnreachable;
-		return ECPathfindingFailReason::EndLocationUnreachable;
+		Node = Best;
 	}
+}
 
-#ifdef LOG_PATHFINDERS
-	auto CurrDuration = TIMEDIFF(TimeStart, TIMENOW);
-	UE_LOG(LogTemp, Warning, TEXT("FindPath:  time= %lfms  NodesVisited= %d  NodesProcessed= %d"), CurrDuration, VisitedNodes.size(), ProcessedNodes.size());
-#endif
+CPathAStarNode* CPathAStar::JoinPaths(CPathAStarNode* ForwardNode, CPathAStarNode* BackwardNode)
+{
+	// Both are the same leaf, so the backward one is skipped.
+	// Reversing the rest of the backward chain, PreviousNode of backward nodes points towards the target
+	CPathAStarNode* Previous = ForwardNode;
+	CPathAStarNode* CurrNode = BackwardNode->PreviousNode;
+	while (CurrNode)
+	{
+		CPathAStarNode* Next = CurrNode->PreviousNode;
+		CurrNode->PreviousNode = Previous;
+		CurrNode->DistanceSoFar = Previous->DistanceSoFar + FVector::Distance(Previous->WorldLocation, CurrNode->WorldLocation);
+		Previous = CurrNode;
+		CurrNode = Next;
+	}
+	return Previous;
+}
+
+void CPathAStar::AddToCache(CPathSearchContext& Context, CPathAStarNode* FoundPathEnd)
+{
+	CPathCache& PathCache = Context.Request.VolumeRef->PathCache;
+	if (PathCache.GetCapacity() == 0)
+		return;
+
+	std::vector<CPathCachedNode> CachedNodes;
+	for (CPathAStarNode* CurrNode = FoundPathEnd; CurrNode; CurrNode = CurrNode->PreviousNode)
+	{
+		CachedNodes.push_back({ CurrNode->WorldLocation, CurrNode->TreeID, CurrNode->TreeUserData });
+	}
+	std::reverse(CachedNodes.begin(), CachedNodes.end());
 
-	if (RequestUserPath)
+	CPathTreeID StartLeaf = CachedNodes.front().TreeID;
+	PathCache.Add(StartLeaf, FoundPathEnd->TreeID, Context.Request.UserData, Context.Request.AgentRadius, Context.Request.AnyAngle, std::move(CachedNodes), Context.VolumeRegeneration);
+}
+
+void CPathAStar::FinishSearch(CPathSearchContext& Context, FCPathResult* Result, CPathAStarNode* FoundPathEnd)
+{
+	ACPathVolume* VolumeRef = Context.Request.VolumeRef;
+
+	// Adding last node that exactly reflects user's requested location
+	CPathTreeID LastTreeID;
+	if (VolumeRef->FindLeafByWorldLocation(Context.Request.End, LastTreeID, false))
+	{
+		CPathAStarNode* LastNode = Context.Forward.NodeArena.Add(CPathAStarNode(LastTreeID));
+		LastNode->WorldLocation = Context.Request.End;
+		LastNode->PreviousNode = FoundPathEnd;
+		FoundPathEnd = LastNode;
+		VolumeRef->CalcFitness(*FoundPathEnd, TargetLocation, Context.Request.UserData);
+	}
+
+	// For debugging
+	if (Context.Request.RequestRawPath)
+	{
+		auto CurrNode = FoundPathEnd;
+		while (CurrNode)
+		{
+			Result->RawPathNodes.Add(*CurrNode);
+			CurrNode = CurrNode->PreviousNode;
+		}
+	}
+	Result->RawPathLength = FoundPathEnd->DistanceSoFar;
+	// Post processing to remove unnecessary nodes. Any angle paths are already straight.
+	uint32 SmoothingPasses = Context.Request.AnyAngle ? 0 : Context.Request.SmoothingPasses;
+	for (uint32 i = 0; i < SmoothingPasses; i++)
+	{
+		SmoothenPath(FoundPathEnd);
+	}
+
+	if (Context.Request.RequestUserPath)
 	{
 		TransformToUserPath(FoundPathEnd, Result->UserPath);
 	}
 	Result->FailReason = ECPathfindingFailReason::None;
-	return ECPathfindingFailReason::None;
 }
 
 void CPathAStar::TransformToUserPath(CPathAStarNode* PathEndNode, TArray<FCPathNode>& InUserPath, bool bReverse)
@@ -265,6 +536,10 @@ void CPathAStar::TransformToUserPath(CPathAStarNode* PathEndNode, TArray<FCPathN
 
 bool CPathAStar::CanSkip(FVector Start, FVector End)
 {
+	// The sweep shape is the volume's agent, bigger agents need clearance from the octree
+	if (!CurrentVolumeRef->PhysicsSmoothing || CurrentMinClearance > 0)
+		return CurrentVolumeRef->HasLineOfSight(Start, End, CurrentMinClearance);
+
 	FHitResult HitResult;
 	CurrentVolumeRef->GetWorld()->SweepSingleByChannel(HitResult, Start, End, FQuat(FRotator(0, 0, 0)), CurrentVolumeRef->TraceChannel, CurrentVolumeRef->TraceShapesByDepth.back().back());
 
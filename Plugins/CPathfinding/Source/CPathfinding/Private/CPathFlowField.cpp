@@ -0,0 +1,130 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathFlowField.h"
+#include "CPathVolume.h"
+#include "CPathNodeArena.h"
+#include "CPathOpenList.h"
+#include <algorithm>
+#include <chrono>
+
+CPathFlowField::CPathFlowField()
+{
+}
+
+CPathFlowField::~CPathFlowField()
+{
+}
+
+void CPathFlowField::Build(ACPathVolume* Volume, CPathTreeID InTargetTreeID, int32 InUserData, float InMaxDistance, float TimeLimit)
+{
+	auto TimeStart = TIMENOW;
+	double TimeLimitMS = TimeLimit * 1000;
+
+	TargetTreeID = InTargetTreeID;
+	UserData = InUserData;
+	MaxDistance = InMaxDistance;
+	bComplete = true;
+
+	// Same as in A*, but indices in the arena are also indices in Entries
+	CPathNodeArena Nodes;
+	CPathOpenList OpenList;
+	std::vector<uint32> Next;
+	std::vector<CPathAStarNode> NeighbourBuffer;
+	EntryByTreeID.Reset();
+
+	FVector TargetLocation = Volume->WorldLocationFromTreeID(TargetTreeID);
+	CPathAStarNode TargetNode(TargetTreeID);
+	TargetNode.WorldLocation = TargetLocation;
+	TargetNode.DistanceSoFar = 0;
+
+	uint32 NodeIndex;
+	Nodes.Add(TargetNode, NodeIndex);
+	Next.push_back(InvalidEntry);
+	EntryByTreeID.Add(TargetTreeID, NodeIndex);
+	OpenList.Push(NodeIndex, 0);
+
+	while (!OpenList.IsEmpty())
+	{
+		uint32 CurrentIndex = OpenList.Pop();
+		CPathAStarNode* CurrentNode = &Nodes[CurrentIndex];
+
+		Volume->FindFreeNeighbourLeafs(*CurrentNode, NeighbourBuffer);
+		for (CPathAStarNode NewTreeNode : NeighbourBuffer)
+		{
+			// Going backwards, so PreviousNode is the one closer to the target.
+			// CalcFitness is used so that custom costs apply to fields too, only DistanceSoFar matters here.
+			NewTreeNode.PreviousNode = CurrentNode;
+			Volume->CalcFitness(NewTreeNode, TargetLocation, UserData);
+
+			// Leafs past MaxDistance are never added, so that SampleLeaf doesn't find them
+			if (MaxDistance > 0 && NewTreeNode.DistanceSoFar > MaxDistance)
+				continue;
+
+			NodeIndex = EntryByTreeID.Find(NewTreeNode.TreeID);
+			if (NodeIndex == CPathVisitedTable::InvalidIndex)
+			{
+				Nodes.Add(NewTreeNode, NodeIndex);
+				Next.push_back(CurrentIndex);
+				EntryByTreeID.Add(NewTreeNode.TreeID, NodeIndex);
+				OpenList.Push(NodeIndex, NewTreeNode.DistanceSoFar);
+			}
+			else if (NewTreeNode.DistanceSoFar < Nodes[NodeIndex].DistanceSoFar)
+			{
+				Nodes[NodeIndex] = NewTreeNode;
+				Next[NodeIndex] = CurrentIndex;
+				OpenList.PushOrDecrease(NodeIndex, NewTreeNode.DistanceSoFar);
+			}
+		}
+
+		if (TIMEDIFF(TimeStart, TIMENOW) >= TimeLimitMS)
+		{
+			bComplete = OpenList.IsEmpty();
+			break;
+		}
+	}
+
+	Entries.resize(Nodes.Num());
+	OuterIndices.clear();
+	for (uint32 i = 0; i < Nodes.Num(); i++)
+	{
+		Entries[i] = { Nodes[i].WorldLocation, Nodes[i].DistanceSoFar, Next[i] };
+		OuterIndices.push_back((uint32)(Nodes[i].TreeID & DEPTH_0_MASK));
+	}
+	std::sort(OuterIndices.begin(), OuterIndices.end());
+	OuterIndices.erase(std::unique(OuterIndices.begin(), OuterIndices.end()), OuterIndices.end());
+
+	bValid.store(true);
+}
+
+bool CPathFlowField::Sample(ACPathVolume* Volume, FVector WorldLocation, FVector& OutNextLocation, float& OutDistance) const
+{
+	CPathTreeID TreeID;
+	if (!Volume->FindLeafByWorldLocation(WorldLocation, TreeID))
+		return false;
+
+	return SampleLeaf(TreeID, OutNextLocation, OutDistance);
+}
+
+bool CPathFlowField::SampleLeaf(CPathTreeID TreeID, FVector& OutNextLocation, float& OutDistance) const
+{
+	uint32 Index = EntryByTreeID.Find(TreeID);
+	if (Index == CPathVisitedTable::InvalidIndex)
+		return false;
+
+	const Entry& CurrEntry = Entries[Index];
+	OutNextLocation = CurrEntry.Next == InvalidEntry ? CurrEntry.WorldLocation : Entries[CurrEntry.Next].WorldLocation;
+	OutDistance = CurrEntry.Distance;
+	return true;
+}
+
+void CPathFlowField::InvalidateIfAffected(const std::set<uint32>& InOuterIndices)
+{
+	for (uint32 OuterIndex : InOuterIndices)
+	{
+		if (std::binary_search(OuterIndices.begin(), OuterIndices.end(), OuterIndex))
+		{
+			bValid.store(false);
+			return;
+		}
+	}
+}
@@ -0,0 +1,109 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathGeneratorPool.h"
+#include "CPathAsyncVolumeGeneration.h"
+#include "CPathVolume.h"
+#include "HAL/PlatformMisc.h"
+
+CPathGeneratorPool::CPathGeneratorPool()
+{
+}
+
+CPathGeneratorPool::~CPathGeneratorPool()
+{
+	Shutdown();
+}
+
+CPathGeneratorPool& CPathGeneratorPool::Get()
+{
+	static CPathGeneratorPool Pool;
+	return Pool;
+}
+
+void CPathGeneratorPool::Submit(std::shared_ptr<CPathGenerationJob> Job)
+{
+	checkf(Job && Job->Volume, TEXT("CPATH - Generator Pool:::Job without a volume submitted"));
+
+	// Nothing for workers to join, but the volume still expects to be notified
+	if (Job->ItemCount == 0)
+	{
+		Job->Completing.store(true);
+		Job->Volume->OnGenerationJobFinished(Job);
+		Job->Finished.store(true);
+		return;
+	}
+
+	{
+		FScopeLock Lock(&Mutex);
+		if (Workers.empty())
+			CreateWorkers();
+		Jobs.push_back(std::move(Job));
+	}
+
+	for (auto& Worker : Workers)
+		Worker->WakeUp();
+}
+
+void CPathGeneratorPool::Cancel(const std::shared_ptr<CPathGenerationJob>& Job)
+{
+	FScopeLock Lock(&Mutex);
+	Job->Cancelled.store(true);
+	Jobs.remove(Job);
+
+	// Nobody is on it and nobody can join anymore
+	if (Job->WorkersInJob.load() == 0 && !Job->Completing.exchange(true))
+		Job->Finished.store(true);
+}
+
+std::shared_ptr<CPathGenerationJob> CPathGeneratorPool::JoinJob()
+{
+	FScopeLock Lock(&Mutex);
+	for (const std::shared_ptr<CPathGenerationJob>& Job : Jobs)
+	{
+		if (Job->WorkersInJob.load() < Job->MaxWorkers && Job->NextItem.load() < Job->ItemCount)
+		{
+			Job->WorkersInJob++;
+			return Job;
+		}
+	}
+	return nullptr;
+}
+
+void CPathGeneratorPool::LeaveJob(const std::shared_ptr<CPathGenerationJob>& Job)
+{
+	{
+		FScopeLock Lock(&Mutex);
+		// Everything is claimed (or the job was cancelled), no point in anyone else joining
+		Jobs.remove(Job);
+
+		if (--Job->WorkersInJob > 0 || Job->Completing.exchange(true))
+			return;
+	}
+
+	Job->Volume->OnGenerationJobFinished(Job);
+	Job->Finished.store(true);
+}
+
+void CPathGeneratorPool::Shutdown()
+{
+	{
+		FScopeLock Lock(&Mutex);
+		for (const std::shared_ptr<CPathGenerationJob>& Job : Jobs)
+			Job->Cancelled.store(true);
+		Jobs.clear();
+	}
+
+	// Destructors wait for the threads to exit
+	for (auto& Worker : Workers)
+		Worker->Stop();
+	Workers.clear();
+}
+
+void CPathGeneratorPool::CreateWorkers()
+{
+	// Same limit as ACPathVolume::MaxGenerationThreads
+	int WorkerCount = FMath::Clamp(FPlatformMisc::NumberOfCores() - 1, 1, 31);
+	Workers.reserve(WorkerCount);
+	for (int Index = 0; Index < WorkerCount; Index++)
+		Workers.push_back(std::make_unique<FCPathAsyncVolumeGenerator>(this, (uint8)Index));
+}
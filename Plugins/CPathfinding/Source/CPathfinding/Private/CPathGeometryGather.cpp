@@ -0,0 +1,340 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathGeometryGather.h"
+#include "CPathVolume.h"
+#include "Engine/World.h"
+#include "Components/PrimitiveComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "PhysicsEngine/AggregateGeom.h"
+
+// GJK gives up after this many iterations, physics decides then
+static constexpr int GJKMaxIterations = 64;
+
+CPathGeometryGather::CPathGeometryGather()
+{
+}
+
+CPathGeometryGather::~CPathGeometryGather()
+{
+}
+
+void CPathGeometryGather::Collect(const ACPathVolume* Volume, FVector Location)
+{
+	Reset();
+	Tolerance = FMath::Max(0.1, Volume->VoxelSize * 0.01);
+
+	// Same reach as in ACPathVolume::IsBrickEmpty, and a bit more for queries grown by Tolerance
+	FVector Extent = FVector(Volume->GetVoxelSizeByDepth(0) / 2.f + Tolerance);
+	Extent += FVector(Volume->AgentRadius, Volume->AgentRadius, Volume->AgentShape == EAgentShape::Sphere ? Volume->AgentRadius : Volume->AgentHalfHeight);
+
+	Volume->GetWorld()->OverlapMultiByChannel(Overlaps, Location, FQuat::Identity, Volume->TraceChannel, FCollisionShape::MakeBox(Extent));
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		const UPrimitiveComponent* Primitive = Overlap.GetComponent();
+		if (!Primitive || !AddPrimitive(Primitive, Overlap.ItemIndex))
+			Unresolved = true;
+	}
+}
+
+void CPathGeometryGather::Reset()
+{
+	Shapes.clear();
+	Points.clear();
+	Overlaps.Reset();
+	Unresolved = false;
+}
+
+CPathGeometryGather::EResult CPathGeometryGather::Test(const FCollisionShape& Shape, FVector Location) const
+{
+	// Anything that doesn't touch the grown shape is free, anything that touches the shrunk one is blocked,
+	// so shapes that barely touch are left to physics and its own tolerances
+	FVector GrownPoints[8], ShrunkPoints[8];
+	ShapeView Grown = MakeQueryView(Shape, Location, Tolerance, GrownPoints);
+	ShapeView Shrunk = MakeQueryView(Shape, Location, -Tolerance, ShrunkPoints);
+
+	FBox GrownBounds(GrownPoints, Grown.PointCount);
+	GrownBounds = GrownBounds.ExpandBy(Grown.Radius);
+
+	bool MaybeBlocked = false;
+	for (const GatheredShape& Gathered : Shapes)
+	{
+		if (!Gathered.Bounds.Intersect(GrownBounds))
+			continue;
+
+		ShapeView View;
+		View.Points = &Points[Gathered.FirstPoint];
+		View.PointCount = Gathered.PointCount;
+		View.Radius = Gathered.Radius;
+
+		bool Decided = false;
+		bool Overlapping = Intersect(Grown, View, Decided);
+		if (Decided && !Overlapping)
+			continue;
+
+		if (Intersect(Shrunk, View, Decided) && Decided)
+			return EResult::Blocked;
+
+		MaybeBlocked = true;
+	}
+
+	return (MaybeBlocked || Unresolved) ? EResult::Unknown : EResult::Free;
+}
+
+bool CPathGeometryGather::AddPrimitive(const UPrimitiveComponent* Primitive, int32 ItemIndex)
+{
+	// Movable primitives can change while the generator reads them, physics has its own synchronization
+	if (Primitive->Mobility != EComponentMobility::Static)
+		return false;
+
+	// Queries use simple collision, unless the body only has complex
+	UBodySetup* BodySetup = const_cast<UPrimitiveComponent*>(Primitive)->GetBodySetup();
+	if (!BodySetup || BodySetup->GetCollisionTraceFlag() == CTF_UseComplexAsSimple)
+		return false;
+
+	// Tapered capsules, level sets and whatever else a body can have are left to physics
+	const FKAggregateGeom& Geom = BodySetup->AggGeom;
+	int32 SupportedCount = Geom.SphereElems.Num() + Geom.BoxElems.Num() + Geom.SphylElems.Num() + Geom.ConvexElems.Num();
+	if (SupportedCount == 0 || SupportedCount != Geom.GetElementCount())
+		return false;
+
+	FTransform Transform = Primitive->GetComponentTransform();
+	if (const UInstancedStaticMeshComponent* Instances = Cast<UInstancedStaticMeshComponent>(Primitive))
+	{
+		if (!Instances->GetInstanceTransform(ItemIndex, Transform, true))
+			return false;
+	}
+
+	// Spheres and capsules only stay round with uniform scale
+	FVector Scale = Transform.GetScale3D().GetAbs();
+	bool UniformScale = FMath::IsNearlyEqual(Scale.X, Scale.Y) && FMath::IsNearlyEqual(Scale.X, Scale.Z);
+	if (!UniformScale && (Geom.SphereElems.Num() || Geom.SphylElems.Num()))
+		return false;
+
+	// Points go through the element transform and then the primitive's, so that rotated elements under non-uniform scale stay exact
+	for (const FKBoxElem& Box : Geom.BoxElems)
+	{
+		uint32 FirstPoint = (uint32)Points.size();
+		FTransform BoxTransform = Box.GetTransform();
+		FVector HalfExtent(Box.X / 2.f, Box.Y / 2.f, Box.Z / 2.f);
+		for (int Corner = 0; Corner < 8; Corner++)
+		{
+			FVector Local = HalfExtent * FVector(Corner & 4 ? 1 : -1, Corner & 2 ? 1 : -1, Corner & 1 ? 1 : -1);
+			Points.push_back(Transform.TransformPosition(BoxTransform.TransformPosition(Local)));
+		}
+		AddShape(FirstPoint, 0);
+	}
+
+	for (const FKConvexElem& Convex : Geom.ConvexElems)
+	{
+		if (Convex.VertexData.IsEmpty())
+			continue;
+
+		uint32 FirstPoint = (uint32)Points.size();
+		FTransform ConvexTransform = Convex.GetTransform();
+		for (const FVector& Vertex : Convex.VertexData)
+		{
+			Points.push_back(Transform.TransformPosition(ConvexTransform.TransformPosition(Vertex)));
+		}
+		AddShape(FirstPoint, 0);
+	}
+
+	for (const FKSphereElem& Sphere : Geom.SphereElems)
+	{
+		uint32 FirstPoint = (uint32)Points.size();
+		Points.push_back(Transform.TransformPosition(Sphere.Center));
+		AddShape(FirstPoint, Sphere.Radius * Scale.X);
+	}
+
+	for (const FKSphylElem& Capsule : Geom.SphylElems)
+	{
+		uint32 FirstPoint = (uint32)Points.size();
+		FTransform CapsuleTransform = Capsule.GetTransform();
+		Points.push_back(Transform.TransformPosition(CapsuleTransform.TransformPosition(FVector(0, 0, -Capsule.Length / 2.f))));
+		Points.push_back(Transform.TransformPosition(CapsuleTransform.TransformPosition(FVector(0, 0, Capsule.Length / 2.f))));
+		AddShape(FirstPoint, Capsule.Radius * Scale.X);
+	}
+
+	return true;
+}
+
+void CPathGeometryGather::AddShape(uint32 FirstPoint, double Radius)
+{
+	GatheredShape Shape;
+	Shape.FirstPoint = FirstPoint;
+	Shape.PointCount = (uint32)Points.size() - FirstPoint;
+	Shape.Radius = Radius;
+	Shape.Bounds = FBox(&Points[FirstPoint], Shape.PointCount).ExpandBy(Radius);
+	Shapes.push_back(Shape);
+}
+
+CPathGeometryGather::ShapeView CPathGeometryGather::MakeQueryView(const FCollisionShape& Shape, FVector Location, double Inflate, FVector OutPoints[8])
+{
+	ShapeView View;
+	View.Points = OutPoints;
+
+	switch (Shape.ShapeType)
+	{
+	case ECollisionShape::Box:
+	{
+		FVector HalfExtent = (FVector(Shape.GetBox()) + FVector(Inflate)).ComponentMax(FVector::ZeroVector);
+		for (int Corner = 0; Corner < 8; Corner++)
+		{
+			OutPoints[Corner] = Location + HalfExtent * FVector(Corner & 4 ? 1 : -1, Corner & 2 ? 1 : -1, Corner & 1 ? 1 : -1);
+		}
+		View.PointCount = 8;
+		break;
+	}
+	case ECollisionShape::Sphere:
+		OutPoints[0] = Location;
+		View.PointCount = 1;
+		View.Radius = FMath::Max(0.0, Shape.GetSphereRadius() + Inflate);
+		break;
+	case ECollisionShape::Capsule:
+		// Capsules of TraceShapesByDepth are never rotated
+		OutPoints[0] = Location - FVector(0, 0, Shape.GetCapsuleAxisHalfLength());
+		OutPoints[1] = Location + FVector(0, 0, Shape.GetCapsuleAxisHalfLength());
+		View.PointCount = 2;
+		View.Radius = FMath::Max(0.0, Shape.GetCapsuleRadius() + Inflate);
+		break;
+	default:
+		OutPoints[0] = Location;
+		View.PointCount = 1;
+		View.Radius = FMath::Max(0.0, Inflate);
+		break;
+	}
+	return View;
+}
+
+FVector CPathGeometryGather::Support(const ShapeView& Shape, const FVector& Direction)
+{
+	const FVector* Best = Shape.Points;
+	double BestDot = FVector::DotProduct(*Best, Direction);
+	for (uint32 Index = 1; Index < Shape.PointCount; Index++)
+	{
+		double Dot = FVector::DotProduct(Shape.Points[Index], Direction);
+		if (Dot > BestDot)
+		{
+			BestDot = Dot;
+			Best = &Shape.Points[Index];
+		}
+	}
+
+	if (Shape.Radius > 0)
+		return *Best + Direction.GetSafeNormal() * Shape.Radius;
+	return *Best;
+}
+
+bool CPathGeometryGather::Intersect(const ShapeView& A, const ShapeView& B, bool& Decided)
+{
+	// Simplex of the Minkowski difference A - B, newest point in SA. The shapes overlap if it can enclose the origin.
+	auto MinkowskiSupport = [&A, &B](const FVector& Direction)
+	{
+		return Support(A, Direction) - Support(B, -Direction);
+	};
+
+	Decided = true;
+	FVector SA, SB, SC, SD;
+	FVector Direction = A.Points[0] - B.Points[0];
+	if (Direction.IsNearlyZero())
+		Direction = FVector(1, 0, 0);
+
+	SC = MinkowskiSupport(Direction);
+	Direction = -SC;
+	SB = MinkowskiSupport(Direction);
+	if (FVector::DotProduct(SB, Direction) < 0)
+		return false;
+
+	FVector BC = SC - SB;
+	Direction = FVector::CrossProduct(FVector::CrossProduct(BC, -SB), BC);
+	// Origin is on the line, any perpendicular direction works
+	if (Direction.IsNearlyZero())
+	{
+		Direction = FVector::CrossProduct(BC, FVector(1, 0, 0));
+		if (Direction.IsNearlyZero())
+			Direction = FVector::CrossProduct(BC, FVector(0, 0, -1));
+	}
+
+	int SimplexSize = 2;
+	for (int Iteration = 0; Iteration < GJKMaxIterations; Iteration++)
+	{
+		if (Direction.IsNearlyZero(1e-12))
+			return true;
+
+		SA = MinkowskiSupport(Direction);
+		if (FVector::DotProduct(SA, Direction) < 0)
+			return false;
+
+		FVector AO = -SA;
+		if (++SimplexSize == 3)
+		{
+			// Triangle ABC, finding the part of it closest to the origin
+			FVector AB = SB - SA;
+			FVector AC = SC - SA;
+			FVector Normal = FVector::CrossProduct(AB, AC);
+			SimplexSize = 2;
+			if (FVector::DotProduct(FVector::CrossProduct(AB, Normal), AO) > 0)
+			{
+				SC = SA;
+				Direction = FVector::CrossProduct(FVector::CrossProduct(AB, AO), AB);
+				continue;
+			}
+			if (FVector::DotProduct(FVector::CrossProduct(Normal, AC), AO) > 0)
+			{
+				SB = SA;
+				Direction = FVector::CrossProduct(FVector::CrossProduct(AC, AO), AC);
+				continue;
+			}
+			SimplexSize = 3;
+			if (FVector::DotProduct(Normal, AO) > 0)
+			{
+				SD = SC;
+				SC = SB;
+				SB = SA;
+				Direction = Normal;
+			}
+			else
+			{
+				SD = SB;
+				SB = SA;
+				Direction = -Normal;
+			}
+			continue;
+		}
+
+		// Tetrahedron ABCD, the origin is either outside one of the faces with A, or inside
+		FVector AB = SB - SA;
+		FVector AC = SC - SA;
+		FVector AD = SD - SA;
+		FVector ABC = FVector::CrossProduct(AB, AC);
+		FVector ACD = FVector::CrossProduct(AC, AD);
+		FVector ADB = FVector::CrossProduct(AD, AB);
+		SimplexSize = 3;
+		if (FVector::DotProduct(ABC, AO) > 0)
+		{
+			SD = SC;
+			SC = SB;
+			SB = SA;
+			Direction = ABC;
+			continue;
+		}
+		if (FVector::DotProduct(ACD, AO) > 0)
+		{
+			SB = SA;
+			Direction = ACD;
+			continue;
+		}
+		if (FVector::DotProduct(ADB, AO) > 0)
+		{
+			SC = SD;
+			SD = SB;
+			SB = SA;
+			Direction = ADB;
+			continue;
+		}
+		return true;
+	}
+
+	Decided = false;
+	return false;
+}
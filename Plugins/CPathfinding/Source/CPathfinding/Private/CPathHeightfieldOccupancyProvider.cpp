@@ -0,0 +1,109 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathHeightfieldOccupancyProvider.h"
+#include "CPathVolume.h"
+#include "CPathOccupancyBatch.h"
+#include "LandscapeProxy.h"
+#include "EngineUtils.h"
+#include "Async/ParallelFor.h"
+
+void UCPathHeightfieldOccupancyProvider::BeginGeneration(ACPathVolume* Volume)
+{
+	Spacing = SampleSpacing > 0 ? SampleSpacing : Volume->VoxelSize / 2.f;
+
+	// Every outer tree, and as far out as an agent in them reaches
+	FVector Margin = GetQueryExtent(Volume, 0) + FVector(Spacing);
+	FVector Min = Volume->StartPosition - FVector(Volume->GetVoxelSizeByDepth(0) / 2.f) - Margin;
+	FVector Size = FVector(Volume->NodeCount[0], Volume->NodeCount[1], Volume->NodeCount[2]) * Volume->GetVoxelSizeByDepth(0) + Margin * 2;
+
+	Origin = FVector2D(Min.X, Min.Y);
+	SampleCount[0] = FMath::CeilToInt32(Size.X / Spacing) + 1;
+	SampleCount[1] = FMath::CeilToInt32(Size.Y / Spacing) + 1;
+	Heights.assign((size_t)SampleCount[0] * SampleCount[1], TNumericLimits<float>::Lowest());
+
+	FBox SampledArea(Min, Min + Size);
+	TArray<ALandscapeProxy*> Landscapes;
+	for (TActorIterator<ALandscapeProxy> It(Volume->GetWorld()); It; ++It)
+	{
+		FBox Bounds = It->GetComponentsBoundingBox();
+		if (Bounds.Min.X <= SampledArea.Max.X && Bounds.Max.X >= SampledArea.Min.X && Bounds.Min.Y <= SampledArea.Max.Y && Bounds.Max.Y >= SampledArea.Min.Y)
+			Landscapes.Add(*It);
+	}
+
+	// Heights come from the landscapes' collision heightfields, which only get read here
+	ParallelFor(SampleCount[0], [this, &Landscapes](int32 X)
+	{
+		for (int32 Y = 0; Y < SampleCount[1]; Y++)
+		{
+			FVector Location(Origin.X + X * Spacing, Origin.Y + Y * Spacing, 0);
+			float& Height = Heights[(size_t)X * SampleCount[1] + Y];
+			for (const ALandscapeProxy* Landscape : Landscapes)
+			{
+				TOptional<float> LandscapeHeight = Landscape->GetHeightAtLocation(Location);
+				if (LandscapeHeight.IsSet())
+					Height = FMath::Max(Height, LandscapeHeight.GetValue() + HeightOffset);
+			}
+		}
+	});
+}
+
+bool UCPathHeightfieldOccupancyProvider::IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const
+{
+	return Center.Z - Extent.Z > GetMaxHeight(Center.X - Extent.X, Center.Y - Extent.Y, Center.X + Extent.X, Center.Y + Extent.Y);
+}
+
+bool UCPathHeightfieldOccupancyProvider::FillOuterTree(const ACPathVolume* Volume, CPathOccupancyBatch& Batch) const
+{
+	for (uint32 Depth = 0; Depth < Batch.GetDepthCount(); Depth++)
+	{
+		FVector Extent = GetQueryExtent(Volume, Depth);
+		uint32 Resolution = CPathOccupancyBatch::GetResolution(Depth);
+		uint8* Cells = Batch.GetCells(Depth);
+
+		for (uint32 X = 0; X < Resolution; X++)
+		{
+			for (uint32 Y = 0; Y < Resolution; Y++)
+			{
+				FVector Bottom = Batch.GetCellLocation(Depth, X, Y, 0);
+				float MaxHeight = GetMaxHeight(Bottom.X - Extent.X, Bottom.Y - Extent.Y, Bottom.X + Extent.X, Bottom.Y + Extent.Y);
+
+				// Cells of the column go up by one cell size, everything above the first free one is free
+				double CellBottom = Bottom.Z - Extent.Z;
+				uint8* Column = &Cells[CPathOccupancyBatch::GetCellIndex(Depth, X, Y, 0)];
+				for (uint32 Z = 0; Z < Resolution; Z++, CellBottom += Batch.GetCellSize(Depth))
+				{
+					Column[Z] = CellBottom > MaxHeight;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+uint32 UCPathHeightfieldOccupancyProvider::GetBakeHash() const
+{
+	// Landscapes are static geometry, so the volume's hash already changes with them
+	uint32 Hash = Super::GetBakeHash();
+	Hash = HashCombine(Hash, GetTypeHash(SampleSpacing));
+	return HashCombine(Hash, GetTypeHash(HeightOffset));
+}
+
+float UCPathHeightfieldOccupancyProvider::GetMaxHeight(double MinX, double MinY, double MaxX, double MaxY) const
+{
+	// Samples just outside the rectangle too, the landscape between them can be as high as either
+	int32 FirstX = FMath::Clamp(FMath::FloorToInt32((MinX - Origin.X) / Spacing), 0, SampleCount[0] - 1);
+	int32 LastX = FMath::Clamp(FMath::CeilToInt32((MaxX - Origin.X) / Spacing), 0, SampleCount[0] - 1);
+	int32 FirstY = FMath::Clamp(FMath::FloorToInt32((MinY - Origin.Y) / Spacing), 0, SampleCount[1] - 1);
+	int32 LastY = FMath::Clamp(FMath::CeilToInt32((MaxY - Origin.Y) / Spacing), 0, SampleCount[1] - 1);
+
+	float MaxHeight = TNumericLimits<float>::Lowest();
+	for (int32 X = FirstX; X <= LastX; X++)
+	{
+		const float* Row = &Heights[(size_t)X * SampleCount[1]];
+		for (int32 Y = FirstY; Y <= LastY; Y++)
+		{
+			MaxHeight = FMath::Max(MaxHeight, Row[Y]);
+		}
+	}
+	return MaxHeight;
+}
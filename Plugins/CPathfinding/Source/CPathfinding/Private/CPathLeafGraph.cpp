@@ -0,0 +1,298 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathLeafGraph.h"
+#include "CPathVolume.h"
+#include "CPathOctree.h"
+#include "CPathVisitedTable.h"
+#include "Async/ParallelFor.h"
+#include <algorithm>
+#include <queue>
+
+CPathLeafGraph::CPathLeafGraph()
+{
+}
+
+CPathLeafGraph::~CPathLeafGraph()
+{
+}
+
+void CPathLeafGraph::Build(ACPathVolume* Volume)
+{
+	uint32 OuterCount = Volume->GetOuterTreeCount();
+	Slices.clear();
+	Slices.resize(OuterCount);
+
+	ParallelFor((int32)OuterCount, [this, Volume](int32 OuterIndex)
+	{
+		BuildSliceLeafs(Volume, OuterIndex);
+	});
+
+	ParallelFor((int32)OuterCount, [this, Volume](int32 OuterIndex)
+	{
+		std::vector<CPathTreeID> NeighbourIDsBuffer;
+		BuildSliceNeighbours(Volume, OuterIndex, NeighbourIDsBuffer);
+	});
+
+	ParallelFor((int32)OuterCount, [this, Volume](int32 OuterIndex)
+	{
+		CPathVisitedTable Visited(256);
+		BuildSliceClearance(Volume, OuterIndex, Visited);
+	});
+
+	bIsBuilt = true;
+}
+
+void CPathLeafGraph::Rebuild(ACPathVolume* Volume, const std::set<uint32>& OuterIndices)
+{
+	if (!bIsBuilt)
+		return;
+
+	// Leafs of adjacent trees didn't change, but their neighbour lists point at leafs of the rebuilt ones
+	std::set<uint32> SlicesToRelink;
+	for (uint32 OuterIndex : OuterIndices)
+	{
+		BuildSliceLeafs(Volume, OuterIndex);
+		SlicesToRelink.insert(OuterIndex);
+
+		for (int Direction = 0; Direction < 6; Direction++)
+		{
+			uint32 NeighbourIndex;
+			if (Volume->FindOuterNeighbourIndex(OuterIndex, (ENeighbourDirection)Direction, NeighbourIndex))
+			{
+				SlicesToRelink.insert(NeighbourIndex);
+			}
+		}
+	}
+
+	std::vector<CPathTreeID> NeighbourIDsBuffer;
+	for (uint32 OuterIndex : SlicesToRelink)
+	{
+		BuildSliceNeighbours(Volume, OuterIndex, NeighbourIDsBuffer);
+	}
+
+	// Clearance of a slice depends on AdjacentOccupied of the slices next to it, so this goes one tree further
+	std::set<uint32> SlicesToRecalc = SlicesToRelink;
+	for (uint32 OuterIndex : SlicesToRelink)
+	{
+		for (int Direction = 0; Direction < 6; Direction++)
+		{
+			uint32 NeighbourIndex;
+			if (Volume->FindOuterNeighbourIndex(OuterIndex, (ENeighbourDirection)Direction, NeighbourIndex))
+			{
+				SlicesToRecalc.insert(NeighbourIndex);
+			}
+		}
+	}
+
+	CPathVisitedTable Visited(256);
+	for (uint32 OuterIndex : SlicesToRecalc)
+	{
+		BuildSliceClearance(Volume, OuterIndex, Visited);
+	}
+}
+
+void CPathLeafGraph::Clear()
+{
+	bIsBuilt = false;
+	Slices.clear();
+	Slices.shrink_to_fit();
+}
+
+CPathLeafRef CPathLeafGraph::FindLeaf(CPathTreeID TreeID) const
+{
+	uint32 OuterIndex = (uint32)(TreeID & DEPTH_0_MASK);
+	if (OuterIndex >= Slices.size())
+		return InvalidLeaf;
+
+	const std::vector<CPathGraphLeaf>& Leafs = Slices[OuterIndex].Leafs;
+	auto Found = std::lower_bound(Leafs.begin(), Leafs.end(), TreeID,
+		[](const CPathGraphLeaf& Leaf, CPathTreeID ID) { return Leaf.TreeID < ID; });
+
+	if (Found == Leafs.end() || Found->TreeID != TreeID)
+		return InvalidLeaf;
+
+	return MakeLeafRef(OuterIndex, (uint32)(Found - Leafs.begin()));
+}
+
+uint32 CPathLeafGraph::GetLeafCount() const
+{
+	uint32 Count = 0;
+	for (const Slice& CurrSlice : Slices)
+	{
+		Count += (uint32)CurrSlice.Leafs.size();
+	}
+	return Count;
+}
+
+// Distance from Location to the closest point of the leaf's box
+static float DistanceToLeaf(ACPathVolume* Volume, FVector Location, CPathTreeID TreeID)
+{
+	FVector Extent(Volume->GetVoxelSizeByDepth(Volume->ExtractDepth(TreeID)) / 2.f);
+	FVector Offset = (Location - Volume->WorldLocationFromTreeID(TreeID)).GetAbs() - Extent;
+	return (float)Offset.ComponentMax(FVector::ZeroVector).Size();
+}
+
+// Adds all free leafs under Tree to Leafs
+static void CollectFreeLeafs(ACPathVolume* Volume, CPathOctree* Tree, CPathTreeID TreeID, uint32 Depth, std::vector<CPathGraphLeaf>& Leafs)
+{
+	if (Tree->Children)
+	{
+		Depth++;
+		for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+		{
+			CPathTreeID ChildID = TreeID;
+			Volume->ReplaceChildIndexAndDepth(ChildID, Depth, ChildIndex);
+			CollectFreeLeafs(Volume, &Tree->Children[ChildIndex], ChildID, Depth, Leafs);
+		}
+	}
+	else if (Volume->IsTreeFree(TreeID))
+	{
+		CPathGraphLeaf Leaf;
+		Leaf.Center = Volume->WorldLocationFromTreeID(TreeID);
+		Leaf.TreeID = TreeID;
+		Leaf.UserData = Volume->GetTreeUserData(TreeID);
+		Leaf.FirstNeighbour = 0;
+		Leaf.NeighbourCount = 0;
+		Leaf.Clearance = 0;
+		Leafs.push_back(Leaf);
+	}
+}
+
+void CPathLeafGraph::BuildSliceLeafs(ACPathVolume* Volume, uint32 OuterIndex)
+{
+	Slice& CurrSlice = Slices[OuterIndex];
+	CurrSlice.Leafs.clear();
+	CurrSlice.Neighbours.clear();
+
+	CollectFreeLeafs(Volume, Volume->GetOuterTree(OuterIndex), OuterIndex, 0, CurrSlice.Leafs);
+
+	std::sort(CurrSlice.Leafs.begin(), CurrSlice.Leafs.end(),
+		[](const CPathGraphLeaf& A, const CPathGraphLeaf& B) { return A.TreeID < B.TreeID; });
+	CurrSlice.Leafs.shrink_to_fit();
+}
+
+void CPathLeafGraph::BuildSliceNeighbours(ACPathVolume* Volume, uint32 OuterIndex, std::vector<CPathTreeID>& NeighbourIDsBuffer)
+{
+	Slice& CurrSlice = Slices[OuterIndex];
+	CurrSlice.Neighbours.clear();
+	CurrSlice.AdjacentOccupied.assign(CurrSlice.Leafs.size(), InvalidLeaf);
+
+	for (uint32 LocalIndex = 0; LocalIndex < CurrSlice.Leafs.size(); LocalIndex++)
+	{
+		CPathGraphLeaf& Leaf = CurrSlice.Leafs[LocalIndex];
+		Leaf.FirstNeighbour = (uint32)CurrSlice.Neighbours.size();
+		float ClosestOccupiedDistance = MAX_FLT;
+
+		// Every adjacent leaf that isn't in the graph is occupied
+		Volume->FindNeighbourLeafs(Leaf.TreeID, NeighbourIDsBuffer, false);
+		for (CPathTreeID NeighbourID : NeighbourIDsBuffer)
+		{
+			CPathLeafRef NeighbourLeaf = FindLeaf(NeighbourID);
+			if (NeighbourLeaf != InvalidLeaf)
+			{
+				CurrSlice.Neighbours.push_back(NeighbourLeaf);
+			}
+			else
+			{
+				float Distance = DistanceToLeaf(Volume, Leaf.Center, NeighbourID);
+				if (Distance < ClosestOccupiedDistance)
+				{
+					ClosestOccupiedDistance = Distance;
+					CurrSlice.AdjacentOccupied[LocalIndex] = NeighbourID;
+				}
+			}
+		}
+		Leaf.NeighbourCount = (uint32)CurrSlice.Neighbours.size() - Leaf.FirstNeighbour;
+	}
+	CurrSlice.Neighbours.shrink_to_fit();
+}
+
+void CPathLeafGraph::BuildSliceClearance(ACPathVolume* Volume, uint32 OuterIndex, CPathVisitedTable& Visited)
+{
+	Slice& CurrSlice = Slices[OuterIndex];
+	float MaxClearance = Volume->GetVoxelSizeByDepth(0);
+	for (CPathGraphLeaf& Leaf : CurrSlice.Leafs)
+	{
+		Leaf.Clearance = MaxClearance;
+	}
+	if (CurrSlice.Leafs.empty())
+		return;
+
+	uint32 Region[7] = { OuterIndex };
+	uint32 RegionSize = 1;
+	for (int Direction = 0; Direction < 6; Direction++)
+	{
+		uint32 NeighbourIndex;
+		if (Volume->FindOuterNeighbourIndex(OuterIndex, (ENeighbourDirection)Direction, NeighbourIndex))
+		{
+			Region[RegionSize++] = NeighbourIndex;
+		}
+	}
+	auto IsInRegion = [&Region, RegionSize](CPathLeafRef LeafRef)
+	{
+		uint32 LeafOuter = (uint32)(LeafRef >> LocalBits);
+		for (uint32 i = 0; i < RegionSize; i++)
+		{
+			if (Region[i] == LeafOuter)
+				return true;
+		}
+		return false;
+	};
+
+	struct QueueEntry
+	{
+		float Distance;
+		CPathLeafRef LeafRef;
+		CPathTreeID OccupiedID;
+
+		bool operator>(const QueueEntry& Other) const
+		{
+			return Distance > Other.Distance;
+		}
+	};
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> Pq;
+
+	for (uint32 i = 0; i < RegionSize; i++)
+	{
+		const Slice& RegionSlice = Slices[Region[i]];
+		for (uint32 LocalIndex = 0; LocalIndex < RegionSlice.Leafs.size(); LocalIndex++)
+		{
+			CPathTreeID OccupiedID = RegionSlice.AdjacentOccupied[LocalIndex];
+			if (OccupiedID != InvalidLeaf)
+			{
+				Pq.push({ DistanceToLeaf(Volume, RegionSlice.Leafs[LocalIndex].Center, OccupiedID), MakeLeafRef(Region[i], LocalIndex), OccupiedID });
+			}
+		}
+	}
+
+	// Every leaf takes the closest occupied leaf of its neighbours. Not exact, but close enough for this.
+	// Visited only marks leafs that are done, LeafRef is used as the key
+	Visited.Reset();
+	uint32 LeafsLeft = (uint32)CurrSlice.Leafs.size();
+	while (Pq.size() > 0 && LeafsLeft > 0)
+	{
+		QueueEntry Current = Pq.top();
+		Pq.pop();
+		if (Current.Distance >= MaxClearance)
+			break;
+		if (!Visited.Add(Current.LeafRef, 0))
+			continue;
+
+		if ((Current.LeafRef >> LocalBits) == OuterIndex)
+		{
+			CurrSlice.Leafs[Current.LeafRef & LocalMask].Clearance = Current.Distance;
+			LeafsLeft--;
+		}
+
+		const CPathLeafRef* Neighbours = GetNeighbours(Current.LeafRef);
+		uint32 NeighbourCount = GetLeaf(Current.LeafRef).NeighbourCount;
+		for (uint32 i = 0; i < NeighbourCount; i++)
+		{
+			CPathLeafRef NeighbourRef = Neighbours[i];
+			if (IsInRegion(NeighbourRef) && !Visited.Contains(NeighbourRef))
+			{
+				Pq.push({ DistanceToLeaf(Volume, GetLeaf(NeighbourRef).Center, Current.OccupiedID), NeighbourRef, Current.OccupiedID });
+			}
+		}
+	}
+}
@@ -0,0 +1,671 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathMeshVoxelizerOccupancyProvider.h"
+#include "CPathVolume.h"
+#include "CPathOccupancyBatch.h"
+#include "Engine/World.h"
+#include "Engine/OverlapResult.h"
+#include "Engine/StaticMesh.h"
+#include "Components/BoxComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "PhysicsEngine/AggregateGeom.h"
+#include "Interfaces/Interface_CollisionDataProvider.h"
+#include <algorithm>
+
+// Corners of a box by bits XYZ (4, 2, 1), two triangles per face
+static const int32 BoxTriangleIndices[36] = {
+	0, 1, 3,  0, 3, 2,
+	4, 6, 7,  4, 7, 5,
+	0, 4, 5,  0, 5, 1,
+	2, 3, 7,  2, 7, 6,
+	0, 2, 6,  0, 6, 4,
+	1, 5, 7,  1, 7, 3
+};
+
+// Reused by every tree a generator fills
+static thread_local std::vector<uint8> SolidLeafs;
+static thread_local std::vector<uint8> DilatedLeafs;
+static thread_local std::vector<std::vector<uint8>> SolidByDepth;
+
+void UCPathMeshVoxelizerOccupancyProvider::BeginGeneration(ACPathVolume* Volume)
+{
+	Triangles.clear();
+	Solids.clear();
+	Planes.clear();
+	FallbackBounds.Reset();
+	FallbackParams = FCollisionQueryParams(FName(TEXT("CPathVoxelizer")), false);
+
+	for (uint32 Depth = 0; Depth <= (uint32)Volume->OctreeDepth; Depth++)
+	{
+		AgentAtDepth[Depth] = Volume->TraceShapesByDepth[Depth].size() > 1;
+	}
+	BuildDilationOffsets(Volume);
+
+	// Everything an agent in the volume could touch
+	FVector Extent = Volume->VolumeBox->GetScaledBoxExtent() + BinMargin + FVector(Volume->GetVoxelSizeByDepth(0));
+	TArray<FOverlapResult> Overlaps;
+	Volume->GetWorld()->OverlapMultiByChannel(Overlaps, Volume->VolumeBox->GetComponentLocation(), FQuat::Identity, Volume->TraceChannel, FCollisionShape::MakeBox(Extent));
+
+	// Instances come as separate overlaps, but a component is either voxelized or ignored as a whole
+	TSet<const UPrimitiveComponent*> Visited;
+	TArray<const UPrimitiveComponent*> Voxelized;
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		const UPrimitiveComponent* Primitive = Overlap.GetComponent();
+		if (!Primitive || Visited.Contains(Primitive))
+			continue;
+
+		Visited.Add(Primitive);
+		if (AddPrimitive(Primitive))
+			Voxelized.Add(Primitive);
+		else
+			FallbackBounds.Add(Primitive->Bounds.GetBox());
+	}
+
+	for (const UPrimitiveComponent* Primitive : Voxelized)
+	{
+		FallbackParams.AddIgnoredComponent(Primitive);
+	}
+	// The ignore list is sorted lazily on first use, do it now so generators only read it
+	FallbackParams.GetIgnoredComponents();
+
+	BuildBins(Volume);
+
+	UE_LOG(LogTemp, Log, TEXT("CPATH - Voxelizer:::%d triangles, %d solids, %d primitives left to physics"), (int32)Triangles.size(), (int32)Solids.size(), FallbackBounds.Num());
+}
+
+bool UCPathMeshVoxelizerOccupancyProvider::IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const
+{
+	FBox Query(Center - Extent, Center + Extent);
+	FIntVector First, Last;
+	if (GetOuterRange(Volume, Query, First, Last))
+	{
+		// Neighbouring bins share triangles, testing some twice is cheaper than remembering which were tested
+		for (int32 X = First.X; X <= Last.X; X++)
+		{
+			for (int32 Y = First.Y; Y <= Last.Y; Y++)
+			{
+				for (int32 Z = First.Z; Z <= Last.Z; Z++)
+				{
+					uint32 OuterIndex = Volume->LocalCoordsInt3ToIndex(FVector(X, Y, Z));
+					const std::pair<uint32, uint32>* Begin, * End;
+					FindBin(TriangleBins, OuterIndex, Begin, End);
+					for (const std::pair<uint32, uint32>* It = Begin; It != End; It++)
+					{
+						const Triangle& Tri = Triangles[It->second];
+						if (TriangleOverlapsBox(Center, Extent, Tri.A, Tri.B, Tri.C))
+							return false;
+					}
+
+					// A box inside of a solid doesn't touch any of its triangles
+					FindBin(SolidBins, OuterIndex, Begin, End);
+					for (const std::pair<uint32, uint32>* It = Begin; It != End; It++)
+					{
+						if (IsInsideSolid(Solids[It->second], Center))
+							return false;
+					}
+				}
+			}
+		}
+	}
+
+	for (const FBox& Bounds : FallbackBounds)
+	{
+		if (Bounds.Intersect(Query))
+			return !Volume->GetWorld()->OverlapAnyTestByChannel(Center, FQuat::Identity, Volume->TraceChannel, FCollisionShape::MakeBox(Extent), FallbackParams);
+	}
+	return true;
+}
+
+bool UCPathMeshVoxelizerOccupancyProvider::FillOuterTree(const ACPathVolume* Volume, CPathOccupancyBatch& Batch) const
+{
+	const uint32 LeafDepth = Batch.GetDepthCount() - 1;
+	const int32 Resolution = (int32)CPathOccupancyBatch::GetResolution(LeafDepth);
+	const double LeafSize = Batch.GetCellSize(LeafDepth);
+	const FVector LeafExtent(LeafSize / 2.0);
+	const FVector OuterLocation = Batch.GetCellLocation(0, 0, 0, 0);
+	const uint32 OuterIndex = GetOuterIndex(Volume, OuterLocation);
+
+	const std::pair<uint32, uint32>* TrianglesBegin, * TrianglesEnd, * SolidsBegin, * SolidsEnd;
+	FindBin(TriangleBins, OuterIndex, TrianglesBegin, TrianglesEnd);
+	FindBin(SolidBins, OuterIndex, SolidsBegin, SolidsEnd);
+
+	FBox Reach(OuterLocation - FVector(Batch.GetCellSize(0) / 2.0) - BinMargin, OuterLocation + FVector(Batch.GetCellSize(0) / 2.0) + BinMargin);
+	TArray<FBox> NearbyBounds;
+	for (const FBox& Bounds : FallbackBounds)
+	{
+		if (Bounds.Intersect(Reach))
+			NearbyBounds.Add(Bounds);
+	}
+
+	// Nothing voxelized reaches this tree, the outer grid alone decides it
+	if (TrianglesBegin == TrianglesEnd && SolidsBegin == SolidsEnd)
+	{
+		for (uint32 Depth = 0; Depth <= LeafDepth; Depth++)
+		{
+			uint32 CellCount = CPathOccupancyBatch::GetResolution(Depth);
+			CellCount *= CellCount * CellCount;
+			FMemory::Memset(Batch.GetCells(Depth), 1, CellCount);
+		}
+		if (NearbyBounds.Num())
+			ApplyFallback(Volume, Batch, 0, 0, 0, 0, NearbyBounds);
+		return true;
+	}
+
+	// Leafs around the tree too, as far as the agent shape at the tree's leafs reaches
+	const FIntVector Margin = DilationMargin;
+	const FIntVector Size(Resolution + Margin.X * 2, Resolution + Margin.Y * 2, Resolution + Margin.Z * 2);
+	const FVector GridMin = OuterLocation - FVector(Batch.GetCellSize(0) / 2.0) - FVector(Margin) * LeafSize;
+	auto GetGridIndex = [&Size](int32 X, int32 Y, int32 Z)
+	{
+		return ((size_t)X * Size.Y + Y) * Size.Z + Z;
+	};
+
+	SolidLeafs.assign((size_t)Size.X * Size.Y * Size.Z, 0);
+
+	// Leafs a triangle's bounds touch, false if none
+	auto GetLeafRange = [&](const FBox& Bounds, FIntVector& First, FIntVector& Last)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			int32 Low = FMath::FloorToInt32((Bounds.Min[Axis] - GridMin[Axis]) / LeafSize);
+			int32 High = FMath::FloorToInt32((Bounds.Max[Axis] - GridMin[Axis]) / LeafSize);
+			if (High < 0 || Low >= Size[Axis])
+				return false;
+			First[Axis] = FMath::Max(Low, 0);
+			Last[Axis] = FMath::Min(High, Size[Axis] - 1);
+		}
+		return true;
+	};
+
+	for (const std::pair<uint32, uint32>* It = TrianglesBegin; It != TrianglesEnd; It++)
+	{
+		const Triangle& Tri = Triangles[It->second];
+		FBox Bounds(Tri.A.ComponentMin(Tri.B).ComponentMin(Tri.C), Tri.A.ComponentMax(Tri.B).ComponentMax(Tri.C));
+		FIntVector First, Last;
+		if (!GetLeafRange(Bounds, First, Last))
+			continue;
+
+		for (int32 X = First.X; X <= Last.X; X++)
+		{
+			for (int32 Y = First.Y; Y <= Last.Y; Y++)
+			{
+				for (int32 Z = First.Z; Z <= Last.Z; Z++)
+				{
+					uint8& Leaf = SolidLeafs[GetGridIndex(X, Y, Z)];
+					if (!Leaf)
+						Leaf = TriangleOverlapsBox(GridMin + (FVector(X, Y, Z) + 0.5) * LeafSize, LeafExtent, Tri.A, Tri.B, Tri.C);
+				}
+			}
+		}
+	}
+
+	// Leafs that don't touch a solid's surface are either fully inside or fully outside, their center tells which
+	for (const std::pair<uint32, uint32>* It = SolidsBegin; It != SolidsEnd; It++)
+	{
+		const Solid& CurrSolid = Solids[It->second];
+		FIntVector First, Last;
+		if (!GetLeafRange(CurrSolid.Bounds, First, Last))
+			continue;
+
+		for (int32 X = First.X; X <= Last.X; X++)
+		{
+			for (int32 Y = First.Y; Y <= Last.Y; Y++)
+			{
+				for (int32 Z = First.Z; Z <= Last.Z; Z++)
+				{
+					uint8& Leaf = SolidLeafs[GetGridIndex(X, Y, Z)];
+					if (!Leaf)
+						Leaf = IsInsideSolid(CurrSolid, GridMin + (FVector(X, Y, Z) + 0.5) * LeafSize);
+				}
+			}
+		}
+	}
+
+	// Solid leafs of the tree itself, then OR'd up into every coarser depth
+	SolidByDepth.resize(LeafDepth + 1);
+	for (uint32 Depth = 0; Depth <= LeafDepth; Depth++)
+	{
+		uint32 DepthResolution = CPathOccupancyBatch::GetResolution(Depth);
+		SolidByDepth[Depth].assign((size_t)DepthResolution * DepthResolution * DepthResolution, 0);
+	}
+	for (int32 X = 0; X < Resolution; X++)
+	{
+		for (int32 Y = 0; Y < Resolution; Y++)
+		{
+			for (int32 Z = 0; Z < Resolution; Z++)
+			{
+				SolidByDepth[LeafDepth][CPathOccupancyBatch::GetCellIndex(LeafDepth, X, Y, Z)] = SolidLeafs[GetGridIndex(X + Margin.X, Y + Margin.Y, Z + Margin.Z)];
+			}
+		}
+	}
+	for (uint32 Depth = LeafDepth; Depth > 0; Depth--)
+	{
+		uint32 ChildResolution = CPathOccupancyBatch::GetResolution(Depth);
+		for (uint32 X = 0; X < ChildResolution; X++)
+		{
+			for (uint32 Y = 0; Y < ChildResolution; Y++)
+			{
+				for (uint32 Z = 0; Z < ChildResolution; Z++)
+				{
+					SolidByDepth[Depth - 1][CPathOccupancyBatch::GetCellIndex(Depth - 1, X >> 1, Y >> 1, Z >> 1)] |= SolidByDepth[Depth][CPathOccupancyBatch::GetCellIndex(Depth, X, Y, Z)];
+				}
+			}
+		}
+	}
+
+	// Leafs where the agent shape at the center touches a solid leaf. Only leafs on the border of solid regions are stamped,
+	// a shape can't reach the inside of a region without touching its border.
+	if (AgentAtDepth[LeafDepth])
+	{
+		DilatedLeafs = SolidByDepth[LeafDepth];
+		for (int32 X = 0; X < Size.X; X++)
+		{
+			for (int32 Y = 0; Y < Size.Y; Y++)
+			{
+				for (int32 Z = 0; Z < Size.Z; Z++)
+				{
+					if (!SolidLeafs[GetGridIndex(X, Y, Z)])
+						continue;
+
+					bool IsBorder = X == 0 || Y == 0 || Z == 0 || X == Size.X - 1 || Y == Size.Y - 1 || Z == Size.Z - 1
+						|| !SolidLeafs[GetGridIndex(X - 1, Y, Z)] || !SolidLeafs[GetGridIndex(X + 1, Y, Z)]
+						|| !SolidLeafs[GetGridIndex(X, Y - 1, Z)] || !SolidLeafs[GetGridIndex(X, Y + 1, Z)]
+						|| !SolidLeafs[GetGridIndex(X, Y, Z - 1)] || !SolidLeafs[GetGridIndex(X, Y, Z + 1)];
+					if (!IsBorder)
+						continue;
+
+					FIntVector Leaf = FIntVector(X, Y, Z) - Margin;
+					for (const FIntVector& Offset : DilationOffsets)
+					{
+						FIntVector Target = Leaf + Offset;
+						if (Target.X >= 0 && Target.Y >= 0 && Target.Z >= 0 && Target.X < Resolution && Target.Y < Resolution && Target.Z < Resolution)
+							DilatedLeafs[CPathOccupancyBatch::GetCellIndex(LeafDepth, Target.X, Target.Y, Target.Z)] = 1;
+					}
+				}
+			}
+		}
+	}
+
+	for (uint32 Depth = 0; Depth <= LeafDepth; Depth++)
+	{
+		uint32 DepthResolution = CPathOccupancyBatch::GetResolution(Depth);
+		uint32 LeafsPerCell = 1u << (LeafDepth - Depth);
+		uint8* Cells = Batch.GetCells(Depth);
+		const std::vector<uint8>& Solid = SolidByDepth[Depth];
+
+		for (uint32 X = 0; X < DepthResolution; X++)
+		{
+			for (uint32 Y = 0; Y < DepthResolution; Y++)
+			{
+				for (uint32 Z = 0; Z < DepthResolution; Z++)
+				{
+					uint32 CellIndex = CPathOccupancyBatch::GetCellIndex(Depth, X, Y, Z);
+					bool IsFree = !Solid[CellIndex];
+					if (IsFree && AgentAtDepth[Depth])
+					{
+						if (Depth == LeafDepth)
+						{
+							IsFree = !DilatedLeafs[CellIndex];
+						}
+						else
+						{
+							// Center of the tree is the corner of the 8 leafs around it
+							uint32 CenterX = X * LeafsPerCell + LeafsPerCell / 2, CenterY = Y * LeafsPerCell + LeafsPerCell / 2, CenterZ = Z * LeafsPerCell + LeafsPerCell / 2;
+							for (uint32 Corner = 0; Corner < 8 && IsFree; Corner++)
+							{
+								IsFree = !DilatedLeafs[CPathOccupancyBatch::GetCellIndex(LeafDepth, CenterX - (Corner >> 2 & 1), CenterY - (Corner >> 1 & 1), CenterZ - (Corner & 1))];
+							}
+						}
+					}
+					Cells[CellIndex] = IsFree;
+				}
+			}
+		}
+	}
+
+	if (NearbyBounds.Num())
+		ApplyFallback(Volume, Batch, 0, 0, 0, 0, NearbyBounds);
+	return true;
+}
+
+bool UCPathMeshVoxelizerOccupancyProvider::TriangleOverlapsBox(FVector Center, FVector Extent, FVector A, FVector B, FVector C)
+{
+	// Box at the origin
+	A -= Center;
+	B -= Center;
+	C -= Center;
+
+	// Bounds of the triangle against the box
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		if (FMath::Min3(A[Axis], B[Axis], C[Axis]) > Extent[Axis] || FMath::Max3(A[Axis], B[Axis], C[Axis]) < -Extent[Axis])
+			return false;
+	}
+
+	// Plane of the triangle against the box
+	FVector Normal = FVector::CrossProduct(B - A, C - B);
+	if (FMath::Abs(FVector::DotProduct(Normal, A)) > FVector::DotProduct(Extent, Normal.GetAbs()))
+		return false;
+
+	// Cross products of the triangle's edges and the box's axes
+	const FVector Edges[3] = { B - A, C - B, A - C };
+	for (const FVector& Edge : Edges)
+	{
+		const FVector Axes[3] = { FVector(0, -Edge.Z, Edge.Y), FVector(Edge.Z, 0, -Edge.X), FVector(-Edge.Y, Edge.X, 0) };
+		for (const FVector& Axis : Axes)
+		{
+			double PA = FVector::DotProduct(Axis, A), PB = FVector::DotProduct(Axis, B), PC = FVector::DotProduct(Axis, C);
+			double Radius = FVector::DotProduct(Extent, Axis.GetAbs());
+			if (FMath::Min3(PA, PB, PC) > Radius || FMath::Max3(PA, PB, PC) < -Radius)
+				return false;
+		}
+	}
+	return true;
+}
+
+bool UCPathMeshVoxelizerOccupancyProvider::AddPrimitive(const UPrimitiveComponent* Primitive)
+{
+	// Movable primitives are dynamic obstacles or can become ones
+	const UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(Primitive);
+	if (!MeshComponent || MeshComponent->Mobility != EComponentMobility::Static || !MeshComponent->GetStaticMesh())
+		return false;
+
+	UBodySetup* BodySetup = const_cast<UStaticMeshComponent*>(MeshComponent)->GetBodySetup();
+	if (!BodySetup)
+		return false;
+
+	TArray<FTransform> Transforms;
+	if (const UInstancedStaticMeshComponent* Instances = Cast<UInstancedStaticMeshComponent>(MeshComponent))
+	{
+		for (int32 Instance = 0; Instance < Instances->GetInstanceCount(); Instance++)
+		{
+			FTransform Transform;
+			if (Instances->GetInstanceTransform(Instance, Transform, true))
+				Transforms.Add(Transform);
+		}
+	}
+	else
+	{
+		Transforms.Add(MeshComponent->GetComponentTransform());
+	}
+
+	// Queries use simple collision, unless the body only has complex. Complex collision is a surface, there's no inside to fill.
+	if (BodySetup->GetCollisionTraceFlag() == CTF_UseComplexAsSimple)
+	{
+#if WITH_EDITOR
+		UStaticMesh* Mesh = MeshComponent->GetStaticMesh();
+		if (Mesh->ComplexCollisionMesh)
+			Mesh = Mesh->ComplexCollisionMesh;
+
+		FTriMeshCollisionData MeshData;
+		if (!Mesh->ContainsPhysicsTriMeshData(true) || !Mesh->GetPhysicsTriMeshData(&MeshData, true))
+			return false;
+
+		for (const FTransform& Transform : Transforms)
+		{
+			for (const FTriIndices& Indices : MeshData.Indices)
+			{
+				Triangles.push_back({
+					Transform.TransformPosition(FVector(MeshData.Vertices[Indices.v0])),
+					Transform.TransformPosition(FVector(MeshData.Vertices[Indices.v1])),
+					Transform.TransformPosition(FVector(MeshData.Vertices[Indices.v2])) });
+			}
+		}
+		return true;
+#else
+		// Packaged games don't keep the mesh's triangles around, they load baked volumes anyway
+		return false;
+#endif
+	}
+
+	// Spheres, capsules and anything else that isn't made of triangles is left to physics
+	const FKAggregateGeom& Geom = BodySetup->AggGeom;
+	int32 SupportedCount = Geom.BoxElems.Num() + Geom.ConvexElems.Num();
+	if (SupportedCount == 0 || SupportedCount != Geom.GetElementCount())
+		return false;
+
+	for (const FKConvexElem& Convex : Geom.ConvexElems)
+	{
+		if (Convex.VertexData.IsEmpty() || Convex.IndexData.Num() < 12)
+			return false;
+	}
+
+	TArray<FVector> Points;
+	TArray<int32> BoxIndices(BoxTriangleIndices, UE_ARRAY_COUNT(BoxTriangleIndices));
+	for (const FTransform& Transform : Transforms)
+	{
+		// Points go through the element transform and then the primitive's, same as CPathGeometryGather
+		for (const FKBoxElem& Box : Geom.BoxElems)
+		{
+			Points.Reset();
+			FTransform BoxTransform = Box.GetTransform();
+			FVector HalfExtent(Box.X / 2.f, Box.Y / 2.f, Box.Z / 2.f);
+			for (int32 Corner = 0; Corner < 8; Corner++)
+			{
+				FVector Local = HalfExtent * FVector(Corner & 4 ? 1 : -1, Corner & 2 ? 1 : -1, Corner & 1 ? 1 : -1);
+				Points.Add(Transform.TransformPosition(BoxTransform.TransformPosition(Local)));
+			}
+			AddConvex(Points, BoxIndices);
+		}
+
+		for (const FKConvexElem& Convex : Geom.ConvexElems)
+		{
+			Points.Reset();
+			FTransform ConvexTransform = Convex.GetTransform();
+			for (const FVector& Vertex : Convex.VertexData)
+			{
+				Points.Add(Transform.TransformPosition(ConvexTransform.TransformPosition(Vertex)));
+			}
+			AddConvex(Points, Convex.IndexData);
+		}
+	}
+	return true;
+}
+
+void UCPathMeshVoxelizerOccupancyProvider::AddConvex(const TArray<FVector>& Points, const TArray<int32>& Indices)
+{
+	Solid NewSolid;
+	NewSolid.Bounds = FBox(Points);
+	NewSolid.FirstPlane = (uint32)Planes.size();
+
+	// Winding depends on the transform's scale, so planes are turned away from the average point instead, which is always inside
+	FVector Center = FVector::ZeroVector;
+	for (const FVector& Point : Points)
+	{
+		Center += Point;
+	}
+	Center /= Points.Num();
+	for (int32 Index = 0; Index + 2 < Indices.Num(); Index += 3)
+	{
+		const FVector& A = Points[Indices[Index]];
+		const FVector& B = Points[Indices[Index + 1]];
+		const FVector& C = Points[Indices[Index + 2]];
+		Triangles.push_back({ A, B, C });
+
+		FVector Normal = FVector::CrossProduct(B - A, C - A).GetSafeNormal();
+		if (Normal.IsZero())
+			continue;
+
+		FPlane Plane(A, Normal);
+		Planes.push_back(Plane.PlaneDot(Center) > 0 ? Plane.Flip() : Plane);
+	}
+
+	NewSolid.PlaneCount = (uint32)Planes.size() - NewSolid.FirstPlane;
+	Solids.push_back(NewSolid);
+}
+
+void UCPathMeshVoxelizerOccupancyProvider::BuildDilationOffsets(const ACPathVolume* Volume)
+{
+	DilationOffsets.clear();
+	DilationMargin = FIntVector::ZeroValue;
+
+	const double LeafSize = Volume->GetVoxelSizeByDepth(Volume->OctreeDepth);
+	const double Radius = Volume->AgentRadius;
+	const double HalfHeight = Volume->AgentShape == EAgentShape::Sphere ? Radius : FMath::Max(Volume->AgentHalfHeight, Volume->AgentRadius);
+	const FVector AgentExtent(Radius, Radius, Volume->AgentShape == EAgentShape::Box ? Volume->AgentHalfHeight : HalfHeight);
+
+	if (AgentAtDepth[Volume->OctreeDepth])
+	{
+		// A leaf at Offset is touched if the agent's extent reaches its near side
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			DilationMargin[Axis] = FMath::FloorToInt32(AgentExtent[Axis] / LeafSize + 0.5);
+		}
+
+		// Capsules are a vertical segment grown by the radius
+		const double SegmentHalfLength = Volume->AgentShape == EAgentShape::Capsule ? HalfHeight - Radius : 0;
+		for (int32 X = -DilationMargin.X; X <= DilationMargin.X; X++)
+		{
+			for (int32 Y = -DilationMargin.Y; Y <= DilationMargin.Y; Y++)
+			{
+				for (int32 Z = -DilationMargin.Z; Z <= DilationMargin.Z; Z++)
+				{
+					// Distance from the agent's center to the near side of the leaf, per axis
+					FVector Gap = (FVector(FMath::Abs(X), FMath::Abs(Y), FMath::Abs(Z)) - 0.5) * LeafSize;
+					Gap = Gap.ComponentMax(FVector::ZeroVector);
+
+					bool Touches;
+					if (Volume->AgentShape == EAgentShape::Box)
+					{
+						Touches = Gap.X <= AgentExtent.X && Gap.Y <= AgentExtent.Y && Gap.Z <= AgentExtent.Z;
+					}
+					else
+					{
+						Gap.Z = FMath::Max(0.0, Gap.Z - SegmentHalfLength);
+						Touches = Gap.SizeSquared() <= Radius * Radius;
+					}
+
+					if (Touches)
+						DilationOffsets.push_back(FIntVector(X, Y, Z));
+				}
+			}
+		}
+	}
+
+	// Bins need everything the dilation sees, and everything a query box grown by the agent in IsBrickEmpty can touch
+	BinMargin = (FVector(DilationMargin) * LeafSize).ComponentMax(AgentExtent);
+}
+
+void UCPathMeshVoxelizerOccupancyProvider::BuildBins(const ACPathVolume* Volume)
+{
+	TriangleBins.clear();
+	SolidBins.clear();
+
+	auto AddToBins = [this, Volume](std::vector<std::pair<uint32, uint32>>& Bins, const FBox& Bounds, uint32 Index)
+	{
+		FIntVector First, Last;
+		if (!GetOuterRange(Volume, Bounds, First, Last))
+			return;
+
+		for (int32 X = First.X; X <= Last.X; X++)
+		{
+			for (int32 Y = First.Y; Y <= Last.Y; Y++)
+			{
+				for (int32 Z = First.Z; Z <= Last.Z; Z++)
+				{
+					Bins.emplace_back(Volume->LocalCoordsInt3ToIndex(FVector(X, Y, Z)), Index);
+				}
+			}
+		}
+	};
+
+	for (uint32 Index = 0; Index < Triangles.size(); Index++)
+	{
+		const Triangle& Tri = Triangles[Index];
+		AddToBins(TriangleBins, FBox(Tri.A.ComponentMin(Tri.B).ComponentMin(Tri.C), Tri.A.ComponentMax(Tri.B).ComponentMax(Tri.C)), Index);
+	}
+	for (uint32 Index = 0; Index < Solids.size(); Index++)
+	{
+		AddToBins(SolidBins, Solids[Index].Bounds, Index);
+	}
+
+	std::sort(TriangleBins.begin(), TriangleBins.end());
+	std::sort(SolidBins.begin(), SolidBins.end());
+}
+
+bool UCPathMeshVoxelizerOccupancyProvider::GetOuterRange(const ACPathVolume* Volume, const FBox& Box, FIntVector& First, FIntVector& Last) const
+{
+	const double OuterSize = Volume->GetVoxelSizeByDepth(0);
+	const FVector Corner = Volume->StartPosition - FVector(OuterSize / 2.0);
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		int32 Low = FMath::FloorToInt32((Box.Min[Axis] - BinMargin[Axis] - Corner[Axis]) / OuterSize);
+		int32 High = FMath::FloorToInt32((Box.Max[Axis] + BinMargin[Axis] - Corner[Axis]) / OuterSize);
+		if (High < 0 || Low >= (int32)Volume->NodeCount[Axis])
+			return false;
+
+		First[Axis] = FMath::Max(Low, 0);
+		Last[Axis] = FMath::Min(High, (int32)Volume->NodeCount[Axis] - 1);
+	}
+	return true;
+}
+
+uint32 UCPathMeshVoxelizerOccupancyProvider::GetOuterIndex(const ACPathVolume* Volume, FVector OuterLocation) const
+{
+	FVector Coords = (OuterLocation - Volume->StartPosition) / Volume->GetVoxelSizeByDepth(0);
+	return Volume->LocalCoordsInt3ToIndex(FVector(FMath::RoundToDouble(Coords.X), FMath::RoundToDouble(Coords.Y), FMath::RoundToDouble(Coords.Z)));
+}
+
+void UCPathMeshVoxelizerOccupancyProvider::FindBin(const std::vector<std::pair<uint32, uint32>>& Bins, uint32 OuterIndex, const std::pair<uint32, uint32>*& OutBegin, const std::pair<uint32, uint32>*& OutEnd)
+{
+	auto Begin = std::lower_bound(Bins.begin(), Bins.end(), OuterIndex, [](const std::pair<uint32, uint32>& Bin, uint32 Index) { return Bin.first < Index; });
+	auto End = std::upper_bound(Begin, Bins.end(), OuterIndex, [](uint32 Index, const std::pair<uint32, uint32>& Bin) { return Index < Bin.first; });
+	OutBegin = Bins.data() + (Begin - Bins.begin());
+	OutEnd = Bins.data() + (End - Bins.begin());
+}
+
+bool UCPathMeshVoxelizerOccupancyProvider::IsInsideSolid(const Solid& InSolid, FVector Location) const
+{
+	if (!InSolid.Bounds.IsInsideOrOn(Location))
+		return false;
+
+	for (uint32 Index = InSolid.FirstPlane; Index < InSolid.FirstPlane + InSolid.PlaneCount; Index++)
+	{
+		if (Planes[Index].PlaneDot(Location) > 0)
+			return false;
+	}
+	return true;
+}
+
+bool UCPathMeshVoxelizerOccupancyProvider::IsFreeByFallback(const ACPathVolume* Volume, FVector Location, uint32 Depth, const TArray<FBox>& NearbyBounds) const
+{
+	FVector Extent = GetQueryExtent(Volume, Depth);
+	FBox Query(Location - Extent, Location + Extent);
+	bool IsNear = false;
+	for (const FBox& Bounds : NearbyBounds)
+	{
+		if (Bounds.Intersect(Query))
+		{
+			IsNear = true;
+			break;
+		}
+	}
+	if (!IsNear)
+		return true;
+
+	for (const FCollisionShape& Shape : Volume->TraceShapesByDepth[Depth])
+	{
+		if (Volume->GetWorld()->OverlapAnyTestByChannel(Location, FQuat::Identity, Volume->TraceChannel, Shape, FallbackParams))
+			return false;
+	}
+	return true;
+}
+
+void UCPathMeshVoxelizerOccupancyProvider::ApplyFallback(const ACPathVolume* Volume, CPathOccupancyBatch& Batch, uint32 Depth, uint32 X, uint32 Y, uint32 Z, const TArray<FBox>& NearbyBounds) const
+{
+	uint8& Cell = Batch.GetCells(Depth)[CPathOccupancyBatch::GetCellIndex(Depth, X, Y, Z)];
+	if (Cell && !IsFreeByFallback(Volume, Batch.GetCellLocation(Depth, X, Y, Z), Depth, NearbyBounds))
+		Cell = 0;
+
+	// Generators don't go into free trees
+	if (Cell || Depth + 1 >= Batch.GetDepthCount())
+		return;
+
+	for (uint32 Child = 0; Child < 8; Child++)
+	{
+		ApplyFallback(Volume, Batch, Depth + 1, X * 2 + (Child >> 2 & 1), Y * 2 + (Child >> 1 & 1), Z * 2 + (Child & 1), NearbyBounds);
+	}
+}
@@ -0,0 +1,24 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathNodeArena.h"
+
+CPathNodeArena::CPathNodeArena()
+{
+}
+
+CPathNodeArena::~CPathNodeArena()
+{
+}
+
+CPathAStarNode* CPathNodeArena::Add(const CPathAStarNode& Node, uint32& OutIndex)
+{
+	if (Count >= Capacity())
+	{
+		Chunks.push_back(std::make_unique<CPathAStarNode[]>(ChunkSize));
+	}
+
+	OutIndex = Count++;
+	CPathAStarNode* NewNode = &(*this)[OutIndex];
+	*NewNode = Node;
+	return NewNode;
+}
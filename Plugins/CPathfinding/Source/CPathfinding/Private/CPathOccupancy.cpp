@@ -0,0 +1,216 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathOccupancy.h"
+
+CPathOccupancy::CPathOccupancy()
+{
+}
+
+CPathOccupancy::~CPathOccupancy()
+{
+}
+
+void CPathOccupancy::Init(uint32 BrickCount, uint32 OctreeDepth)
+{
+	checkf(OctreeDepth <= MAX_DEPTH, TEXT("CPATH - Occupancy:::DEPTH can be up to MAX_DEPTH"));
+
+	DenseDepth = FMath::Min(OctreeDepth, MaxDenseDepth);
+	SlotsPerOuter = SlotOffsetByDepth(DenseDepth + 1);
+	WordsPerOuter = (SlotsPerOuter + 63) / 64;
+
+	// Subtrees of a depth 3 tree, without the tree itself
+	SlotsPerBlock = OctreeDepth > MaxDenseDepth ? SlotOffsetByDepth(OctreeDepth - MaxDenseDepth + 1) - 1 : 0;
+	WordsPerBlock = (SlotsPerBlock + 63) / 64;
+
+	Bricks.clear();
+	Bricks.resize(BrickCount);
+}
+
+void CPathOccupancy::Clear()
+{
+	Bricks.clear();
+	Bricks.shrink_to_fit();
+}
+
+void CPathOccupancy::AllocateBrick(uint32 BrickIndex)
+{
+	Brick& CurrBrick = Bricks[BrickIndex];
+	CurrBrick.Bits = std::make_unique<uint64[]>((size_t)CPathBrickMap::TreesPerBrick * WordsPerOuter);
+	CurrBrick.UserData = std::make_unique<std::unique_ptr<uint32[]>[]>(CPathBrickMap::TreesPerBrick);
+	if (SlotsPerBlock)
+		CurrBrick.Deep = std::make_unique<std::unique_ptr<DeepOuter>[]>(CPathBrickMap::TreesPerBrick);
+}
+
+void CPathOccupancy::ReleaseBrick(uint32 BrickIndex)
+{
+	Bricks[BrickIndex].Bits.reset();
+	Bricks[BrickIndex].UserData.reset();
+	Bricks[BrickIndex].Deep.reset();
+}
+
+uint32 CPathOccupancy::GetData(uint64 OuterSlot, CPathTreeID TreeID) const
+{
+	uint32 Depth = GetDepth(TreeID);
+	uint32 UserData = 0;
+	if (Depth > DenseDepth)
+	{
+		const DeepOuter* Deep = FindDeep(OuterSlot);
+		uint32 Block = Deep ? Deep->BlockByParent[GetDeepParent(TreeID)] : 0;
+		if (Block && !Deep->UserData.empty())
+			UserData = Deep->UserData[(size_t)(Block - 1) * SlotsPerBlock + GetDeepSlot(TreeID, Depth)];
+	}
+	else
+	{
+		const std::unique_ptr<uint32[]>& OuterUserData = Bricks[OuterSlot / CPathBrickMap::TreesPerBrick].UserData[OuterSlot % CPathBrickMap::TreesPerBrick];
+		if (OuterUserData)
+			UserData = OuterUserData[GetSlot(TreeID, Depth)];
+	}
+	return (UserData & 0xFFFFFFFE) | (uint32)IsFree(OuterSlot, TreeID);
+}
+
+void CPathOccupancy::SetUserData(uint64 OuterSlot, CPathTreeID TreeID, uint32 Data)
+{
+	Data &= 0xFFFFFFFE;
+	uint32 Depth = GetDepth(TreeID);
+	if (Depth > DenseDepth)
+	{
+		if (!Data)
+		{
+			const DeepOuter* Deep = FindDeep(OuterSlot);
+			if (!Deep || Deep->UserData.empty() || !Deep->BlockByParent[GetDeepParent(TreeID)])
+				return;
+		}
+
+		DeepOuter& Deep = GetOrAddDeep(OuterSlot);
+		uint32 Block = GetOrAddDeepBlock(Deep, TreeID);
+		if (Deep.UserData.empty())
+			Deep.UserData.resize((size_t)Deep.BlockCount * SlotsPerBlock, 0);
+		Deep.UserData[(size_t)(Block - 1) * SlotsPerBlock + GetDeepSlot(TreeID, Depth)] = Data;
+		return;
+	}
+
+	std::unique_ptr<uint32[]>& OuterUserData = Bricks[OuterSlot / CPathBrickMap::TreesPerBrick].UserData[OuterSlot % CPathBrickMap::TreesPerBrick];
+	if (!OuterUserData)
+	{
+		if (!Data)
+			return;
+
+		// Only trees up to DenseDepth, deeper ones have their own tables
+		OuterUserData = std::make_unique<uint32[]>(SlotsPerOuter);
+	}
+	OuterUserData[GetSlot(TreeID, Depth)] = Data;
+}
+
+CPathOccupancy::DeepOuter& CPathOccupancy::GetOrAddDeep(uint64 OuterSlot)
+{
+	std::unique_ptr<DeepOuter>& Deep = Bricks[OuterSlot / CPathBrickMap::TreesPerBrick].Deep[OuterSlot % CPathBrickMap::TreesPerBrick];
+	if (!Deep)
+		Deep = std::make_unique<DeepOuter>();
+	return *Deep;
+}
+
+uint32 CPathOccupancy::GetOrAddDeepBlock(DeepOuter& Deep, CPathTreeID TreeID)
+{
+	uint16& Block = Deep.BlockByParent[GetDeepParent(TreeID)];
+	if (!Block)
+	{
+		// Blocks stay until the brick is released, a depth 3 tree that subdivided once will likely do it again
+		Block = (uint16)++Deep.BlockCount;
+		Deep.Bits.resize((size_t)Deep.BlockCount * WordsPerBlock, 0);
+		if (!Deep.UserData.empty())
+			Deep.UserData.resize((size_t)Deep.BlockCount * SlotsPerBlock, 0);
+	}
+	return Block;
+}
+
+void CPathOccupancy::SerializeBrick(FArchive& Ar, uint32 BrickIndex)
+{
+	Brick& CurrBrick = Bricks[BrickIndex];
+	Ar.Serialize(CurrBrick.Bits.get(), (int64)CPathBrickMap::TreesPerBrick * WordsPerOuter * sizeof(uint64));
+
+	for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick; LocalIndex++)
+	{
+		std::unique_ptr<uint32[]>& OuterUserData = CurrBrick.UserData[LocalIndex];
+		uint8 HasUserData = OuterUserData != nullptr;
+		Ar << HasUserData;
+		if (HasUserData)
+		{
+			if (Ar.IsLoading())
+				OuterUserData = std::make_unique<uint32[]>(SlotsPerOuter);
+			Ar.Serialize(OuterUserData.get(), (int64)SlotsPerOuter * sizeof(uint32));
+		}
+
+		if (SlotsPerBlock)
+			SerializeDeep(Ar, CurrBrick.Deep[LocalIndex]);
+	}
+}
+
+void CPathOccupancy::SerializeDeep(FArchive& Ar, std::unique_ptr<DeepOuter>& Deep)
+{
+	uint8 HasDeep = Deep != nullptr;
+	Ar << HasDeep;
+	if (!HasDeep)
+		return;
+
+	if (Ar.IsLoading())
+		Deep = std::make_unique<DeepOuter>();
+
+	Ar << Deep->BlockCount;
+	if (Deep->BlockCount > DeepParentCount)
+	{
+		Ar.SetError();
+		Deep->BlockCount = 0;
+		return;
+	}
+	Ar.Serialize(Deep->BlockByParent, sizeof(Deep->BlockByParent));
+	for (uint16 Block : Deep->BlockByParent)
+	{
+		if (Block > Deep->BlockCount)
+		{
+			Ar.SetError();
+			FMemory::Memzero(Deep->BlockByParent, sizeof(Deep->BlockByParent));
+			Deep->BlockCount = 0;
+			return;
+		}
+	}
+
+	uint8 HasUserData = !Deep->UserData.empty();
+	Ar << HasUserData;
+	if (Ar.IsLoading())
+	{
+		Deep->Bits.assign((size_t)Deep->BlockCount * WordsPerBlock, 0);
+		if (HasUserData)
+			Deep->UserData.assign((size_t)Deep->BlockCount * SlotsPerBlock, 0);
+	}
+	Ar.Serialize(Deep->Bits.data(), (int64)Deep->Bits.size() * sizeof(uint64));
+	if (HasUserData)
+		Ar.Serialize(Deep->UserData.data(), (int64)Deep->UserData.size() * sizeof(uint32));
+}
+
+int64 CPathOccupancy::GetAllocatedBytes() const
+{
+	int64 Bytes = (int64)Bricks.size() * sizeof(Brick);
+	for (const Brick& CurrBrick : Bricks)
+	{
+		if (!CurrBrick.Bits)
+			continue;
+
+		Bytes += (int64)CPathBrickMap::TreesPerBrick * (WordsPerOuter * sizeof(uint64) + sizeof(std::unique_ptr<uint32[]>));
+		for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick; LocalIndex++)
+		{
+			if (CurrBrick.UserData[LocalIndex])
+				Bytes += SlotsPerOuter * sizeof(uint32);
+		}
+
+		if (!CurrBrick.Deep)
+			continue;
+
+		Bytes += (int64)CPathBrickMap::TreesPerBrick * sizeof(std::unique_ptr<DeepOuter>);
+		for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick; LocalIndex++)
+		{
+			if (const DeepOuter* Deep = CurrBrick.Deep[LocalIndex].get())
+				Bytes += sizeof(DeepOuter) + Deep->Bits.capacity() * sizeof(uint64) + Deep->UserData.capacity() * sizeof(uint32);
+		}
+	}
+	return Bytes;
+}
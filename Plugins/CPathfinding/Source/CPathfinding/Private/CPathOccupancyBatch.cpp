@@ -0,0 +1,37 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathOccupancyBatch.h"
+#include "CPathVolume.h"
+
+CPathOccupancyBatch::CPathOccupancyBatch()
+{
+}
+
+CPathOccupancyBatch::~CPathOccupancyBatch()
+{
+}
+
+void CPathOccupancyBatch::Init(const ACPathVolume* Volume, FVector OuterLocation)
+{
+	Min = OuterLocation - FVector(Volume->GetVoxelSizeByDepth(0) / 2.f);
+
+	// Vectors keep their capacity, so after the first tree this only clears
+	FreeByDepth.resize(Volume->OctreeDepth + 1);
+	for (uint32 Depth = 0; Depth < FreeByDepth.size(); Depth++)
+	{
+		CellSizeByDepth[Depth] = Volume->GetVoxelSizeByDepth(Depth);
+		uint32 Resolution = GetResolution(Depth);
+		FreeByDepth[Depth].assign(Resolution * Resolution * Resolution, 0);
+	}
+}
+
+bool CPathOccupancyBatch::IsFree(FVector Location, uint32 Depth) const
+{
+	// Locations are cell centers, so flooring never lands on a border
+	FVector Local = (Location - Min) / CellSizeByDepth[Depth];
+	int32 Last = GetResolution(Depth) - 1;
+	uint32 X = FMath::Clamp(FMath::FloorToInt32(Local.X), 0, Last);
+	uint32 Y = FMath::Clamp(FMath::FloorToInt32(Local.Y), 0, Last);
+	uint32 Z = FMath::Clamp(FMath::FloorToInt32(Local.Z), 0, Last);
+	return FreeByDepth[Depth][GetCellIndex(Depth, X, Y, Z)];
+}
@@ -0,0 +1,31 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathOccupancyProvider.h"
+#include "CPathVolume.h"
+
+bool UCPathOccupancyProvider::IsFree(const ACPathVolume* Volume, FVector Location, uint32 Depth) const
+{
+	return IsBoxEmpty(Volume, Location, GetQueryExtent(Volume, Depth));
+}
+
+uint32 UCPathOccupancyProvider::GetBakeHash() const
+{
+	return GetTypeHash(GetClass()->GetFName());
+}
+
+FVector UCPathOccupancyProvider::GetQueryExtent(const ACPathVolume* Volume, uint32 Depth)
+{
+	// Bounding box of the agent shape, so a bit more than physics checks at the corners of capsules and spheres
+	FVector AgentExtent(Volume->AgentRadius, Volume->AgentRadius, Volume->AgentShape == EAgentShape::Sphere ? Volume->AgentRadius : Volume->AgentHalfHeight);
+	return FVector(Volume->GetVoxelSizeByDepth(Depth) / 2.f).ComponentMax(AgentExtent);
+}
+
+bool UCPathPhysicsOccupancyProvider::IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const
+{
+	return Volume->IsBoxEmptyByPhysics(Center, Extent);
+}
+
+bool UCPathPhysicsOccupancyProvider::IsFree(const ACPathVolume* Volume, FVector Location, uint32 Depth) const
+{
+	return Volume->IsLocationFreeByPhysics(Location, Depth);
+}
@@ -0,0 +1,108 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathOctreeAllocator.h"
+#include "CPathOctree.h"
+#include "Misc/ScopeLock.h"
+
+CPathOctreeAllocator::CPathOctreeAllocator()
+{
+}
+
+CPathOctreeAllocator::~CPathOctreeAllocator()
+{
+	Clear();
+}
+
+CPathOctree* CPathOctreeAllocator::Allocate(LocalCache& Cache)
+{
+	if (Cache.FreeBlocks.empty())
+	{
+		Refill(Cache);
+	}
+
+	CPathOctree* Block = Cache.FreeBlocks.back();
+	Cache.FreeBlocks.pop_back();
+	Cache.BlocksInUseDelta++;
+
+	for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+	{
+		Block[ChildIndex].Children = nullptr;
+	}
+	return Block;
+}
+
+void CPathOctreeAllocator::Free(CPathOctree* Block, LocalCache& Cache)
+{
+	for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+	{
+		if (Block[ChildIndex].Children)
+		{
+			Free(Block[ChildIndex].Children, Cache);
+			Block[ChildIndex].Children = nullptr;
+		}
+	}
+	FreeBlock(Block, Cache);
+}
+
+void CPathOctreeAllocator::FreeBlock(CPathOctree* Block, LocalCache& Cache)
+{
+	Cache.FreeBlocks.push_back(Block);
+	Cache.BlocksInUseDelta--;
+
+	// Not letting one thread hoard blocks that others could use
+	if (Cache.FreeBlocks.size() >= BatchSize * 2)
+	{
+		FScopeLock Lock(&Mutex);
+		FreeBlocks.insert(FreeBlocks.end(), Cache.FreeBlocks.end() - BatchSize, Cache.FreeBlocks.end());
+		Cache.FreeBlocks.resize(Cache.FreeBlocks.size() - BatchSize);
+	}
+}
+
+void CPathOctreeAllocator::Flush(LocalCache& Cache)
+{
+	BlocksInUse += Cache.BlocksInUseDelta;
+	Cache.BlocksInUseDelta = 0;
+
+	if (Cache.FreeBlocks.empty())
+		return;
+
+	FScopeLock Lock(&Mutex);
+	FreeBlocks.insert(FreeBlocks.end(), Cache.FreeBlocks.begin(), Cache.FreeBlocks.end());
+	Cache.FreeBlocks.clear();
+}
+
+void CPathOctreeAllocator::Clear()
+{
+	FScopeLock Lock(&Mutex);
+	FreeBlocks.clear();
+	FreeBlocks.shrink_to_fit();
+	Slabs.clear();
+	SlabCount.store(0);
+	BlocksInUse.store(0);
+}
+
+void CPathOctreeAllocator::Refill(LocalCache& Cache)
+{
+	// Good moment to update the counter, this is called once per BatchSize allocations
+	BlocksInUse += Cache.BlocksInUseDelta;
+	Cache.BlocksInUseDelta = 0;
+
+	FScopeLock Lock(&Mutex);
+	if (FreeBlocks.empty())
+	{
+		Slabs.emplace_back(new CPathOctree[SlabBlockCount * 8]);
+		SlabCount++;
+
+		CPathOctree* Slab = Slabs.back().get();
+		FreeBlocks.reserve(FreeBlocks.size() + SlabBlockCount);
+		// Reversed, so that blocks are handed out in memory order
+		for (int32 BlockIndex = SlabBlockCount - 1; BlockIndex >= 0; BlockIndex--)
+		{
+			FreeBlocks.push_back(Slab + BlockIndex * 8);
+		}
+	}
+
+	uint32 Count = FMath::Min((uint32)FreeBlocks.size(), BatchSize);
+	Cache.FreeBlocks.insert(Cache.FreeBlocks.end(), FreeBlocks.end() - Count, FreeBlocks.end());
+	FreeBlocks.resize(FreeBlocks.size() - Count);
+}
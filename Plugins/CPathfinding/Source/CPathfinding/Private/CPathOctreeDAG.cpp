@@ -0,0 +1,155 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathOctreeDAG.h"
+#include "CPathVolume.h"
+#include "CPathOctree.h"
+#include <unordered_set>
+
+CPathOctreeDAG::CPathOctreeDAG()
+{
+}
+
+CPathOctreeDAG::~CPathOctreeDAG()
+{
+}
+
+// Blocks are equal if all 8 children have the same (already merged) Children. IsFree and user data are in CPathOccupancy, so only the structure matters.
+struct CPathBlockHash
+{
+	size_t operator()(const CPathOctree* Block) const
+	{
+		size_t Hash = 0;
+		for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+		{
+			Hash = Hash * 0x100000001B3ull ^ (size_t)Block[ChildIndex].Children;
+		}
+		return Hash;
+	}
+};
+
+struct CPathBlockEqual
+{
+	bool operator()(const CPathOctree* A, const CPathOctree* B) const
+	{
+		for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+		{
+			if (A[ChildIndex].Children != B[ChildIndex].Children)
+				return false;
+		}
+		return true;
+	}
+};
+
+typedef std::unordered_set<CPathOctree*, CPathBlockHash, CPathBlockEqual> CPathBlockSet;
+
+// Bottom up, so that when a block is compared, its children already point to merged blocks
+static void MergeBlocks(CPathOctree* Tree, CPathBlockSet& UniqueBlocks, CPathOctreeAllocator& Allocator, CPathOctreeAllocator::LocalCache& Cache, uint32& MergedCount)
+{
+	if (!Tree->Children)
+		return;
+
+	for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+	{
+		MergeBlocks(&Tree->Children[ChildIndex], UniqueBlocks, Allocator, Cache, MergedCount);
+	}
+
+	auto Inserted = UniqueBlocks.insert(Tree->Children);
+	if (!Inserted.second)
+	{
+		// Its children are the same merged blocks as the existing one has, so only this block is freed
+		Allocator.FreeBlock(Tree->Children, Cache);
+		Tree->Children = *Inserted.first;
+		MergedCount++;
+	}
+}
+
+// Each block is counted once per parent, blocks below a shared block are only walked the first time it's reached
+static void CountReferences(const CPathOctree* Tree, std::unordered_map<const CPathOctree*, uint32>& RefCounts)
+{
+	if (!Tree->Children)
+		return;
+
+	if (++RefCounts[Tree->Children] > 1)
+		return;
+
+	for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+	{
+		CountReferences(&Tree->Children[ChildIndex], RefCounts);
+	}
+}
+
+// Tree is already private, its Children block gets copied if another parent still points to it
+static void MakeBlocksPrivate(CPathOctree* Tree, std::unordered_map<const CPathOctree*, uint32>& RefCounts, CPathOctreeAllocator& Allocator, CPathOctreeAllocator::LocalCache& Cache)
+{
+	if (!Tree->Children)
+		return;
+
+	auto Found = RefCounts.find(Tree->Children);
+	if (Found != RefCounts.end() && Found->second > 0)
+	{
+		// If no other parent is left, this tree keeps the original block
+		if (--Found->second > 0)
+		{
+			// The copy points to the same children, so they get one more parent
+			CPathOctree* Copy = Allocator.Allocate(Cache);
+			for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+			{
+				Copy[ChildIndex].Children = Tree->Children[ChildIndex].Children;
+				if (Copy[ChildIndex].Children)
+				{
+					RefCounts[Copy[ChildIndex].Children]++;
+				}
+			}
+			Tree->Children = Copy;
+		}
+	}
+
+	for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+	{
+		MakeBlocksPrivate(&Tree->Children[ChildIndex], RefCounts, Allocator, Cache);
+	}
+}
+
+void CPathOctreeDAG::Compact(ACPathVolume* Volume)
+{
+	uint32 OuterCount = Volume->GetOuterTreeCount();
+	CPathBlockSet UniqueBlocks;
+	CPathOctreeAllocator::LocalCache Cache;
+
+	for (uint32 OuterIndex = 0; OuterIndex < OuterCount; OuterIndex++)
+	{
+		MergeBlocks(Volume->GetOuterTree(OuterIndex), UniqueBlocks, Volume->OctreeAllocator, Cache, MergedBlockCount);
+	}
+	Volume->OctreeAllocator.Flush(Cache);
+
+	RefCounts.clear();
+	for (uint32 OuterIndex = 0; OuterIndex < OuterCount; OuterIndex++)
+	{
+		CountReferences(Volume->GetOuterTree(OuterIndex), RefCounts);
+	}
+
+	IsPrivate.assign(OuterCount, 0);
+	bIsCompacted = true;
+}
+
+void CPathOctreeDAG::MakePrivate(ACPathVolume* Volume, uint32 OuterIndex, CPathOctreeAllocator::LocalCache& Cache)
+{
+	if (!bIsCompacted || IsPrivate[OuterIndex])
+		return;
+
+	// Shared blocks are left as they are, other trees may still use them
+	{
+		FScopeLock Lock(&Mutex);
+		MakeBlocksPrivate(Volume->GetOuterTree(OuterIndex), RefCounts, Volume->OctreeAllocator, Cache);
+	}
+	IsPrivate[OuterIndex] = 1;
+}
+
+void CPathOctreeDAG::Clear()
+{
+	bIsCompacted = false;
+	MergedBlockCount = 0;
+	IsPrivate.clear();
+	IsPrivate.shrink_to_fit();
+	RefCounts.clear();
+}
@@ -0,0 +1,101 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathOpenList.h"
+
+CPathOpenList::CPathOpenList()
+{
+}
+
+CPathOpenList::~CPathOpenList()
+{
+}
+
+void CPathOpenList::Push(uint32 NodeIndex, float Fitness)
+{
+	if (NodeIndex >= PositionByNode.size())
+	{
+		PositionByNode.resize(FMath::Max((size_t)NodeIndex + 1, PositionByNode.size() * 2));
+	}
+
+	Heap.push_back({ Fitness, NodeIndex });
+	PositionByNode[NodeIndex] = (uint32)Heap.size() - 1;
+	SiftUp((uint32)Heap.size() - 1);
+}
+
+void CPathOpenList::PushOrDecrease(uint32 NodeIndex, float Fitness)
+{
+	if (!Contains(NodeIndex))
+	{
+		Push(NodeIndex, Fitness);
+		return;
+	}
+
+	uint32 Position = PositionByNode[NodeIndex];
+	if (Fitness < Heap[Position].Fitness)
+	{
+		Heap[Position].Fitness = Fitness;
+		SiftUp(Position);
+	}
+}
+
+uint32 CPathOpenList::Pop()
+{
+	checkf(!Heap.empty(), TEXT("CPATH - OpenList:::Pop called on an empty list"));
+
+	uint32 Top = Heap[0].NodeIndex;
+	Entry Last = Heap.back();
+	Heap.pop_back();
+
+	if (!Heap.empty())
+	{
+		Place(Last, 0);
+		SiftDown(0);
+	}
+
+	// Making sure that Contains(Top) returns false, even if another node takes its old position
+	PositionByNode[Top] = 0xFFFFFFFF;
+	return Top;
+}
+
+void CPathOpenList::SiftUp(uint32 Position)
+{
+	Entry Moved = Heap[Position];
+	while (Position > 0)
+	{
+		uint32 Parent = (Position - 1) / Arity;
+		if (Heap[Parent].Fitness <= Moved.Fitness)
+			break;
+
+		Place(Heap[Parent], Position);
+		Position = Parent;
+	}
+	Place(Moved, Position);
+}
+
+void CPathOpenList::SiftDown(uint32 Position)
+{
+	Entry Moved = Heap[Position];
+	uint32 Size = (uint32)Heap.size();
+	while (true)
+	{
+		uint32 FirstChild = Position * Arity + 1;
+		if (FirstChild >= Size)
+			break;
+
+		// Finding the child with the lowest fitness
+		uint32 BestChild = FirstChild;
+		uint32 LastChild = FMath::Min(FirstChild + Arity, Size);
+		for (uint32 Child = FirstChild + 1; Child < LastChild; Child++)
+		{
+			if (Heap[Child].Fitness < Heap[BestChild].Fitness)
+				BestChild = Child;
+		}
+
+		if (Moved.Fitness <= Heap[BestChild].Fitness)
+			break;
+
+		Place(Heap[BestChild], Position);
+		Position = BestChild;
+	}
+	Place(Moved, Position);
+}
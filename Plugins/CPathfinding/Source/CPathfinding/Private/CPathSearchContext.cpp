@@ -0,0 +1,25 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathSearchContext.h"
+
+CPathSearchContext::CPathSearchContext()
+{
+}
+
+CPathSearchContext::CPathSearchContext(const FCPathRequest& InRequest)
+	:
+	Request(InRequest)
+{
+}
+
+CPathSearchContext::~CPathSearchContext()
+{
+}
+
+void CPathSearchContext::Reset(const FCPathRequest& InRequest)
+{
+	Request = InRequest;
+	bStarted = false;
+	SearchedTime = 0;
+	RestartCount = 0;
+}
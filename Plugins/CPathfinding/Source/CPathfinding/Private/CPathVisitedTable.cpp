@@ -0,0 +1,79 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathVisitedTable.h"
+
+CPathVisitedTable::CPathVisitedTable(uint32 InitialCapacity)
+{
+	Allocate(FMath::RoundUpToPowerOfTwo(FMath::Max(InitialCapacity, (uint32)16)));
+}
+
+CPathVisitedTable::~CPathVisitedTable()
+{
+}
+
+bool CPathVisitedTable::Add(CPathTreeID TreeID, uint32 NodeIndex)
+{
+	Slot& CurrSlot = FindSlot(TreeID);
+	if (CurrSlot.Generation == CurrentGeneration)
+		return false;
+
+	CurrSlot.TreeID = TreeID;
+	CurrSlot.NodeIndex = NodeIndex;
+	CurrSlot.Generation = CurrentGeneration;
+
+	// Keeping the load factor under 0.5, linear probing gets slow above that
+	if (++Count * 2 > Slots.size())
+		Grow();
+	return true;
+}
+
+void CPathVisitedTable::Set(CPathTreeID TreeID, uint32 NodeIndex)
+{
+	if (!Add(TreeID, NodeIndex))
+	{
+		FindSlot(TreeID).NodeIndex = NodeIndex;
+	}
+}
+
+void CPathVisitedTable::Reset()
+{
+	Count = 0;
+	CurrentGeneration++;
+
+	// After ~4 billion searches the generation wraps around, and old slots could look valid
+	if (CurrentGeneration == 0)
+	{
+		for (Slot& CurrSlot : Slots)
+		{
+			CurrSlot.Generation = 0;
+		}
+		CurrentGeneration = 1;
+	}
+}
+
+void CPathVisitedTable::Allocate(uint32 Capacity)
+{
+	Slots.assign(Capacity, Slot());
+	SlotMask = Capacity - 1;
+	HashShift = 32 - FMath::FloorLog2(Capacity);
+}
+
+void CPathVisitedTable::Grow()
+{
+	std::vector<Slot> OldSlots;
+	OldSlots.swap(Slots);
+	uint32 OldGeneration = CurrentGeneration;
+
+	Allocate((uint32)OldSlots.size() * 2);
+	CurrentGeneration = 1;
+
+	for (const Slot& OldSlot : OldSlots)
+	{
+		if (OldSlot.Generation == OldGeneration)
+		{
+			Slot& NewSlot = FindSlot(OldSlot.TreeID);
+			NewSlot = OldSlot;
+			NewSlot.Generation = CurrentGeneration;
+		}
+	}
+}
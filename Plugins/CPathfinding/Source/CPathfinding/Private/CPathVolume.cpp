@@ -14,9 +14,23 @@
 #include "CPathNode.h"
 #include "TimerManager.h"
 #include "CPathFindPath.h"
+#include "CPathVisitedTable.h"
 #include "CPathCore.h"
 #include "Engine/World.h"
 #include "GenericPlatform/GenericPlatformAtomics.h"
+#include "Misc/ScopeLock.h"
+#include "CPathBakedVolumeData.h"
+#include "CPathGeometryGather.h"
+#include "CPathOccupancyBatch.h"
+#include "CPathOccupancyProvider.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Memory/MemoryView.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/OverlapResult.h"
+#include "Async/ParallelFor.h"
+#include "Async/Async.h"
 
 
 
@@ -34,7 +48,7 @@ ACPathVolume::ACPathVolume()
 
 
 #endif
-	DepthsToDraw = { true, true, true, true };
+	DepthsToDraw.Init(true, MAX_DEPTH + 1);
 
 
 	FVector Location = GetActorLocation() - VolumeBox->GetScaledBoxExtent() + VoxelSize;
@@ -44,7 +58,7 @@ ACPathVolume::ACPathVolume()
 
 void ACPathVolume::DebugDrawNeighbours(FVector WorldLocation)
 {
-	uint32 LeafID;
+	CPathTreeID LeafID;
 	if (FindLeafByWorldLocation(WorldLocation, LeafID))
 	{
 		DrawDebugBox(GetWorld(), WorldLocationFromTreeID(LeafID), FVector(GetVoxelSizeByDepth(ExtractDepth(LeafID)) / 2.f), FColor::Emerald, false, 5, 10, DebugBoxesThickness*1.3);
@@ -57,7 +71,7 @@ void ACPathVolume::DebugDrawNeighbours(FVector WorldLocation)
 	}
 }
 
-bool ACPathVolume::DrawDebugVoxel(uint32 TreeID, bool DrawIfNotLeaf, float Duration, FColor Color, CPathVoxelDrawData* OutDrawData)
+bool ACPathVolume::DrawDebugVoxel(CPathTreeID TreeID, bool DrawIfNotLeaf, float Duration, FColor Color, CPathVoxelDrawData* OutDrawData)
 {
 
 	uint32 Depth;
@@ -65,7 +79,9 @@ bool ACPathVolume::DrawDebugVoxel(uint32 TreeID, bool DrawIfNotLeaf, float Durat
 	auto Tree = FindTreeByID(TreeID, Depth);
 	if (Tree->Children && !DrawIfNotLeaf)
 		return false;
-	bool IsFree = Tree->GetIsFree();
+	CPathTreeID FoundTreeID = TreeID;
+	ReplaceDepth(FoundTreeID, Depth);
+	bool IsFree = IsTreeFree(FoundTreeID);
 	if (IsFree)
 	{
 		if (!DrawFree)
@@ -87,7 +103,8 @@ bool ACPathVolume::DrawDebugVoxel(uint32 TreeID, bool DrawIfNotLeaf, float Durat
 	if (Duration < 0)
 		Persistent = true;
 
-	if (DepthsToDraw[Depth])
+	// Volumes saved before deeper octrees have fewer entries
+	if (!DepthsToDraw.IsValidIndex(Depth) || DepthsToDraw[Depth])
 	{
 		float Extent = GetVoxelSizeByDepth(ExtractDepth(TreeID)) / 2.f;
 		FVector Location = WorldLocationFromTreeID(TreeID);
@@ -135,13 +152,13 @@ void ACPathVolume::DrawDebugNodesAroundLocation(FVector WorldLocation, int Voxel
 	}
 	PreviousDrawAroundLocationData.clear();
 
-	uint32 OriginTreeID = 0xFFFFFFFF;
+	CPathTreeID OriginTreeID = INVALID_TREE_ID;
 	CPathOctree* OriginTree = FindLeafByWorldLocation(WorldLocation, OriginTreeID, false);
 	if (!OriginTree)
 		return;
 
-	std::list<uint32> IndexList;
-	std::unordered_set<uint32> VisitedIndexes;
+	std::list<CPathTreeID> IndexList;
+	std::unordered_set<CPathTreeID> VisitedIndexes;
 
 	CPathAStarNode StartNode(OriginTreeID);
 	StartNode.FitnessResult = 0;
@@ -152,9 +169,10 @@ void ACPathVolume::DrawDebugNodesAroundLocation(FVector WorldLocation, int Voxel
 
 
 
+	std::vector<CPathTreeID> Neighbours;
 	while (!IndexList.empty() && VoxelLimit > 0)
 	{
-		uint32 CurrID = IndexList.front();
+		CPathTreeID CurrID = IndexList.front();
 		IndexList.pop_front();
 		CPathVoxelDrawData DrawData;
 		if (DrawDebugVoxel(CurrID, true, Duration, FColor::Green, &DrawData))
@@ -164,8 +182,8 @@ void ACPathVolume::DrawDebugNodesAroundLocation(FVector WorldLocation, int Voxel
 		}
 
 
-		std::vector<uint32> Neighbours = FindNeighbourLeafs(CurrID, !DrawOccupied);
-		for (uint32 NewTreeID : Neighbours)
+		FindNeighbourLeafs(CurrID, Neighbours, !DrawOccupied);
+		for (CPathTreeID NewTreeID : Neighbours)
 		{
 
 			// We dont want to redraw nodes
@@ -190,6 +208,17 @@ void ACPathVolume::DrawDebugPath(const TArray<FCPathNode>& Path, float Duration,
 }
 
 
+#if WITH_EDITOR
+void ACPathVolume::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	// UPROPERTY meta can't read MAX_DEPTH, so the 32 bit build clamps here
+	if (PropertyChangedEvent.GetPropertyName() == GET_MEMBER_NAME_CHECKED(ACPathVolume, OctreeDepth))
+		OctreeDepth = FMath::Clamp(OctreeDepth, 0, MAX_DEPTH);
+}
+#endif
+
 void ACPathVolume::BeginPlay()
 {
 	Super::BeginPlay();
@@ -211,6 +240,298 @@ bool ACPathVolume::GenerateGraph()
 {
 	GenerationStarted = true;
 	PrintGenerationTime = true;
+	PathCache.SetCapacity(PathCacheSize);
+	InitGeneration();
+
+	// If we use all logical threads in the system, the rest of the game
+	// will have no computing power to work with. From my small test sample
+	// Using hyper threads barely increased performance so its not worth it
+	/*if (FPlatformMisc::NumberOfCoresIncludingHyperthreads() > FPlatformMisc::NumberOfCores())
+		ThreadCount = FPlatformMisc::NumberOfCores() + (FPlatformMisc::NumberOfCoresIncludingHyperthreads() - FPlatformMisc::NumberOfCores()) / 3;
+	else
+		ThreadCount = FPlatformMisc::NumberOfCores() - 1;*/
+	if (MaxGenerationThreads <= 0)
+		MaxGenerationThreads = FPlatformMisc::NumberOfCores() - 1;
+	
+	MaxGenerationThreads = FMath::Min(MaxGenerationThreads, 31);
+
+	// Tuned for depth up to 3, deeper trees just get fewer outer trees per thread
+	OuterIndexesPerThread = FMath::Max(1.f, 5 * (5 + OctreeDepth) * FMath::Pow(8.f, 3 - OctreeDepth));
+
+	// Baked graph replaces the whole initial generation, dynamic obstacles update on top of it as usual
+	if (BakedData && LoadBakedGraph())
+	{
+		BuildDerivedData();
+		FinishInitialGeneration();
+		return true;
+	}
+
+	// Initial generation is split by bricks, so that a worker can skip a whole empty brick with one overlap test.
+	// FinishInitialGeneration is called by the job, instead of polling for generators to finish.
+	std::shared_ptr<CPathGenerationJob> Job = std::make_shared<CPathGenerationJob>();
+	Job->Volume = this;
+	Job->ItemCount = BrickMap.GetBrickCount();
+	Job->MaxWorkers = MaxGenerationThreads;
+	StartGenerationJob(std::move(Job));
+	return true;
+}
+
+#if WITH_EDITOR
+bool ACPathVolume::BakeGraph()
+{
+	if (GenerationStarted || !GetWorld())
+		return false;
+
+	// BeginPlay doesn't run in the editor, without this every generation query would hit the volume itself.
+	// Providers gather geometry in InitGeneration already, so it has to be set before it.
+	ECollisionResponse VolumeBoxResponse = VolumeBox->GetCollisionResponseToChannel(TraceChannel);
+	VolumeBox->SetCollisionResponseToChannel(TraceChannel, ECR_Ignore);
+
+	InitGeneration();
+
+	// Same job as GenerateGraph, but the editor waits for it, so it's worked on by task graph threads instead of the pool.
+	// MaxGenerationThreads is saved with the volume, so it's left as it is.
+	int32 ThreadCount = MaxGenerationThreads > 0 ? FMath::Min(MaxGenerationThreads, 31) : FMath::Max(FPlatformMisc::NumberOfCores() - 1, 1);
+	uint32 BrickCount = BrickMap.GetBrickCount();
+
+	CPathGenerationJob Job;
+	Job.Volume = this;
+	Job.ItemCount = BrickCount;
+	Job.MaxWorkers = ThreadCount;
+	ParallelFor(ThreadCount, [&Job](int32 BakerIndex)
+	{
+		FCPathAsyncVolumeGenerator Baker(nullptr, (uint8)BakerIndex);
+		Baker.WorkOnJob(Job);
+	});
+
+	for (uint32 BrickIndex = 0; BrickIndex < BrickCount; BrickIndex++)
+	{
+		CollapseBrick(BrickIndex);
+	}
+
+	OctreeCountAtDepth.Init(0, OctreeDepth + 1);
+	for (int Depth = 0; Depth <= OctreeDepth; Depth++)
+	{
+		OctreeCountAtDepth[Depth] = Job.OctreeCountAtDepth[Depth].load();
+	}
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	SaveOctree(Writer);
+
+	Modify();
+	if (!BakedData)
+		BakedData = NewObject<UCPathBakedVolumeData>(this, NAME_None, RF_Transactional);
+	BakedData->Modify();
+	BakedData->BakeHash = ComputeBakeHash();
+	BakedData->SetOctreeData(Bytes);
+
+	// The volume in the editor stays ungenerated, the octree is only used in game
+	BrickMap.Clear();
+	OctreeAllocator.Clear();
+	Occupancy.Clear();
+
+	VolumeBox->SetCollisionResponseToChannel(TraceChannel, VolumeBoxResponse);
+	return true;
+}
+#endif
+
+// Rounded to a mm, so that float noise between the editor and the game doesn't change the hash
+static uint32 HashRounded(FVector V)
+{
+	return GetTypeHash(FIntVector(FMath::RoundToInt(V.X * 10), FMath::RoundToInt(V.Y * 10), FMath::RoundToInt(V.Z * 10)));
+}
+
+uint32 ACPathVolume::ComputeBakeHash() const
+{
+	// Subclasses can save different user data, so the class is a setting too
+	uint32 Hash = GetTypeHash(GetClass()->GetFName());
+	Hash = HashCombine(Hash, GetTypeHash(VoxelSize));
+	Hash = HashCombine(Hash, GetTypeHash(OctreeDepth));
+	Hash = HashCombine(Hash, GetTypeHash(AgentRadius));
+	Hash = HashCombine(Hash, GetTypeHash(AgentHalfHeight));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)AgentShape));
+	Hash = HashCombine(Hash, GetTypeHash((uint8)TraceChannel.GetValue()));
+	Hash = HashCombine(Hash, HashRounded(VolumeBox->GetComponentLocation()));
+	Hash = HashCombine(Hash, HashRounded(VolumeBox->GetScaledBoxExtent()));
+	if (OccupancyProvider)
+		Hash = HashCombine(Hash, OccupancyProvider->GetBakeHash());
+
+	// Movable components are dynamic obstacles, they get regenerated on top of the bake anyway
+	TArray<FOverlapResult> Overlaps;
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(CPathBakeHash), false, this);
+	GetWorld()->OverlapMultiByChannel(Overlaps, VolumeBox->GetComponentLocation(), FQuat::Identity, TraceChannel, FCollisionShape::MakeBox(VolumeBox->GetScaledBoxExtent()), Params);
+
+	// Order of overlaps isn't stable, so hashes of components are sorted first
+	TArray<uint32> ComponentHashes;
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		const UPrimitiveComponent* Component = Overlap.GetComponent();
+		if (!Component || Component->Mobility != EComponentMobility::Static)
+			continue;
+
+		uint32 ComponentHash = GetTypeHash(Component->GetFName());
+		if (const AActor* Owner = Component->GetOwner())
+			ComponentHash = HashCombine(ComponentHash, GetTypeHash(Owner->GetFName()));
+
+		const FTransform& Transform = Component->GetComponentTransform();
+		ComponentHash = HashCombine(ComponentHash, HashRounded(Transform.GetLocation()));
+		ComponentHash = HashCombine(ComponentHash, HashRounded(Transform.GetRotation().Euler()));
+		ComponentHash = HashCombine(ComponentHash, HashRounded(Transform.GetScale3D() * 100.f));
+		ComponentHash = HashCombine(ComponentHash, HashRounded(Component->Bounds.BoxExtent));
+
+		if (const UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(Component))
+		{
+			if (const UStaticMesh* Mesh = MeshComponent->GetStaticMesh())
+				ComponentHash = HashCombine(ComponentHash, GetTypeHash(Mesh->GetPathName()));
+		}
+		ComponentHashes.Add(ComponentHash);
+	}
+	ComponentHashes.Sort();
+
+	for (uint32 ComponentHash : ComponentHashes)
+	{
+		Hash = HashCombine(Hash, ComponentHash);
+	}
+	return Hash;
+}
+
+// Change this when the format of SaveOctree changes, older bakes are then generated instead
+static constexpr uint32 CPathBakeVersion = 2;
+
+bool ACPathVolume::LoadBakedGraph()
+{
+	if (CheckBakeIsStale && BakedData->BakeHash != ComputeBakeHash())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s - baked octree is stale, generating instead. Run CPath.BakeVolumes in the editor to bake it again."), *GetName());
+		return false;
+	}
+
+	bool Loaded = false;
+	int64 Size = BakedData->OctreeData.GetBulkDataSize();
+	if (Size > 0)
+	{
+		const uint8* Bytes = (const uint8*)BakedData->OctreeData.LockReadOnly();
+		FMemoryReaderView Reader(FMemoryView(Bytes, Size));
+		Loaded = LoadOctree(Reader);
+		BakedData->OctreeData.Unlock();
+	}
+
+	if (!Loaded)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s - baked octree doesn't fit the volume, generating instead."), *GetName());
+
+		// Whatever was loaded before the error is thrown away
+		BrickMap.Init(NodeCount);
+		Occupancy.Init(BrickMap.GetBrickCount(), OctreeDepth);
+		OctreeAllocator.Clear();
+		OctreeCountAtDepth.Init(0, OctreeDepth + 1);
+	}
+	return Loaded;
+}
+
+void ACPathVolume::SaveOctree(FArchive& Ar)
+{
+	uint32 Version = CPathBakeVersion;
+	uint32 Depth = OctreeDepth;
+	Ar << Version << Depth << NodeCount[0] << NodeCount[1] << NodeCount[2];
+	for (int32 CurrDepth = 0; CurrDepth <= OctreeDepth; CurrDepth++)
+	{
+		Ar << OctreeCountAtDepth[CurrDepth];
+	}
+
+	CPathOctreeAllocator::LocalCache Cache;
+	for (uint32 BrickIndex = 0; BrickIndex < BrickMap.GetBrickCount(); BrickIndex++)
+	{
+		uint8 State = (uint8)BrickMap.GetState(BrickIndex);
+		Ar << State;
+		if (BrickMap.GetState(BrickIndex) != CPathBrickMap::EBrickState::Mixed)
+			continue;
+
+		for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick; LocalIndex++)
+		{
+			SerializeTreeStructure(Ar, BrickMap.GetTree((uint64)BrickIndex * CPathBrickMap::TreesPerBrick + LocalIndex), 0, Cache);
+		}
+		Occupancy.SerializeBrick(Ar, BrickIndex);
+	}
+}
+
+bool ACPathVolume::LoadOctree(FArchive& Ar)
+{
+	uint32 Version = 0, Depth = 0, Count[3] = { 0, 0, 0 };
+	Ar << Version << Depth << Count[0] << Count[1] << Count[2];
+	if (Ar.IsError() || Version != CPathBakeVersion || Depth != (uint32)OctreeDepth
+		|| Count[0] != NodeCount[0] || Count[1] != NodeCount[1] || Count[2] != NodeCount[2])
+	{
+		return false;
+	}
+
+	OctreeCountAtDepth.Init(0, OctreeDepth + 1);
+	for (int32 CurrDepth = 0; CurrDepth <= OctreeDepth; CurrDepth++)
+	{
+		Ar << OctreeCountAtDepth[CurrDepth];
+	}
+
+	CPathOctreeAllocator::LocalCache Cache;
+	for (uint32 BrickIndex = 0; BrickIndex < BrickMap.GetBrickCount() && !Ar.IsError(); BrickIndex++)
+	{
+		uint8 State = 0;
+		Ar << State;
+		if (State > (uint8)CPathBrickMap::EBrickState::Mixed)
+		{
+			Ar.SetError();
+		}
+		else if (State != (uint8)CPathBrickMap::EBrickState::Mixed)
+		{
+			BrickMap.SetHomogeneous(BrickIndex, State == (uint8)CPathBrickMap::EBrickState::Free);
+		}
+
+		else
+		{
+			BrickMap.Materialize(BrickIndex);
+			Occupancy.AllocateBrick(BrickIndex);
+			for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick; LocalIndex++)
+			{
+				SerializeTreeStructure(Ar, BrickMap.GetTree((uint64)BrickIndex * CPathBrickMap::TreesPerBrick + LocalIndex), 0, Cache);
+			}
+			Occupancy.SerializeBrick(Ar, BrickIndex);
+		}
+	}
+	OctreeAllocator.Flush(Cache);
+
+	return !Ar.IsError();
+}
+
+void ACPathVolume::SerializeTreeStructure(FArchive& Ar, CPathOctree* Tree, uint32 Depth, CPathOctreeAllocator::LocalCache& Cache)
+{
+	uint8 HasChildren = Tree->Children != nullptr;
+	Ar << HasChildren;
+	if (!HasChildren || Ar.IsError())
+		return;
+
+	// Generated trees never go deeper, so this is broken data
+	if (Depth >= (uint32)OctreeDepth)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	if (Ar.IsLoading())
+		Tree->Children = OctreeAllocator.Allocate(Cache);
+
+	for (uint32 ChildIndex = 0; ChildIndex < 8; ChildIndex++)
+	{
+		SerializeTreeStructure(Ar, &Tree->Children[ChildIndex], Depth + 1, Cache);
+	}
+}
+
+void ACPathVolume::InitGeneration()
+{
+	if (OctreeDepth < 0 || OctreeDepth > MAX_DEPTH)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("CPATH - Graph Generation:::OctreeDepth %d is outside of 0 and MAX_DEPTH (%d), define CPATH_64BIT_TREEID for depth above 3"), OctreeDepth, MAX_DEPTH);
+		OctreeDepth = FMath::Clamp(OctreeDepth, 0, MAX_DEPTH);
+	}
 
 	UBoxComponent* tempBox = Cast<UBoxComponent>(GetRootComponent());
 	tempBox->UpdateOverlaps();
@@ -222,10 +543,10 @@ bool ACPathVolume::GenerateGraph()
 	NodeCount[1] = FMath::CeilToInt(VolumeBox->GetScaledBoxExtent().Y * 2.0 / Divider);
 	NodeCount[2] = FMath::CeilToInt(VolumeBox->GetScaledBoxExtent().Z * 2.0 / Divider);
 
-	checkf(OctreeDepth <= MAX_DEPTH && OctreeDepth >= 0, TEXT("CPATH - Graph Generation:::OctreeDepth must be within 0 and MAX_DEPTH"));
 	//checkf(AgentShape == ECollisionShapeType::Capsule || AgentShape == ECollisionShapeType::Sphere || AgentShape == ECollisionShapeType::Box, TEXT("CPATH - Graph Generation:::Agent shape must be Capsule, Sphere or Box"));
 
 
+	TraceShapesByDepth.clear();
 	for (int i = 0; i <= OctreeDepth; i++)
 	{
 
@@ -255,55 +576,17 @@ bool ACPathVolume::GenerateGraph()
 
 	StartPosition = GetActorLocation() - VolumeBox->GetScaledBoxExtent() + GetVoxelSizeByDepth(0) / 2;
 
-	uint32 OuterNodeCount = NodeCount[0] * NodeCount[1] * NodeCount[2];
-	checkf(OuterNodeCount < DEPTH_0_LIMIT, TEXT("CPATH - Graph Generation:::Depth 0 is too dense, increase OctreeDepth and/or voxel size, or decrease volume area."));
-	Octrees = new CPathOctree[OuterNodeCount];
-
-	// If we use all logical threads in the system, the rest of the game
-	// will have no computing power to work with. From my small test sample
-	// Using hyper threads barely increased performance so its not worth it
-	/*if (FPlatformMisc::NumberOfCoresIncludingHyperthreads() > FPlatformMisc::NumberOfCores())
-		ThreadCount = FPlatformMisc::NumberOfCores() + (FPlatformMisc::NumberOfCoresIncludingHyperthreads() - FPlatformMisc::NumberOfCores()) / 3;
-	else
-		ThreadCount = FPlatformMisc::NumberOfCores() - 1;*/
-	if (MaxGenerationThreads <= 0)
-		MaxGenerationThreads = FPlatformMisc::NumberOfCores() - 1;
-	
-	MaxGenerationThreads = FMath::Min(MaxGenerationThreads, 31);
-
-	uint32 NodesPerThread = OuterNodeCount / MaxGenerationThreads;
-
-	for (int i = 0; i < 64; i++)
-	{
-		ThreadIDs[1] = false;
-	}
-
-
-	for (int CurrentThread = 0; CurrentThread < MaxGenerationThreads; CurrentThread++)
-	{
-		uint32 LastIndex = NodesPerThread * (CurrentThread + 1);
-		if (CurrentThread == MaxGenerationThreads - 1)
-			LastIndex += OuterNodeCount % MaxGenerationThreads;
-
-		int ThreadID = GetFreeThreadID();
-		FString ThreadName = FCPathAsyncVolumeGenerator::GetNameFromID(ThreadID);
-		ThreadName.AppendInt(ThreadID);
-		GeneratorThreads.push_back(std::make_unique<FCPathAsyncVolumeGenerator>(this, NodesPerThread * CurrentThread, LastIndex, ThreadID, ThreadName));
-		GeneratorThreads.back()->ThreadRef = FRunnableThread::Create(GeneratorThreads.back().get(), *ThreadName);
-		if (GeneratorThreads.back()->ThreadRef)
-		{
-			ThreadIDs[ThreadID] = true;
-		}
-		else
-		{
-			GeneratorThreads.pop_back();
-		}
-
-	}
-	OuterIndexesPerThread = 5 * (5 + OctreeDepth) * FMath::Pow(8.f, MAX_DEPTH - OctreeDepth);
-	// Setting timer for dynamic generation and garbage collection
-	GetWorld()->GetTimerManager().SetTimer(GenerationTimerHandle, this, &ACPathVolume::InitialGenerationUpdate, 1.f / 60.f, true);
-	return true;
+	// With Morton order, contiguous ranges of indexes are compact blocks of space, so generators still get nearby trees
+	// Counted in 64 bits, a grid that doesn't fit would wrap around in uint32
+	uint64 OuterNodeCount = (uint64)NodeCount[0] * NodeCount[1] * NodeCount[2];
+	checkf(OuterNodeCount < (uint64)DEPTH_0_LIMIT, TEXT("CPATH - Graph Generation:::Depth 0 is too dense, increase OctreeDepth and/or voxel size, or decrease volume area."));
+	OuterTreeCount = MortonOrder ? InitMortonLookupTables() : (uint32)OuterNodeCount;
+	BrickMap.Init(NodeCount);
+	Occupancy.Init(BrickMap.GetBrickCount(), OctreeDepth);
+
+	// Also used later, when dynamic obstacles regenerate trees
+	if (OccupancyProvider)
+		OccupancyProvider->BeginGeneration(this);
 }
 
 void ACPathVolume::Tick(float DeltaTime)
@@ -344,16 +627,24 @@ bool ACPathVolume::IsReadyForFinishDestroy()
 void ACPathVolume::FinishDestroy()
 {
 	// Deleting the graph
-	delete[] Octrees;
+	PathCache.Clear();
+	FlowFields.clear();
+	AbstractGraph.Clear();
+	LeafGraph.Clear();
+	ClosestFreeLeafTable.Clear();
+	OctreeDAG.Clear();
+	BrickMap.Clear();
+	OctreeAllocator.Clear();
+	Occupancy.Clear();
 
 	Super::FinishDestroy();
 }
 
 void ACPathVolume::EndPlay(EEndPlayReason::Type EndPlayReason)
 {
-	// Killing generation threads
+	// Cancelling generation, pool workers leave the job after the tree they're on
 	// This can potentially hold the game thread for a few ms:
-	//  - when the thread is currently waiting for a pathfinder to finish
+	//  - when a worker is currently waiting for a pathfinder to finish
 	
 	// Although it's very unlikely to happen, a good practice of removing dynamic obstacles
 	// from this volume before destroying it would prevent this.
@@ -361,7 +652,13 @@ void ACPathVolume::EndPlay(EEndPlayReason::Type EndPlayReason)
 	// If you're not destroying this manyally, before unloading the level, then the 5ms thread hang won't really matter anyway
 	// So only worry about this if you're destroying volumes during the game
 
-	GeneratorThreads.clear();
+	if (GenerationJob)
+	{
+		CPathGeneratorPool::Get().Cancel(GenerationJob);
+		while (!GenerationJob->Finished.load())
+			FPlatformProcess::Sleep(0.001f);
+		GenerationJob.reset();
+	}
 	GeneratorsRunning.store(0);
 	if (GenerationFinishedSemaphore)
 	{
@@ -371,7 +668,7 @@ void ACPathVolume::EndPlay(EEndPlayReason::Type EndPlayReason)
 	}
 }
 
-bool ACPathVolume::FindPathAsync(UObject* CallingObject, const FName& InFunctionName, FVector Start, FVector End, uint32 SmoothingPasses, int32 UserData, float TimeLimit, bool RequestRawPath, bool RequestUserPath)
+bool ACPathVolume::FindPathAsync(UObject* CallingObject, const FName& InFunctionName, FVector Start, FVector End, uint32 SmoothingPasses, int32 UserData, float TimeLimit, bool RequestRawPath, bool RequestUserPath, float SliceTimeLimit)
 {
 	FCPathRequest Request;
 	Request.OnPathFound.BindUFunction(CallingObject, InFunctionName);
@@ -383,6 +680,7 @@ bool ACPathVolume::FindPathAsync(UObject* CallingObject, const FName& InFunction
 	Request.TimeLimit = TimeLimit;
 	Request.RequestRawPath = RequestRawPath;
 	Request.RequestUserPath = RequestUserPath;
+	Request.SliceTimeLimit = SliceTimeLimit;
 
 	return FindPathAsync(Request);
 }
@@ -411,6 +709,73 @@ FCPathResult ACPathVolume::FindPathSynchronous(FVector Start, FVector End, uint3
 	return Result;
 }
 
+std::shared_ptr<CPathFlowField> ACPathVolume::FindFlowFieldSynchronous(FVector Target, int32 UserData, float MaxDistance, float TimeLimit)
+{
+	if (GeneratorsRunning.load() > 0 || !InitialGenerationCompleteAtom.load())
+		return nullptr;
+
+	ECPathfindingFailReason FailReason;
+	return FindFlowField(Target, UserData, MaxDistance, TimeLimit, FailReason);
+}
+
+bool ACPathVolume::FindFlowFieldAsync(FCPathRequest& Request)
+{
+	Request.VolumeRef = this;
+	Request.FlowField = true;
+	Request.SliceTimeLimit = 0;
+	return FindPathAsync(Request);
+}
+
+std::shared_ptr<CPathFlowField> ACPathVolume::FindFlowField(FVector Target, int32 UserData, float MaxDistance, float TimeLimit, ECPathfindingFailReason& OutFailReason)
+{
+	CPathTreeID TargetTreeID;
+	if (!FindClosestFreeLeaf(Target, TargetTreeID))
+	{
+		OutFailReason = ECPathfindingFailReason::WrongEndLocation;
+		return nullptr;
+	}
+	OutFailReason = ECPathfindingFailReason::None;
+
+	{
+		FScopeLock Lock(&FlowFieldsMutex);
+		for (auto Iter = FlowFields.begin(); Iter != FlowFields.end();)
+		{
+			std::shared_ptr<CPathFlowField> Field = Iter->lock();
+			if (!Field)
+			{
+				Iter = FlowFields.erase(Iter);
+				continue;
+			}
+
+			if (Field->IsValid() && Field->IsComplete() && Field->GetTargetTreeID() == TargetTreeID && Field->GetUserData() == UserData
+				&& (Field->GetMaxDistance() <= 0 || (MaxDistance > 0 && Field->GetMaxDistance() >= MaxDistance)))
+			{
+				return Field;
+			}
+			Iter++;
+		}
+	}
+
+	std::shared_ptr<CPathFlowField> NewField = std::make_shared<CPathFlowField>();
+	NewField->Build(this, TargetTreeID, UserData, MaxDistance, TimeLimit);
+
+	FScopeLock Lock(&FlowFieldsMutex);
+	FlowFields.push_back(NewField);
+	return NewField;
+}
+
+bool ACPathVolume::FindPathSynchronousSliced(CPathSearchContext& Context, FCPathResult& Result, float SliceTimeLimit)
+{
+	// Waiting for generators, the search will continue (or restart) next time
+	if (GeneratorsRunning.load() > 0)
+	{
+		return false;
+	}
+
+	Context.Request.VolumeRef = this;
+	return CPathAStar::GetInstance(GetWorld())->FindPathSliced(Context, &Result, SliceTimeLimit);
+}
+
 void ACPathVolume::FindPathSynchronous(BranchFailSuccessEnum Branches, TArray<FCPathNode>& Path, ECPathfindingFailReason FailReason, FVector Start, FVector End, int SmoothingPasses, int UserData, float
                                        TimeLimit)
 {
@@ -434,6 +799,63 @@ FVector ACPathVolume::WorldLocationToLocalCoordsInt3(FVector WorldLocation) cons
 }
 
 
+int64 ACPathVolume::GetOctreeBytesInUse() const
+{
+	return BrickMap.GetAllocatedBytes() + OctreeAllocator.GetBytesInUse() + Occupancy.GetAllocatedBytes();
+}
+
+uint32 ACPathVolume::InitMortonLookupTables()
+{
+	// Bits needed for each axis
+	uint32 BitCount[3];
+	uint32 MaxBitCount = 0;
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		BitCount[Axis] = 0;
+		while ((1u << BitCount[Axis]) < NodeCount[Axis])
+			BitCount[Axis]++;
+		MaxBitCount = FMath::Max(MaxBitCount, BitCount[Axis]);
+	}
+
+	// Interleaving X Y Z bits, an axis that runs out of bits is skipped, so the index has no gaps for unequal dimensions
+	uint32 IndexBitByCoordBit[3][32];
+	uint32 IndexBitCount = 0;
+	for (uint32 Bit = 0; Bit < MaxBitCount; Bit++)
+	{
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			if (Bit < BitCount[Axis])
+				IndexBitByCoordBit[Axis][Bit] = IndexBitCount++;
+		}
+	}
+	checkf(IndexBitCount < DEPTH_0_BITS, TEXT("CPATH - Graph Generation:::Depth 0 is too dense for MortonOrder, increase OctreeDepth and/or voxel size, or decrease volume area."));
+
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		LookupTable_MortonByCoord[Axis].assign(NodeCount[Axis], 0);
+		for (uint32 Coord = 0; Coord < NodeCount[Axis]; Coord++)
+		{
+			for (uint32 Bit = 0; Bit < BitCount[Axis]; Bit++)
+			{
+				LookupTable_MortonByCoord[Axis][Coord] |= ((Coord >> Bit) & 1) << IndexBitByCoordBit[Axis][Bit];
+			}
+		}
+
+		LookupTable_CoordByMortonByte[Axis].assign(sizeof(uint32) * 256, 0);
+		for (uint32 Bit = 0; Bit < BitCount[Axis]; Bit++)
+		{
+			uint32 IndexBit = IndexBitByCoordBit[Axis][Bit];
+			for (uint32 Value = 0; Value < 256; Value++)
+			{
+				if ((Value >> (IndexBit % 8)) & 1)
+					LookupTable_CoordByMortonByte[Axis][(IndexBit / 8) * 256 + Value] |= 1u << Bit;
+			}
+		}
+	}
+
+	return 1u << IndexBitCount;
+}
+
 bool ACPathVolume::IsInBounds(FVector XYZ) const
 {
 	if (XYZ.X < 0 || XYZ.X >= NodeCount[0])
@@ -448,21 +870,21 @@ bool ACPathVolume::IsInBounds(FVector XYZ) const
 	return true;
 }
 
-void ACPathVolume::GetAllSubtrees(uint32 TreeID, std::vector<uint32>& Container)
+void ACPathVolume::GetAllSubtrees(CPathTreeID TreeID, std::vector<CPathTreeID>& Container)
 {
 	uint32 Depth = 0;
 	CPathOctree* Tree = FindTreeByID(TreeID, Depth);
 	GetAllSubtreesRec(TreeID, Tree, Container, Depth);
 }
 
-void ACPathVolume::GetAllSubtreesRec(uint32 TreeID, CPathOctree* Tree, std::vector<uint32>& Container, uint32 Depth)
+void ACPathVolume::GetAllSubtreesRec(CPathTreeID TreeID, CPathOctree* Tree, std::vector<CPathTreeID>& Container, uint32 Depth)
 {
 	if (Tree->Children)
 	{
 		Depth++;
 		for (uint32 ChildID = 0; ChildID < 8; ChildID++)
 		{
-			uint32 ID = TreeID;
+			CPathTreeID ID = TreeID;
 			ReplaceChildIndexAndDepth(ID, Depth, ChildID);
 			GetAllSubtreesRec(ID, &Tree->Children[ChildID], Container, Depth);
 			Container.push_back(ID);
@@ -470,10 +892,10 @@ void ACPathVolume::GetAllSubtreesRec(uint32 TreeID, CPathOctree* Tree, std::vect
 	}
 }
 
-CPathOctree* ACPathVolume::FindTreeByID(uint32 TreeID)
+CPathOctree* ACPathVolume::FindTreeByID(CPathTreeID TreeID)
 {
 	uint32 Depth = ExtractDepth(TreeID);
-	CPathOctree* CurrTree = &Octrees[ExtractOuterIndex(TreeID)];
+	CPathOctree* CurrTree = GetOuterTree(ExtractOuterIndex(TreeID));
 
 
 	for (uint32 CurrDepth = 1; CurrDepth <= Depth; CurrDepth++)
@@ -489,10 +911,10 @@ CPathOctree* ACPathVolume::FindTreeByID(uint32 TreeID)
 	return CurrTree;
 }
 
-CPathOctree* ACPathVolume::FindTreeByID(uint32 TreeID, uint32& DepthReached)
+CPathOctree* ACPathVolume::FindTreeByID(CPathTreeID TreeID, uint32& DepthReached)
 {
 	uint32 Depth = ExtractDepth(TreeID);
-	CPathOctree* CurrTree = &Octrees[ExtractOuterIndex(TreeID)];
+	CPathOctree* CurrTree = GetOuterTree(ExtractOuterIndex(TreeID));
 	DepthReached = 0;
 
 	for (uint32 CurrDepth = 1; CurrDepth <= Depth; CurrDepth++)
@@ -509,17 +931,17 @@ CPathOctree* ACPathVolume::FindTreeByID(uint32 TreeID, uint32& DepthReached)
 	return CurrTree;
 }
 
-CPathOctree* ACPathVolume::FindTreeByWorldLocation(FVector WorldLocation, uint32& TreeID)
+CPathOctree* ACPathVolume::FindTreeByWorldLocation(FVector WorldLocation, CPathTreeID& TreeID)
 {
 	FVector LocalCoords = WorldLocationToLocalCoordsInt3(WorldLocation);
 	if (!IsInBounds(LocalCoords))
 		return nullptr;
 
 	TreeID = LocalCoordsInt3ToIndex(LocalCoords);
-	return &Octrees[TreeID];
+	return GetOuterTree(TreeID);
 }
 
-CPathOctree* ACPathVolume::FindLeafByWorldLocation(FVector WorldLocation, uint32& TreeID, bool MustBeFree)
+CPathOctree* ACPathVolume::FindLeafByWorldLocation(FVector WorldLocation, CPathTreeID& TreeID, bool MustBeFree)
 {
 	CPathOctree* CurrentTree = FindTreeByWorldLocation(WorldLocation, TreeID);
 	CPathOctree* FoundLeaf = nullptr;
@@ -534,7 +956,7 @@ CPathOctree* ACPathVolume::FindLeafByWorldLocation(FVector WorldLocation, uint32
 	}
 
 	// Checking if the found leaf is free, and if not returning its free neighbour
-	if (MustBeFree && FoundLeaf && !FoundLeaf->GetIsFree())
+	if (MustBeFree && FoundLeaf && !IsTreeFree(TreeID))
 	{
 		/*CurrentTree = GetParentTree(TreeID);
 		if (CurrentTree)
@@ -553,14 +975,89 @@ CPathOctree* ACPathVolume::FindLeafByWorldLocation(FVector WorldLocation, uint32
 	return FoundLeaf;
 }
 
-CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, uint32& TreeID, float SearchRange)
+bool ACPathVolume::HasLineOfSight(FVector Start, FVector End, float MinClearance)
+{
+	// Leafs are already inflated by the agent shape when the agent is bigger than them,
+	// so offsets only need to cover the part of the agent that fits in the smallest voxel
+	float MaxOffset = GetVoxelSizeByDepth(OctreeDepth) * 0.49f;
+	float OffsetXY = FMath::Min(AgentRadius, MaxOffset);
+	float OffsetZ = FMath::Min(AgentShape == EAgentShape::Sphere ? AgentRadius : AgentHalfHeight, MaxOffset);
+
+	if (OffsetXY <= 0 && OffsetZ <= 0)
+		return HasLineOfSightSingleRay(Start, End, MinClearance);
+
+	// Rays along the corners of the agent's box, leafs are never smaller than the box so nothing fits between them
+	for (int Corner = 0; Corner < 8; Corner++)
+	{
+		FVector Offset((Corner & 1) ? OffsetXY : -OffsetXY, (Corner & 2) ? OffsetXY : -OffsetXY, (Corner & 4) ? OffsetZ : -OffsetZ);
+		if (!HasLineOfSightSingleRay(Start + Offset, End + Offset, MinClearance))
+			return false;
+	}
+	return true;
+}
+
+bool ACPathVolume::HasLineOfSightSingleRay(FVector Start, FVector End, float MinClearance)
+{
+	FVector Delta = End - Start;
+	float Length = Delta.Size();
+
+	// Stepping this far past the exit point of a leaf to land in the next one
+	float Epsilon = Length > 0 ? GetVoxelSizeByDepth(OctreeDepth) * 0.01f / Length : 1.f;
+
+	CPathTreeID TreeID;
+	float T = 0;
+	while (true)
+	{
+		CPathOctree* Leaf = FindLeafByWorldLocation(Start + Delta * T, TreeID, false);
+		if (!Leaf || !IsTreeFree(TreeID))
+			return false;
+
+		if (MinClearance > 0 && !HasClearance(TreeID, MinClearance))
+			return false;
+
+		FVector LeafCenter = WorldLocationFromTreeID(TreeID);
+		float LeafExtent = GetVoxelSizeByDepth(ExtractDepth(TreeID)) * 0.5f;
+
+		// The segment leaves this leaf through the closest face it's heading towards
+		float ExitT = 1.f;
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			if (Delta[Axis] == 0)
+				continue;
+
+			float Face = LeafCenter[Axis] + (Delta[Axis] > 0 ? LeafExtent : -LeafExtent);
+			ExitT = FMath::Min(ExitT, (Face - Start[Axis]) / Delta[Axis]);
+		}
+
+		if (ExitT >= 1.f)
+			return true;
+
+		T = FMath::Max(ExitT, T) + Epsilon;
+		if (T > 1.f)
+		{
+			// End is just past the face, checking its leaf too
+			Leaf = FindLeafByWorldLocation(End, TreeID, false);
+			return Leaf && IsTreeFree(TreeID) && (MinClearance <= 0 || HasClearance(TreeID, MinClearance));
+		}
+	}
+}
+
+bool ACPathVolume::CheckLineOfSight(FVector Start, FVector End)
+{
+	if (!InitialGenerationCompleteAtom.load() || GeneratorsRunning.load() > 0)
+		return false;
+
+	return HasLineOfSight(Start, End);
+}
+
+CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, CPathTreeID& TreeID, float SearchRange, CPathVisitedTable* VisitedTable)
 {
-	uint32 OriginTreeID = 0xFFFFFFFF;
+	CPathTreeID OriginTreeID = INVALID_TREE_ID;
 	CPathOctree* OriginTree = FindLeafByWorldLocation(WorldLocation, OriginTreeID, false);
 	if (!OriginTree)
 		return nullptr;
 
-	if (OriginTree->GetIsFree())
+	if (IsTreeFree(OriginTreeID))
 	{
 		TreeID = OriginTreeID;
 		return OriginTree;
@@ -573,8 +1070,48 @@ CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, uint32& Tr
 		SearchRange = GetVoxelSizeByDepth(Depth);
 	}
 
+	if (ClosestFreeLeafTable.IsBuilt())
+	{
+		// Direct free neighbours first, ranked by distance to WorldLocation and not to the leaf's center,
+		// so that a location in a thin wall stays on its side. The table is only used deeper inside obstacles.
+		std::vector<CPathAStarNode> Neighbours;
+		FindFreeNeighbourLeafs(CPathAStarNode(OriginTreeID), Neighbours);
+
+		CPathTreeID ClosestTreeID = INVALID_TREE_ID;
+		float ClosestDistance = TNumericLimits<float>::Max();
+		for (const CPathAStarNode& NewNode : Neighbours)
+		{
+			float Distance = FVector::Distance(NewNode.WorldLocation, WorldLocation) - GetVoxelSizeByDepth(ExtractDepth(NewNode.TreeID)) / 2.f;
+			if (Distance < ClosestDistance)
+			{
+				ClosestDistance = Distance;
+				ClosestTreeID = NewNode.TreeID;
+			}
+		}
+		if (ClosestTreeID != INVALID_TREE_ID)
+		{
+			TreeID = ClosestTreeID;
+			return FindTreeByID(ClosestTreeID);
+		}
+
+		CPathTreeID FreeTreeID;
+		float Distance;
+		if (!ClosestFreeLeafTable.Find(OriginTreeID, FreeTreeID, Distance) || Distance > SearchRange)
+			return nullptr;
+
+		TreeID = FreeTreeID;
+		return FindTreeByID(FreeTreeID);
+	}
+
 	// Nodes visited OR added to priority queue
-	std::unordered_set<CPathAStarNode, CPathAStarNode::Hash> VisitedNodes;
+	std::unique_ptr<CPathVisitedTable> TempVisitedTable;
+	if (!VisitedTable)
+	{
+		TempVisitedTable = std::make_unique<CPathVisitedTable>(256);
+		VisitedTable = TempVisitedTable.get();
+	}
+	CPathVisitedTable& VisitedNodes = *VisitedTable;
+	VisitedNodes.Reset();
 
 	std::priority_queue<CPathAStarNode, std::deque<CPathAStarNode>, std::greater<CPathAStarNode>> Pq;
 	std::priority_queue<CPathAStarNode, std::deque<CPathAStarNode>, std::greater<CPathAStarNode>> PqNeighbours;
@@ -582,20 +1119,22 @@ CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, uint32& Tr
 
 	CPathAStarNode StartNode(OriginTreeID);
 	StartNode.FitnessResult = 0;
-	VisitedNodes.insert(StartNode);
+	VisitedNodes.Add(StartNode.TreeID, 0);
 
 	// STEP 1 - considering StartNode neighbours only, we dont check range cause neighbours take priority 
 	// (its faster and solves almost all cases without needing to go to the other queue)
 
-	std::vector<CPathAStarNode> StartNeighbours = FindFreeNeighbourLeafs(StartNode);
-	for (CPathAStarNode NewNode : StartNeighbours)
-	{		
-		NewNode.WorldLocation = WorldLocationFromTreeID(NewNode.TreeID);
+	// Reused for every node, so that we don't allocate in the loops
+	std::vector<CPathAStarNode> Neighbours;
+	Neighbours.reserve(24);
 
+	FindFreeNeighbourLeafs(StartNode, Neighbours);
+	for (CPathAStarNode NewNode : Neighbours)
+	{		
 		// Fitness function here is distance from WorldLocation - The voxel extent, cause we want distance to the border of the voxel, not to it's center
 		NewNode.FitnessResult = FVector::Distance(NewNode.WorldLocation, WorldLocation) - GetVoxelSizeByDepth(ExtractDepth(NewNode.TreeID)) / 2.f;
 
-		VisitedNodes.insert(NewNode);
+		VisitedNodes.Add(NewNode.TreeID, 0);
 		PqNeighbours.push(NewNode);
 	}
 
@@ -604,7 +1143,7 @@ CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, uint32& Tr
 		CPathAStarNode CurrentNode = PqNeighbours.top();
 		PqNeighbours.pop();
 		CPathOctree* Tree = FindTreeByID(CurrentNode.TreeID);
-		if (Tree->GetIsFree())
+		if (IsTreeFree(CurrentNode.TreeID))
 		{
 			if (!GetWorld()->LineTraceTestByChannel(WorldLocation, CurrentNode.WorldLocation, TraceChannel))
 			{
@@ -615,17 +1154,16 @@ CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, uint32& Tr
 			//DrawDebugLine(GetWorld(), WorldLocation, CurrentNode.WorldLocation, FColor::Red, false, 1);
 		}
 
-		std::vector<CPathAStarNode> Neighbours = FindFreeNeighbourLeafs(CurrentNode);
+		FindFreeNeighbourLeafs(CurrentNode, Neighbours);
 		for (CPathAStarNode NewNode : Neighbours)
 		{			
 			// We dont want to revisit nodes
-			if (!VisitedNodes.count(NewNode))
+			if (!VisitedNodes.Contains(NewNode.TreeID))
 			{
-				NewNode.WorldLocation = WorldLocationFromTreeID(NewNode.TreeID);
 				// Fitness function here is distance from WorldLocation - The voxel extent, cause we want distance to the border of the voxel, not to it's center
 				NewNode.FitnessResult = FVector::Distance(NewNode.WorldLocation, WorldLocation) - GetVoxelSizeByDepth(ExtractDepth(NewNode.TreeID)) / 2.f;
 
-				VisitedNodes.insert(NewNode);
+				VisitedNodes.Add(NewNode.TreeID, 0);
 				// Search range condition
 				if (NewNode.FitnessResult <= SearchRange)
 				{
@@ -643,7 +1181,7 @@ CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, uint32& Tr
 		CPathAStarNode CurrentNode = Pq.top();
 		Pq.pop();
 		CPathOctree* Tree = FindTreeByID(CurrentNode.TreeID);
-		if (Tree->GetIsFree())
+		if (IsTreeFree(CurrentNode.TreeID))
 		{
 			if (!GetWorld()->LineTraceTestByChannel(WorldLocation, CurrentNode.WorldLocation, TraceChannel))
 			{
@@ -654,18 +1192,17 @@ CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, uint32& Tr
 			//DrawDebugLine(GetWorld(), WorldLocation, CurrentNode.WorldLocation, FColor::Red, false, 1);
 		}
 
-		std::vector<CPathAStarNode> Neighbours = FindFreeNeighbourLeafs(CurrentNode);
+		FindFreeNeighbourLeafs(CurrentNode, Neighbours);
 
 		for (CPathAStarNode NewNode : Neighbours)
 		{			
 			// We dont want to revisit nodes
-			if (!VisitedNodes.count(NewNode))
+			if (!VisitedNodes.Contains(NewNode.TreeID))
 			{
-				NewNode.WorldLocation = WorldLocationFromTreeID(NewNode.TreeID);
 				// Fitness function here is distance from WorldLocation - The voxel extent, cause we want distance to the border of the voxel, not to it's center
 				NewNode.FitnessResult = FVector::Distance(NewNode.WorldLocation, WorldLocation) - GetVoxelSizeByDepth(ExtractDepth(NewNode.TreeID)) / 2.f;
 
-				VisitedNodes.insert(NewNode);
+				VisitedNodes.Add(NewNode.TreeID, 0);
 				// Search range condition
 				if (NewNode.FitnessResult <= SearchRange)
 				{
@@ -677,7 +1214,7 @@ CPathOctree* ACPathVolume::FindClosestFreeLeaf(FVector WorldLocation, uint32& Tr
 	return nullptr;
 }
 
-CPathOctree* ACPathVolume::FindLeafRecursive(FVector RelativeLocation, uint32& TreeID, uint32 CurrentDepth, CPathOctree* CurrentTree)
+CPathOctree* ACPathVolume::FindLeafRecursive(FVector RelativeLocation, CPathTreeID& TreeID, uint32 CurrentDepth, CPathOctree* CurrentTree)
 {
 	CurrentDepth += 1;
 
@@ -707,21 +1244,21 @@ CPathOctree* ACPathVolume::FindLeafRecursive(FVector RelativeLocation, uint32& T
 }
 
 
-CPathOctree* ACPathVolume::FindNeighbourByID(uint32 TreeID, ENeighbourDirection Direction, uint32& NeighbourID)
+CPathOctree* ACPathVolume::FindNeighbourByID(CPathTreeID TreeID, ENeighbourDirection Direction, CPathTreeID& NeighbourID)
 {
 
-	// Depth 0, getting neighbour from Octrees
+	// Depth 0, getting neighbour from BrickMap
 	uint32 Depth = ExtractDepth(TreeID);
 	if (Depth == 0)
 	{
-		int OuterIndex = ExtractOuterIndex(TreeID);
+		uint32 OuterIndex = ExtractOuterIndex(TreeID);
 		FVector NeighbourLocalCoords = LocalCoordsInt3FromOuterIndex(OuterIndex) + LookupTable_NeighbourOffsetByDirection[Direction];
 
 		if (!IsInBounds(NeighbourLocalCoords))
 			return nullptr;
 
 		NeighbourID = LocalCoordsInt3ToIndex(NeighbourLocalCoords);
-		return &Octrees[NeighbourID];
+		return GetOuterTree(NeighbourID);
 	}
 
 	uint8 ChildIndex = ExtractChildIndex(TreeID, Depth);
@@ -761,61 +1298,97 @@ CPathOctree* ACPathVolume::FindNeighbourByID(uint32 TreeID, ENeighbourDirection
 	return nullptr;
 }
 
-std::vector<uint32> ACPathVolume::FindNeighbourLeafs(uint32 TreeID, bool MustBeFree)
+std::vector<CPathTreeID> ACPathVolume::FindNeighbourLeafs(CPathTreeID TreeID, bool MustBeFree)
+{
+	std::vector<CPathTreeID> FreeNeighbours;
+	FindNeighbourLeafs(TreeID, FreeNeighbours, MustBeFree);
+	return FreeNeighbours;
+}
+
+void ACPathVolume::FindNeighbourLeafs(CPathTreeID TreeID, std::vector<CPathTreeID>& OutNeighbours, bool MustBeFree)
 {
-	std::vector<uint32> FreeNeighbours;
+	OutNeighbours.clear();
 
 	for (int Direction = 0; Direction < 6; Direction++)
 	{
-		uint32 NeighbourID = 0;
+		CPathTreeID NeighbourID = 0;
 		CPathOctree* Neighbour = FindNeighbourByID(TreeID, (ENeighbourDirection)Direction, NeighbourID);
 		if (Neighbour)
 		{
-			if (Neighbour->GetIsFree())
-				FreeNeighbours.push_back(NeighbourID);
+			if (IsTreeFree(NeighbourID))
+				OutNeighbours.push_back(NeighbourID);
 			else if (Neighbour->Children)
 			{
-				FindLeafsOnSide(Neighbour, NeighbourID, (ENeighbourDirection)LookupTable_OppositeSide[Direction], &FreeNeighbours, MustBeFree);
+				FindLeafsOnSide(Neighbour, NeighbourID, (ENeighbourDirection)LookupTable_OppositeSide[Direction], &OutNeighbours, MustBeFree);
 			}
 			else if(!MustBeFree)
-				FreeNeighbours.push_back(NeighbourID);
+				OutNeighbours.push_back(NeighbourID);
 		}
 	}
-
-	return FreeNeighbours;
 }
 
 std::vector<CPathAStarNode> ACPathVolume::FindFreeNeighbourLeafs(CPathAStarNode& Node)
 {
 	std::vector<CPathAStarNode> FreeNeighbours;
+	FindFreeNeighbourLeafs(Node, FreeNeighbours);
+	return FreeNeighbours;
+}
+
+void ACPathVolume::FindFreeNeighbourLeafs(const CPathAStarNode& Node, std::vector<CPathAStarNode>& OutNeighbours)
+{
+	OutNeighbours.clear();
+
+	if (LeafGraph.IsBuilt())
+	{
+		CPathLeafRef LeafRef = Node.GraphLeaf;
+		if (LeafRef == CPathLeafGraph::InvalidLeaf)
+			LeafRef = LeafGraph.FindLeaf(Node.TreeID);
+
+		// Only free leafs are in the graph, other nodes (like in FindClosestFreeLeaf) need the octree
+		if (LeafRef != CPathLeafGraph::InvalidLeaf)
+		{
+			const CPathLeafRef* Neighbours = LeafGraph.GetNeighbours(LeafRef);
+			uint32 NeighbourCount = LeafGraph.GetLeaf(LeafRef).NeighbourCount;
+			for (uint32 i = 0; i < NeighbourCount; i++)
+			{
+				const CPathGraphLeaf& Leaf = LeafGraph.GetLeaf(Neighbours[i]);
+				OutNeighbours.push_back(CPathAStarNode(Leaf.TreeID, Leaf.UserData));
+				OutNeighbours.back().WorldLocation = Leaf.Center;
+				OutNeighbours.back().GraphLeaf = Neighbours[i];
+			}
+			return;
+		}
+	}
 
 	for (int Direction = 0; Direction < 6; Direction++)
 	{
-		uint32 NeighbourID = 0;
+		CPathTreeID NeighbourID = 0;
 		CPathOctree* Neighbour = FindNeighbourByID(Node.TreeID, (ENeighbourDirection)Direction, NeighbourID);
 		if (Neighbour)
 		{
-			if (Neighbour->GetIsFree())
-				FreeNeighbours.push_back(CPathAStarNode(NeighbourID, Neighbour->Data));
+			if (IsTreeFree(NeighbourID))
+				OutNeighbours.push_back(CPathAStarNode(NeighbourID, GetTreeUserData(NeighbourID)));
 			else if (Neighbour->Children)
 			{
-				FindLeafsOnSide(Neighbour, NeighbourID, (ENeighbourDirection)LookupTable_OppositeSide[Direction], &FreeNeighbours);
+				FindLeafsOnSide(Neighbour, NeighbourID, (ENeighbourDirection)LookupTable_OppositeSide[Direction], &OutNeighbours);
 			}
 		}
 	}
 
-
-	return FreeNeighbours;
+	for (CPathAStarNode& Neighbour : OutNeighbours)
+	{
+		Neighbour.WorldLocation = WorldLocationFromTreeID(Neighbour.TreeID);
+	}
 }
 
 
-void ACPathVolume::FindLeafsOnSide(uint32 TreeID, ENeighbourDirection Side, std::vector<uint32>* Vector, bool MustBeFree)
+void ACPathVolume::FindLeafsOnSide(CPathTreeID TreeID, ENeighbourDirection Side, std::vector<CPathTreeID>* Vector, bool MustBeFree)
 {
 	uint32 TempDepthReached;
 	FindLeafsOnSide(FindTreeByID(TreeID, TempDepthReached), TreeID, Side, Vector, MustBeFree);
 }
 
-void ACPathVolume::FindLeafsOnSide(CPathOctree* Tree, uint32 TreeID, ENeighbourDirection Side, std::vector<uint32>* Vector, bool MustBeFree)
+void ACPathVolume::FindLeafsOnSide(CPathOctree* Tree, CPathTreeID TreeID, ENeighbourDirection Side, std::vector<CPathTreeID>* Vector, bool MustBeFree)
 {
 #if WITH_EDITOR
 	checkf(Tree->Children, TEXT("CPATH - FindAllLeafsOnSide, requested tree has no children"));
@@ -825,19 +1398,19 @@ void ACPathVolume::FindLeafsOnSide(CPathOctree* Tree, uint32 TreeID, ENeighbourD
 	{
 		uint8 ChildIndex = LookupTable_ChildrenOnSide[Side][i];
 		CPathOctree* Child = &Tree->Children[ChildIndex];
-		uint32 ChildTreeID = TreeID;
+		CPathTreeID ChildTreeID = TreeID;
 		ReplaceChildIndexAndDepth(ChildTreeID, NewDepth, ChildIndex);
 		if (Child->Children)
-			FindLeafsOnSide(Child, ChildTreeID, Side, Vector);
+			FindLeafsOnSide(Child, ChildTreeID, Side, Vector, MustBeFree);
 		else
 		{
-			if (Child->GetIsFree() || !MustBeFree)
+			if (!MustBeFree || IsTreeFree(ChildTreeID))
 				Vector->push_back(ChildTreeID);
 		}
 	}
 }
 
-void ACPathVolume::FindLeafsOnSide(CPathOctree* Tree, uint32 TreeID, ENeighbourDirection Side, std::vector<CPathAStarNode>* Vector, bool MustBeFree)
+void ACPathVolume::FindLeafsOnSide(CPathOctree* Tree, CPathTreeID TreeID, ENeighbourDirection Side, std::vector<CPathAStarNode>* Vector, bool MustBeFree)
 {
 #if WITH_EDITOR
 	checkf(Tree->Children, TEXT("CPATH - FindAllLeafsOnSide, requested tree has no children"));
@@ -847,14 +1420,14 @@ void ACPathVolume::FindLeafsOnSide(CPathOctree* Tree, uint32 TreeID, ENeighbourD
 	{
 		uint8 ChildIndex = LookupTable_ChildrenOnSide[Side][i];
 		CPathOctree* Child = &Tree->Children[ChildIndex];
-		uint32 ChildTreeID = TreeID;
+		CPathTreeID ChildTreeID = TreeID;
 		ReplaceChildIndexAndDepth(ChildTreeID, NewDepth, ChildIndex);
 		if (Child->Children)
-			FindLeafsOnSide(Child, ChildTreeID, Side, Vector);
+			FindLeafsOnSide(Child, ChildTreeID, Side, Vector, MustBeFree);
 		else
 		{
-			if (Child->GetIsFree() || !MustBeFree)
-				Vector->push_back(CPathAStarNode(ChildTreeID, Child->Data));
+			if (!MustBeFree || IsTreeFree(ChildTreeID))
+				Vector->push_back(CPathAStarNode(ChildTreeID, GetTreeUserData(ChildTreeID)));
 		}
 	}
 }
@@ -937,65 +1510,103 @@ void ACPathVolume::PerformRandomBenchmark(uint32 FindPathUserData, float FindPat
 		FFileHelper::SaveStringToFile(BenchmarkResult, *FilePath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), EFileWrite::FILEWRITE_Append);
 }
 
-uint32 ACPathVolume::GetFreeThreadID() const
+void ACPathVolume::StartGenerationJob(std::shared_ptr<CPathGenerationJob> Job)
 {
-	for (int ID = 0; ID < 64; ID++)
-	{
-		if (!ThreadIDs[ID])
-			return ID;
-	}
-	// This will never return as max number of generation threads is always less than 64
-	return 0;
+	// Blocks new pathfinders right away, workers wait for those already running
+	GeneratorsRunning++;
+	GenerationJob = Job;
+	CPathGeneratorPool::Get().Submit(std::move(Job));
 }
 
-void ACPathVolume::CleanFinishedGenerators()
+void ACPathVolume::OnGenerationJobFinished(const std::shared_ptr<CPathGenerationJob>& Job)
 {
-	for (auto Generator = GeneratorThreads.begin(); Generator != GeneratorThreads.end(); Generator++)
+	// EndPlay resets GeneratorsRunning itself
+	if (Job->Cancelled.load())
+		return;
+
+	if (Job->bObstacles)
 	{
-		if ((*Generator)->HasFinishedWorking())
-		{
-			ThreadIDs[(*Generator)->GenThreadID] = false;
-			Generator = GeneratorThreads.erase(Generator);
-		}
+		// GeneratorsRunning still keeps pathfinders out while derived data updates
+		OnTreesRegenerated();
+		GeneratorsRunning--;
+		return;
 	}
 
-}
+	// Same as for obstacles, derived data is built here while GeneratorsRunning keeps pathfinders out.
+	// EndPlay waits for the job to finish, so the volume can't go away meanwhile.
+	BuildDerivedData();
+	if (Job->Cancelled.load())
+		return;
 
-void ACPathVolume::InitialGenerationUpdate()
-{
-	if (GeneratorsRunning.load() <= 0)
+	// Only the game thread can touch the timers
+	TWeakObjectPtr<ACPathVolume> WeakVolume(this);
+	AsyncTask(ENamedThreads::GameThread, [WeakVolume, Job]()
 	{
-		InitialGenerationCompleteAtom.store(true);
-		InitialGenerationFinished = true;
+		ACPathVolume* Volume = WeakVolume.Get();
+		if (!Volume || Job->Cancelled.load())
+			return;
 
-		for (auto Generator = GeneratorThreads.begin(); Generator != GeneratorThreads.end(); Generator++)
+		Volume->OctreeCountAtDepth.Init(0, Volume->OctreeDepth + 1);
+		for (int Depth = 0; Depth <= Volume->OctreeDepth; Depth++)
 		{
-			for (int Depth = 0; Depth <= OctreeDepth; Depth++)
-			{
-				OctreeCountAtDepth[Depth] += Generator->get()->OctreeCountAtDepth[Depth];
-
-			}
+			Volume->OctreeCountAtDepth[Depth] = Job->OctreeCountAtDepth[Depth].load();
 		}
-		for (int Depth = 0; Depth <= OctreeDepth; Depth++)
+		Volume->GeneratorsRunning--;
+		Volume->FinishInitialGeneration();
+	});
+}
+
+void ACPathVolume::BuildDerivedData()
+{
+	// Pathfinders can't use the volume yet, so the graph can be built without any locking
+	// Bricks that turned out all free or all occupied only keep their state
+	for (uint32 BrickIndex = 0; BrickIndex < BrickMap.GetBrickCount(); BrickIndex++)
+	{
+		CollapseBrick(BrickIndex);
+	}
+	if (DeduplicateSubtrees)
+	{
+		OctreeDAG.Compact(this);
+	}
+	if (BuildLeafGraph)
+	{
+		LeafGraph.Build(this);
+		if (HierarchicalClusterSize > 0)
 		{
-			TotalNodeCount += OctreeCountAtDepth[Depth];
+			AbstractGraph.Build(this, LeafGraph, HierarchicalClusterSize);
 		}
+	}
+	if (PrecomputeClosestFreeLeafs)
+	{
+		ClosestFreeLeafTable.Build(this);
+	}
+}
 
+void ACPathVolume::FinishInitialGeneration()
+{
+	InitialGenerationCompleteAtom.store(true);
+	InitialGenerationFinished = true;
 
-		CleanFinishedGenerators();
-		GetWorld()->GetTimerManager().ClearTimer(GenerationTimerHandle);
+	if (OctreeCountAtDepth.Num() <= OctreeDepth)
+		OctreeCountAtDepth.SetNumZeroed(OctreeDepth + 1);
+
+	for (int Depth = 0; Depth <= OctreeDepth; Depth++)
+	{
+		TotalNodeCount += OctreeCountAtDepth[Depth];
+	}
 
-		// Run benchmark before modifying the graph
-		if (PerformBenchmarkAfterGeneration)
-		{
-			PerformRandomBenchmark(BenchmarkFindPathUserData, BenchmarkFindPathTimeLimit);
-		}
 
+	GetWorld()->GetTimerManager().ClearTimer(GenerationTimerHandle);
 
-		if (DynamicObstaclesUpdateRate > 0)
-			GetWorld()->GetTimerManager().SetTimer(GenerationTimerHandle, this, &ACPathVolume::GenerationUpdate, 1.f / DynamicObstaclesUpdateRate, true);
+	// Run benchmark before modifying the graph
+	if (PerformBenchmarkAfterGeneration)
+	{
+		PerformRandomBenchmark(BenchmarkFindPathUserData, BenchmarkFindPathTimeLimit);
 	}
 
+
+	if (DynamicObstaclesUpdateRate > 0)
+		GetWorld()->GetTimerManager().SetTimer(GenerationTimerHandle, this, &ACPathVolume::GenerationUpdate, 1.f / DynamicObstaclesUpdateRate, true);
 }
 
 void ACPathVolume::GenerationUpdate()
@@ -1003,10 +1614,6 @@ void ACPathVolume::GenerationUpdate()
 #if WITH_EDITOR
 	checkf(GeneratorsRunning.load() >= 0, TEXT("CPATH - Graph Generation:::GenerationUpdate - GeneratorsRunning was negative!!!!!"));
 #endif
-	// Garbage collecting generators that finished their job
-	CleanFinishedGenerators();
-
-
 
 	// We skip this update if generation from previous update is still running
 	// This can be the cause if we set DynamicObstaclesUpdateRate too high, or when it's initial generation, 
@@ -1017,7 +1624,7 @@ void ACPathVolume::GenerationUpdate()
 		//Drawing previously updated trees
 		/*for (auto TreeID : TreesToRegenerate)
 		{
-			std::vector<uint32> Subtrees;
+			std::vector<CPathTreeID> Subtrees;
 			Subtrees.push_back(TreeID);
 			GetAllSubtrees(TreeID, Subtrees);
 			for (auto SubID : Subtrees)
@@ -1039,36 +1646,139 @@ void ACPathVolume::GenerationUpdate()
 			}
 		}
 
-		// Creating threads
-		// In case there is a lot of trees to update, we split the work into multiple threads to make it faster
+		// In case there is a lot of trees to update, more pool workers can join the job to make it faster
 		if (TreesToRegenerate.size())
 		{
+			std::shared_ptr<CPathGenerationJob> Job = std::make_shared<CPathGenerationJob>();
+			Job->Volume = this;
+			Job->bObstacles = true;
+			Job->OuterIndexes.assign(TreesToRegenerate.begin(), TreesToRegenerate.end());
+			Job->ItemCount = (uint32)Job->OuterIndexes.size();
+			Job->MaxWorkers = FMath::Clamp((int)TreesToRegenerate.size() / OuterIndexesPerThread, 1, FMath::Max(MaxGenerationThreads, 1));
+			// Small enough for workers to even out, big enough to not fight over the cursor
+			Job->ChunkSize = FMath::Max(1, OuterIndexesPerThread / 8);
+			StartGenerationJob(std::move(Job));
+
+			//UE_LOG(LogTemp, Warning, TEXT("GENERATION UPDATE Tracked - %d, Indexes - %d"), TrackedDynamicObstacles.size(), TreesToRegenerate.size());
+		}
+	}
+}
 
-			uint32 ThreadCount = FMath::Min(FMath::Min(FPlatformMisc::NumberOfCores(), (int)TreesToRegenerate.size() / OuterIndexesPerThread), MaxGenerationThreads);
-			ThreadCount = FMath::Max(ThreadCount, (uint32)1);
-			uint32 NodesPerThread = (uint32)TreesToRegenerate.size() / ThreadCount;
+void ACPathVolume::MaterializeBrick(uint32 BrickIndex)
+{
+	FScopeLock Lock(&BrickMapMutex);
+	CPathBrickMap::EBrickState State = BrickMap.GetState(BrickIndex);
+	if (State == CPathBrickMap::EBrickState::Mixed)
+		return;
 
-			// Starting generation
-			for (uint32 CurrentThread = 0; CurrentThread < ThreadCount; CurrentThread++)
+	BrickMap.Materialize(BrickIndex);
+	Occupancy.AllocateBrick(BrickIndex);
+	if (State == CPathBrickMap::EBrickState::Free)
+	{
+		uint32 OuterIndexes[CPathBrickMap::TreesPerBrick];
+		GetBrickOuterIndexes(BrickIndex, OuterIndexes);
+		for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick; LocalIndex++)
+		{
+			if (OuterIndexes[LocalIndex] != InvalidOuterIndex)
+				Occupancy.SetIsFree((uint64)BrickIndex * CPathBrickMap::TreesPerBrick + LocalIndex, OuterIndexes[LocalIndex], true);
+		}
+	}
+}
+
+void ACPathVolume::CollapseBrick(uint32 BrickIndex)
+{
+	if (BrickMap.GetState(BrickIndex) != CPathBrickMap::EBrickState::Mixed)
+		return;
+
+	uint32 OuterIndexes[CPathBrickMap::TreesPerBrick];
+	GetBrickOuterIndexes(BrickIndex, OuterIndexes);
+
+	// Data is only 0 (occupied) or 1 (free) for trees without user data
+	uint32 BrickData = 2;
+	for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick; LocalIndex++)
+	{
+		if (OuterIndexes[LocalIndex] == InvalidOuterIndex)
+			continue;
+
+		uint64 OuterSlot = (uint64)BrickIndex * CPathBrickMap::TreesPerBrick + LocalIndex;
+		if (BrickMap.GetTree(OuterSlot)->Children)
+			return;
+
+		uint32 Data = Occupancy.GetData(OuterSlot, OuterIndexes[LocalIndex]);
+		if (Data > 1 || (BrickData < 2 && Data != BrickData))
+			return;
+		BrickData = Data;
+	}
+
+	Occupancy.ReleaseBrick(BrickIndex);
+	BrickMap.SetHomogeneous(BrickIndex, BrickData == 1);
+}
+
+uint32 ACPathVolume::GetBrickOuterIndexes(uint32 BrickIndex, uint32 OutOuterIndexes[CPathBrickMap::TreesPerBrick]) const
+{
+	for (uint32 LocalIndex = 0; LocalIndex < CPathBrickMap::TreesPerBrick; LocalIndex++)
+	{
+		OutOuterIndexes[LocalIndex] = InvalidOuterIndex;
+	}
+
+	uint32 First[3], End[3];
+	BrickMap.GetBrickRange(BrickIndex, First, End);
+	uint32 Count = 0;
+	for (uint32 X = First[0]; X < End[0]; X++)
+	{
+		for (uint32 Y = First[1]; Y < End[1]; Y++)
+		{
+			for (uint32 Z = First[2]; Z < End[2]; Z++)
 			{
-				uint32 LastIndex = NodesPerThread * (CurrentThread + 1);
-				if (CurrentThread == ThreadCount - 1)
-					LastIndex += TreesToRegenerate.size() % ThreadCount;
-
-				int ThreadID = GetFreeThreadID();
-				FString ThreadName = FCPathAsyncVolumeGenerator::GetNameFromID(ThreadID);
-				GeneratorThreads.push_back(std::make_unique<FCPathAsyncVolumeGenerator>(this, NodesPerThread * CurrentThread, LastIndex, ThreadID, ThreadName, true));
-				GeneratorThreads.back()->ThreadRef = FRunnableThread::Create(GeneratorThreads.back().get(), *ThreadName);
-				if (GeneratorThreads.back()->ThreadRef)
-				{
-					ThreadIDs[ThreadID] = true;
-				}
-				else
-				{
-					GeneratorThreads.pop_back();
-				}
+				OutOuterIndexes[CPathBrickMap::GetLocalIndex(X, Y, Z)] = LocalCoordsInt3ToIndex(FVector(X, Y, Z));
+				Count++;
 			}
-			//UE_LOG(LogTemp, Warning, TEXT("GENERATION UPDATE Tracked - %d, Indexes - %d, Threads - %d"), TrackedDynamicObstacles.size(), TreesToRegenerate.size(), ThreadCount);
+		}
+	}
+	return Count;
+}
+
+void ACPathVolume::GetBrickBounds(uint32 BrickIndex, FVector& OutCenter, FVector& OutExtent) const
+{
+	uint32 First[3], End[3];
+	BrickMap.GetBrickRange(BrickIndex, First, End);
+
+	// StartPosition is the center of the first tree
+	float OuterSize = GetVoxelSizeByDepth(0);
+	FVector Min = StartPosition + FVector(First[0], First[1], First[2]) * OuterSize - OuterSize / 2.f;
+	FVector Max = StartPosition + FVector(End[0] - 1, End[1] - 1, End[2] - 1) * OuterSize + OuterSize / 2.f;
+	OutCenter = (Min + Max) / 2.f;
+	OutExtent = (Max - Min) / 2.f;
+}
+
+void ACPathVolume::OnTreesRegenerated()
+{
+	// Obstacles may have left some bricks homogeneous again
+	std::set<uint32> RegeneratedBricks;
+	for (uint32 OuterIndex : TreesToRegenerate)
+	{
+		RegeneratedBricks.insert(CPathBrickMap::GetBrickIndex(GetOuterSlot(OuterIndex)));
+	}
+	for (uint32 BrickIndex : RegeneratedBricks)
+	{
+		CollapseBrick(BrickIndex);
+	}
+
+	if (LeafGraph.IsBuilt())
+	{
+		LeafGraph.Rebuild(this, TreesToRegenerate);
+		AbstractGraph.Rebuild(this, LeafGraph, TreesToRegenerate);
+	}
+	ClosestFreeLeafTable.Rebuild(this, TreesToRegenerate);
+	RegenerationCount++;
+	PathCache.Invalidate(TreesToRegenerate, RegenerationCount.load());
+
+	FScopeLock Lock(&FlowFieldsMutex);
+	for (std::weak_ptr<CPathFlowField>& WeakField : FlowFields)
+	{
+		if (std::shared_ptr<CPathFlowField> Field = WeakField.lock())
+		{
+			Field->InvalidateIfAffected(TreesToRegenerate);
 		}
 	}
 }
@@ -1083,21 +1793,63 @@ void ACPathVolume::CalcFitness(CPathAStarNode& Node, FVector TargetLocation, int
 	Node.FitnessResult = Node.DistanceSoFar + 3.5f * FVector::Distance(Node.WorldLocation, TargetLocation);
 }
 
-bool ACPathVolume::RecheckOctreeAtDepth(CPathOctree* OctreeRef, FVector TreeLocation, uint32 Depth)
+bool ACPathVolume::RecheckOctreeAtDepth(uint32& UserData, FVector TreeLocation, uint32 Depth)
+{
+	// The generator saves the return value as IsFree, AStar only considers nodes that are free.
+	return IsLocationFree(TreeLocation, Depth);
+}
+
+bool ACPathVolume::IsLocationFree(FVector TreeLocation, uint32 Depth) const
 {
-	bool IsFree = true;
-	for (auto Shape : TraceShapesByDepth[Depth])
+	if (!OccupancyProvider)
+		return IsLocationFreeByPhysics(TreeLocation, Depth);
+
+	const FCPathAsyncVolumeGenerator* Generator = FCPathAsyncVolumeGenerator::GetCurrent();
+	bool IsFree = Generator && Generator->CurrentBatch ? Generator->CurrentBatch->IsFree(TreeLocation, Depth) : OccupancyProvider->IsFree(this, TreeLocation, Depth);
+
+	// Dynamic obstacles are colliders, the provider may not know about them
+	if (IsFree && Generator && Generator->RegeneratingObstacles && !OccupancyProvider->UsesPhysics() && OccupancyProvider->DynamicObstaclesUsePhysics)
+		IsFree = IsLocationFreeByPhysics(TreeLocation, Depth);
+
+	return IsFree;
+}
+
+bool ACPathVolume::IsLocationFreeByPhysics(FVector TreeLocation, uint32 Depth) const
+{
+	const FCPathAsyncVolumeGenerator* Generator = FCPathAsyncVolumeGenerator::GetCurrent();
+	const CPathGeometryGather* Gather = Generator ? Generator->CurrentGather : nullptr;
+	for (const FCollisionShape& Shape : TraceShapesByDepth[Depth])
 	{
-		if (GetWorld()->OverlapAnyTestByChannel(TreeLocation, FQuat(FRotator(0)), TraceChannel, Shape))
-		{
-			IsFree = false;
-			break;
-		}
+		CPathGeometryGather::EResult Result = Gather ? Gather->Test(Shape, TreeLocation) : CPathGeometryGather::EResult::Unknown;
+		if (Result == CPathGeometryGather::EResult::Blocked)
+			return false;
+
+		if (Result == CPathGeometryGather::EResult::Unknown && GetWorld()->OverlapAnyTestByChannel(TreeLocation, FQuat(FRotator(0)), TraceChannel, Shape))
+			return false;
 	}
+	return true;
+}
 
-	// This is mandatory, as AStar only considers nodes that are free. 
-	OctreeRef->SetIsFree(IsFree);
-	return IsFree;
+bool ACPathVolume::IsBrickEmpty(FVector Center, FVector Extent)
+{
+	// Trees are checked with the agent shape at their center, so it can reach this far out of the brick
+	Extent += FVector(AgentRadius, AgentRadius, AgentShape == EAgentShape::Sphere ? AgentRadius : AgentHalfHeight);
+	if (OccupancyProvider)
+		return OccupancyProvider->IsBoxEmpty(this, Center, Extent);
+
+	return IsBoxEmptyByPhysics(Center, Extent);
+}
+
+bool ACPathVolume::IsBoxEmptyByPhysics(FVector Center, FVector Extent) const
+{
+	return !GetWorld()->OverlapAnyTestByChannel(Center, FQuat(FRotator(0)), TraceChannel, FCollisionShape::MakeBox(Extent));
+}
+
+bool ACPathVolume::UsesPhysicsOccupancy(bool RegeneratingObstacles) const
+{
+	if (!OccupancyProvider || OccupancyProvider->UsesPhysics())
+		return true;
+	return RegeneratingObstacles && OccupancyProvider->DynamicObstaclesUsePhysics;
 }
 
 const FVector ACPathVolume::LookupTable_ChildPositionOffsetMaskByIndex[8] = {
@@ -25,10 +25,10 @@ void ACPathVolumeGroundPrio::CalcFitness(CPathAStarNode& Node, FVector TargetLoc
 	
 }
 
-bool ACPathVolumeGroundPrio::RecheckOctreeAtDepth(CPathOctree* OctreeRef, FVector TreeLocation, uint32 Depth)
+bool ACPathVolumeGroundPrio::RecheckOctreeAtDepth(uint32& UserData, FVector TreeLocation, uint32 Depth)
 {
 	// We still want the normal trace to check if the node is free
-	bool IsFree = Super::RecheckOctreeAtDepth(OctreeRef, TreeLocation, Depth);
+	bool IsFree = Super::RecheckOctreeAtDepth(UserData, TreeLocation, Depth);
 	
 	// We dont need to calculate anything if its not free since it won't be searched
 	if (IsFree)
@@ -37,11 +37,20 @@ bool ACPathVolumeGroundPrio::RecheckOctreeAtDepth(CPathOctree* OctreeRef, FVecto
 		uint32 IsGround = GetWorld()->LineTraceTestByChannel(TreeLocation, FVector(TreeLocation.X, TreeLocation.Y, TreeLocation.Z - VoxelSize*1.49), TraceChannel);
 		
 		// Setting IsGround to 2nd bit in tree's data
-		OctreeRef->Data &= 0xFFFFFFFD;
-		OctreeRef->Data |= (IsGround << 1);
+		UserData &= 0xFFFFFFFD;
+		UserData |= (IsGround << 1);
 	}
 
 
 	return IsFree;
 	
 }
+
+bool ACPathVolumeGroundPrio::IsBrickEmpty(FVector Center, FVector Extent)
+{
+	// Free trees at the bottom of the brick save IsGround if there is ground below them, so the box goes down as far as that trace
+	float TraceLength = VoxelSize * 1.49f;
+	Center.Z -= TraceLength / 2.f;
+	Extent.Z += TraceLength / 2.f;
+	return Super::IsBrickEmpty(Center, Extent);
+}
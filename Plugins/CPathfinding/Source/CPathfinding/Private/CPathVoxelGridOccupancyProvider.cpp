@@ -0,0 +1,116 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#include "CPathVoxelGridOccupancyProvider.h"
+#include "CPathVolume.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "Serialization/MemoryReader.h"
+
+void UCPathVoxelGridOccupancyProvider::BeginGeneration(ACPathVolume* Volume)
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *GetFullPath()))
+	{
+		LoadFailed(TEXT("couldn't read the file"));
+		return;
+	}
+
+	FMemoryReader Reader(Bytes);
+	uint32 Magic = 0;
+	int32 Version = 0;
+	FVector3f FileOrigin;
+	Reader << Magic << Version << FileOrigin << CellSize << CellCount[0] << CellCount[1] << CellCount[2];
+	if (Reader.IsError() || Magic != FileMagic || Version != FileVersion)
+	{
+		LoadFailed(TEXT("not a voxel grid of this version"));
+		return;
+	}
+
+	int64 TotalCells = (int64)CellCount[0] * CellCount[1] * CellCount[2];
+	if (CellSize <= 0 || CellCount[0] <= 0 || CellCount[1] <= 0 || CellCount[2] <= 0 || Bytes.Num() - Reader.Tell() < (TotalCells + 7) / 8)
+	{
+		LoadFailed(TEXT("grid size doesn't match the file"));
+		return;
+	}
+	Origin = FVector(FileOrigin);
+	const uint8* Bits = Bytes.GetData() + Reader.Tell();
+
+	// Summed volume table, so that any box is counted from 8 corners
+	int32 SumsY = CellCount[1] + 1;
+	int32 SumsZ = CellCount[2] + 1;
+	OccupiedSums.assign((size_t)(CellCount[0] + 1) * SumsY * SumsZ, 0);
+	int64 Cell = 0;
+	for (int32 X = 1; X <= CellCount[0]; X++)
+	{
+		for (int32 Y = 1; Y <= CellCount[1]; Y++)
+		{
+			for (int32 Z = 1; Z <= CellCount[2]; Z++, Cell++)
+			{
+				uint32 Occupied = (Bits[Cell >> 3] >> (Cell & 7)) & 1;
+				OccupiedSums[((size_t)X * SumsY + Y) * SumsZ + Z] = Occupied
+					+ GetSum(X - 1, Y, Z) + GetSum(X, Y - 1, Z) + GetSum(X, Y, Z - 1)
+					- GetSum(X - 1, Y - 1, Z) - GetSum(X - 1, Y, Z - 1) - GetSum(X, Y - 1, Z - 1)
+					+ GetSum(X - 1, Y - 1, Z - 1);
+			}
+		}
+	}
+}
+
+bool UCPathVoxelGridOccupancyProvider::IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const
+{
+	if (OccupiedSums.empty())
+		return !OutsideIsOccupied;
+
+	// Cells the box touches, First inclusive, End not inclusive
+	FVector LocalMin = (Center - Extent - Origin) / CellSize;
+	FVector LocalMax = (Center + Extent - Origin) / CellSize;
+	int32 First[3], End[3];
+	bool ReachesOutside = false;
+	for (int Axis = 0; Axis < 3; Axis++)
+	{
+		int32 Min = FMath::FloorToInt32(LocalMin[Axis]);
+		int32 Max = FMath::CeilToInt32(LocalMax[Axis]);
+		ReachesOutside |= Min < 0 || Max > CellCount[Axis];
+		First[Axis] = FMath::Clamp(Min, 0, CellCount[Axis]);
+		End[Axis] = FMath::Clamp(Max, 0, CellCount[Axis]);
+	}
+
+	if (ReachesOutside && OutsideIsOccupied)
+		return false;
+
+	if (First[0] >= End[0] || First[1] >= End[1] || First[2] >= End[2])
+		return true;
+
+	uint32 Occupied = GetSum(End[0], End[1], End[2])
+		- GetSum(First[0], End[1], End[2]) - GetSum(End[0], First[1], End[2]) - GetSum(End[0], End[1], First[2])
+		+ GetSum(First[0], First[1], End[2]) + GetSum(First[0], End[1], First[2]) + GetSum(End[0], First[1], First[2])
+		- GetSum(First[0], First[1], First[2]);
+	return Occupied == 0;
+}
+
+uint32 UCPathVoxelGridOccupancyProvider::GetBakeHash() const
+{
+	uint32 Hash = Super::GetBakeHash();
+	Hash = HashCombine(Hash, GetTypeHash(VoxelFile.FilePath));
+	Hash = HashCombine(Hash, GetTypeHash(OutsideIsOccupied));
+
+	// The file can change without anything in the level changing
+	FString FullPath = GetFullPath();
+	Hash = HashCombine(Hash, GetTypeHash(IFileManager::Get().FileSize(*FullPath)));
+	return HashCombine(Hash, GetTypeHash(IFileManager::Get().GetTimeStamp(*FullPath).GetTicks()));
+}
+
+FString UCPathVoxelGridOccupancyProvider::GetFullPath() const
+{
+	if (FPaths::IsRelative(VoxelFile.FilePath))
+		return FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), VoxelFile.FilePath);
+	return VoxelFile.FilePath;
+}
+
+void UCPathVoxelGridOccupancyProvider::LoadFailed(const FString& Reason)
+{
+	UE_LOG(LogTemp, Warning, TEXT("CPATH - Voxel Grid:::Couldn't load %s, %s. Only OutsideIsOccupied is used."), *GetFullPath(), *Reason);
+	OccupiedSums.clear();
+	OccupiedSums.shrink_to_fit();
+}
@@ -1,6 +1,7 @@
 // Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
 
 #include "CPathfinding.h"
+#include "CPathGeneratorPool.h"
 
 #define LOCTEXT_NAMESPACE "FCPathfindingModule"
 
@@ -13,6 +14,9 @@ void FCPathfindingModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+
+	// Generator threads are shared by all volumes, so they live as long as the module
+	CPathGeneratorPool::Get().Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -37,6 +37,11 @@ FCPathfindingThread::~FCPathfindingThread()
 		delete AStar;
 		AStar = nullptr;
 	}
+	for (FSlicedSearch& Search : SlicedSearches)
+	{
+		delete Search.Result;
+	}
+	SlicedSearches.clear();
 }
 
 bool FCPathfindingThread::Init()
@@ -51,7 +56,7 @@ uint32 FCPathfindingThread::Run()
 	while (!KillRequested.load())
 	{
 		// Getting/waiting for new request
-		if (InputQueue.IsEmpty())
+		if (InputQueue.IsEmpty() && SlicedSearches.empty())
 		{
 			IsDoingWork = false;
 			PrintThreadMessage(FString::Printf(TEXT("WaitingForTask. CurrentTaskCount= %d, TasksSubmited= %d, TasksAssigned= %d"), CurrentTaskCount.load(), TasksSubmited, TasksAssigned));
@@ -60,51 +65,137 @@ uint32 FCPathfindingThread::Run()
 				return 0;
 			IsDoingWork = true;
 		}
-		FCPathRequest Request;
-		if (!InputQueue.Dequeue(Request))
-			continue;
 
-		// After volume is generated and valid, performing FindPath call
-		if (WaitForVolume(Request.VolumeRef))
+		// New requests go first, so that short ones don't wait behind sliced searches that take long
+		FCPathRequest Request;
+		if (InputQueue.Dequeue(Request))
 		{
-			Request.VolumeRef->PathfindersRunning++;
-
-			// State of the volume could have changed during incrementing the atomic variable
-			// So it's necessary to check it again before doing any pathfinding
-			if (WaitForVolume(Request.VolumeRef))
+			if (Request.SliceTimeLimit > 0 && !Request.FlowField)
 			{
+				FSlicedSearch Search;
+				if (FreeContexts.size())
+				{
+					Search.Context = std::move(FreeContexts.back());
+					FreeContexts.pop_back();
+					Search.Context->Reset(Request);
+				}
+				else
+				{
+					Search.Context = std::make_unique<CPathSearchContext>(Request);
+				}
+
 				// This is deleted in CPathCore::Tick
-				FCPathResult* Result = new FCPathResult();
+				Search.Result = new FCPathResult();
+
+				// Its first slice is done right below, it may not even need another one
+				SlicedSearches.push_front(std::move(Search));
+			}
+			else
+			{
+				ProcessRequest(Request);
+			}
+		}
 
-				Result->FailReason = AStar->FindPath(Request.VolumeRef, Result, Request.Start, Request.End,
-					Request.SmoothingPasses, Request.UserData, Request.TimeLimit,
-					Request.RequestRawPath, Request.RequestUserPath);
-					
-				Request.VolumeRef->PathfindersRunning--;
+		// Then one slice of a sliced search
+		if (!SlicedSearches.empty() && !KillRequested)
+		{
+			FSlicedSearch Search = std::move(SlicedSearches.front());
+			SlicedSearches.pop_front();
+			if (ProcessSlice(Search))
+			{
+				FreeContexts.push_back(std::move(Search.Context));
+			}
+			else
+			{
+				SlicedSearches.push_back(std::move(Search));
+			}
+		}
+	}
+	return 0;
+}
 
-				// Thread could be stopped during pathfinding
-				// In this case we dont have a proper result
-				if (KillRequested)
-				{
-					delete Result;
-					return 0;
-				}
+void FCPathfindingThread::ProcessRequest(FCPathRequest& Request)
+{
+	// After volume is generated and valid, performing FindPath call
+	if (WaitForVolume(Request.VolumeRef))
+	{
+		Request.VolumeRef->PathfindersRunning++;
 
-				SubmitResult(Result, Request.OnPathFound);
+		// State of the volume could have changed during incrementing the atomic variable
+		// So it's necessary to check it again before doing any pathfinding
+		if (WaitForVolume(Request.VolumeRef))
+		{
+			// This is deleted in CPathCore::Tick
+			FCPathResult* Result = new FCPathResult();
+
+			if (Request.FlowField)
+			{
+				Result->FlowField = Request.VolumeRef->FindFlowField(Request.End, Request.UserData, Request.FlowFieldMaxDistance, Request.TimeLimit, Result->FailReason);
 			}
 			else
 			{
-				Request.VolumeRef->PathfindersRunning--;
-				CurrentTaskCount--;
+				Result->FailReason = AStar->FindPath(Request, Result);
+			}
+				
+			Request.VolumeRef->PathfindersRunning--;
+
+			// Thread could be stopped during pathfinding
+			// In this case we dont have a proper result
+			if (KillRequested)
+			{
+				delete Result;
+				return;
 			}
+
+			SubmitResult(Result, Request.OnPathFound);
 		}
 		else
 		{
+			Request.VolumeRef->PathfindersRunning--;
 			CurrentTaskCount--;
 		}
-	
 	}
-	return 0;
+	else
+	{
+		CurrentTaskCount--;
+	}
+}
+
+bool FCPathfindingThread::ProcessSlice(FSlicedSearch& Search)
+{
+	FCPathRequest& Request = Search.Context->Request;
+
+	// Same as in ProcessRequest. Volume is free to regenerate between slices, the search restarts if it did.
+	bool bFinished = true;
+	if (WaitForVolume(Request.VolumeRef))
+	{
+		Request.VolumeRef->PathfindersRunning++;
+		if (WaitForVolume(Request.VolumeRef))
+		{
+			bFinished = AStar->FindPathSliced(*Search.Context, Search.Result, Request.SliceTimeLimit);
+			Request.VolumeRef->PathfindersRunning--;
+
+			if (KillRequested)
+			{
+				delete Search.Result;
+				Search.Result = nullptr;
+				return true;
+			}
+
+			if (bFinished)
+			{
+				SubmitResult(Search.Result, Request.OnPathFound);
+				Search.Result = nullptr;
+			}
+			return bFinished;
+		}
+		Request.VolumeRef->PathfindersRunning--;
+	}
+
+	delete Search.Result;
+	Search.Result = nullptr;
+	CurrentTaskCount--;
+	return true;
 }
 
 void FCPathfindingThread::Stop()
@@ -0,0 +1,103 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathDefines.h"
+#include <vector>
+#include <set>
+
+class ACPathVolume;
+class CPathLeafGraph;
+class CPathVisitedTable;
+
+/**
+ *
+ */
+
+
+// Graph for hierarchical pathfinding, built on top of CPathLeafGraph.
+// Outer trees are grouped into clusters of ClusterSize^3. Each connected group of free leafs inside a cluster is an abstract node,
+// and two abstract nodes are linked if any of their leafs are adjacent (a portal between the clusters).
+// Long searches first find a path of abstract nodes, and then search leafs only in clusters along that path (the corridor).
+class CPATHFINDING_API CPathAbstractGraph
+{
+public:
+	CPathAbstractGraph();
+	~CPathAbstractGraph();
+
+	static constexpr uint32 InvalidNode = 0xFFFFFFFF;
+
+	// LeafGraph must already be built
+	void Build(ACPathVolume* Volume, const CPathLeafGraph& LeafGraph, uint32 InClusterSize);
+
+	// Rebuilds clusters containing given outer trees. LeafGraph must already be rebuilt for them.
+	void Rebuild(ACPathVolume* Volume, const CPathLeafGraph& LeafGraph, const std::set<uint32>& OuterIndices);
+
+	void Clear();
+
+	FORCEINLINE bool IsBuilt() const
+	{
+		return bIsBuilt;
+	}
+
+	// NO BOUNDS CHECK
+	FORCEINLINE uint32 GetClusterByOuterIndex(uint32 OuterIndex) const
+	{
+		return ClusterByOuterIndex[OuterIndex];
+	}
+
+	FORCEINLINE uint32 GetClusterCount() const
+	{
+		return (uint32)Clusters.size();
+	}
+
+	// Finds a path of abstract nodes between two leafs of the leaf graph, and adds clusters along it (and ones adjacent to them) to OutCorridor.
+	// Returns false if the leafs are not connected, in which case there is no path between them at all.
+	// Safe to call from multiple threads, as long as the graph isn't being rebuilt.
+	bool FindCorridor(CPathLeafRef StartLeafRef, CPathLeafRef EndLeafRef, CPathVisitedTable& OutCorridor) const;
+
+private:
+	struct Edge
+	{
+		uint32 Cluster;
+		uint32 Node;
+		float Cost;
+	};
+
+	struct AbstractNode
+	{
+		// Average location of its leafs, edge costs are distances between these
+		FVector Center;
+		std::vector<Edge> Edges;
+	};
+
+	struct Cluster
+	{
+		std::vector<AbstractNode> Nodes;
+	};
+
+	std::vector<Cluster> Clusters;
+
+	std::vector<uint32> ClusterByOuterIndex;
+
+	// Index of the abstract node (in its cluster) for every leaf, by OuterIndex and index of the leaf in its slice
+	std::vector<std::vector<uint32>> NodeByLeaf;
+
+	uint32 ClusterSize = 4;
+	uint32 ClusterCount[3] = { 0, 0, 0 };
+
+	bool bIsBuilt = false;
+
+	// Outer indexes in the cluster
+	void GetOuterIndexes(ACPathVolume* Volume, uint32 ClusterIndex, std::vector<uint32>& OutIndexes) const;
+
+	// Returns number of neighbours written to OutNeighbours
+	uint32 GetClusterNeighbours(uint32 ClusterIndex, uint32 OutNeighbours[6]) const;
+
+	// Step 1 - flood fills leafs of the cluster into abstract nodes. Doesn't touch other clusters.
+	void BuildClusterNodes(ACPathVolume* Volume, const CPathLeafGraph& LeafGraph, uint32 ClusterIndex);
+
+	// Step 2 - links nodes of the cluster with nodes of adjacent clusters. Adjacent clusters must already have their nodes.
+	void BuildClusterEdges(ACPathVolume* Volume, const CPathLeafGraph& LeafGraph, uint32 ClusterIndex);
+};
@@ -0,0 +1,45 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathOccupancyProvider.h"
+#include "CPathAnalyticOccupancyProvider.generated.h"
+
+/**
+ *
+ */
+
+
+USTRUCT(BlueprintType)
+struct CPATHFINDING_API FCPathAnalyticSphere
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CPath")
+		FVector Center = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CPath", meta = (ClampMin = "0", UIMin = "0"))
+		float Radius = 100;
+};
+
+
+// Occupied space is a list of world space boxes and spheres, no physics involved.
+// For procedural or server side worlds that know their blockers without spawning colliders, and for testing.
+UCLASS(meta = (DisplayName = "Analytic Shapes"))
+class CPATHFINDING_API UCPathAnalyticOccupancyProvider : public UCPathOccupancyProvider
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CPath")
+		TArray<FBox> Boxes;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "CPath")
+		TArray<FCPathAnalyticSphere> Spheres;
+
+	virtual bool IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const override;
+
+	virtual uint32 GetBakeHash() const override;
+};
@@ -5,23 +5,26 @@
 #include "CoreMinimal.h"
 #include "HAL/Runnable.h"
 #include "HAL/RunnableThread.h"
+#include "CPathDefines.h"
+#include "CPathOctreeAllocator.h"
+#include "CPathGeometryGather.h"
+#include "CPathOccupancyBatch.h"
 
 class ACPathVolume;
 class CPathOctree;
+class CPathGeneratorPool;
+struct CPathGenerationJob;
 
 
 
-
+// Persistent worker of CPathGeneratorPool, takes jobs of any volume
 class CPATHFINDING_API FCPathAsyncVolumeGenerator : public FRunnable
 {
 
 
 public:
-	// Geneated trees in range Start(inclusive) - End(not inclusive). If Obstacles = true, it takes from Volume->TreesToRegenerate, if not, it takes from Volume->Octrees (default)
-	FCPathAsyncVolumeGenerator(ACPathVolume* Volume, uint32 StartIndex, uint32 EndIndex, uint8 ThreadID, FString ThreadName, bool Obstacles = false);
-
-	// Not used for now
-	FCPathAsyncVolumeGenerator(ACPathVolume* Volume);
+	// Without a Pool, no thread is created and the generator only works through WorkOnJob (used for baking)
+	FCPathAsyncVolumeGenerator(CPathGeneratorPool* Pool, uint8 ThreadID);
 
 	~FCPathAsyncVolumeGenerator();
 
@@ -33,12 +36,17 @@ public:
 
 	virtual void Exit();
 
-	bool HasFinishedWorking();
+	// Claims chunks of the job until there are none left, then flushes AllocatorCache and adds OctreeCountAtDepth to the job
+	void WorkOnJob(CPathGenerationJob& Job);
+
+	// Makes an idle worker look for a job
+	void WakeUp();
 
 	// The main generating function, generated/regenerates the whole octree at given index
 	void RefreshTree(uint32 OuterIndex);
 
-	bool bObstacles = false;
+	// Initial generation of a brick, skips its trees if Volume->IsBrickEmpty
+	void RefreshBrick(uint32 BrickIndex);
 
 	FRunnableThread* ThreadRef = nullptr;
 
@@ -48,26 +56,45 @@ public:
 
 	FString Name = "";
 
-	uint32 OctreeCountAtDepth[4] = { 0, 0, 0, 0 };
+	// Of the current job
+	uint32 OctreeCountAtDepth[MAX_DEPTH + 1] = { 0 };
+
+	// Generator running RefreshTree on this thread, nullptr otherwise.
+	// ACPathVolume::IsLocationFree reads the fields below from it, so that RecheckOctreeAtDepth overrides don't need more parameters.
+	static const FCPathAsyncVolumeGenerator* GetCurrent();
+
+	// Shapes overlapping the current outer tree, nullptr if they weren't gathered
+	const CPathGeometryGather* CurrentGather = nullptr;
+
+	// Occupancy of the current outer tree, nullptr if the provider doesn't answer whole trees
+	const CPathOccupancyBatch* CurrentBatch = nullptr;
+
+	// The current job regenerates trees for dynamic obstacles
+	bool RegeneratingObstacles = false;
 
 
 protected:
 
-	ACPathVolume* VolumeRef;
+	CPathGeneratorPool* PoolRef = nullptr;
+
+	// Volume of the current job
+	ACPathVolume* VolumeRef = nullptr;
 
-	uint32 FirstIndex = 0;
-	uint32 LastIndex = 0;
 	std::atomic_bool RequestedKill = false;
-	std::atomic_bool ThreadExited = false;
 
-	bool bIncreasedGenRunning = false;
+	FEvent* Semaphore = nullptr;
 
-	// Gets called by RefreshTree. Returns true if ANY child is free
-	bool RefreshTreeRec(CPathOctree* OctreeRef, uint32 Depth, FVector TreeLocation);
+	// Child blocks are allocated and freed through this, flushed into the volume's allocator after each job
+	CPathOctreeAllocator::LocalCache AllocatorCache;
 
-	bool ShouldWakeUp();
+	CPathGeometryGather Gather;
+
+	CPathOccupancyBatch Batch;
+
+	// Gets called by RefreshTree. Returns true if ANY child is free
+	bool RefreshTreeRec(CPathOctree* OctreeRef, uint64 OuterSlot, CPathTreeID TreeID, uint32 Depth, FVector TreeLocation);
 
-	TFunctionRef< bool()> WakeUpCondition;
+	bool ShouldWakeUp(const CPathGenerationJob& Job);
 
 public:
 
@@ -0,0 +1,36 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "Serialization/BulkData.h"
+#include "CPathBakedVolumeData.generated.h"
+
+// Octree of a CPathVolume generated in the editor, saved with the level so that the volume doesn't have to generate it on BeginPlay.
+// Created by the CPath.BakeVolumes editor command (see ACPathVolume::BakeGraph).
+// The octree is bulk data outside of the export, so it's only read from disk when the volume loads it.
+UCLASS()
+class CPATHFINDING_API UCPathBakedVolumeData : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UCPathBakedVolumeData();
+
+	virtual void Serialize(FArchive& Ar) override;
+
+	// ACPathVolume::ComputeBakeHash when this was baked. If it doesn't match anymore, the volume generates instead.
+	UPROPERTY(VisibleAnywhere, Category = CPath)
+		uint32 BakeHash = 0;
+
+	// Size of OctreeData, for the details panel
+	UPROPERTY(VisibleAnywhere, Category = CPath)
+		int64 BakedBytes = 0;
+
+	// Written by ACPathVolume::SaveOctree
+	FByteBulkData OctreeData;
+
+	// Replaces OctreeData with Bytes
+	void SetOctreeData(const TArray<uint8>& Bytes);
+};
@@ -0,0 +1,101 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathOctree.h"
+#include <vector>
+#include <memory>
+
+/**
+ *
+ */
+
+
+// Outer trees of the volume, grouped into bricks of 4x4x4. A brick that is all free or all occupied is stored as just its state,
+// only bricks with something in them (Mixed) have their own 64 CPathOctree. Trees of a homogeneous brick are childless,
+// GetTree returns one shared empty tree for all of them, which must never be written to.
+// A tree is addressed by OuterSlot = BrickIndex * TreesPerBrick + index of the tree in its brick.
+// Coordinates outside of the volume (padding of MortonOrder) map to a brick after the last one, which is always Blocked.
+class CPATHFINDING_API CPathBrickMap
+{
+public:
+	CPathBrickMap();
+	~CPathBrickMap();
+
+	static constexpr uint32 BrickBits = 2;
+	static constexpr uint32 BrickSize = 1 << BrickBits;
+	static constexpr uint32 TreesPerBrick = BrickSize * BrickSize * BrickSize;
+
+	enum class EBrickState : uint8
+	{
+		Blocked,
+		Free,
+		Mixed
+	};
+
+	// Every brick starts Blocked, InNodeCount is ACPathVolume::NodeCount
+	void Init(const uint32 InNodeCount[3]);
+
+	void Clear();
+
+	FORCEINLINE uint32 GetBrickCount() const
+	{
+		return BrickCount[0] * BrickCount[1] * BrickCount[2];
+	}
+
+	static FORCEINLINE uint32 GetBrickIndex(uint64 OuterSlot)
+	{
+		return (uint32)(OuterSlot / TreesPerBrick);
+	}
+
+	static FORCEINLINE uint32 GetLocalIndex(uint32 X, uint32 Y, uint32 Z)
+	{
+		return ((X & (BrickSize - 1)) << (2 * BrickBits)) | ((Y & (BrickSize - 1)) << BrickBits) | (Z & (BrickSize - 1));
+	}
+
+	// Local coordinates of an outer tree, as in ACPathVolume::LocalCoordsInt3FromOuterIndex
+	FORCEINLINE uint64 GetOuterSlot(uint32 X, uint32 Y, uint32 Z) const
+	{
+		if (X >= NodeCount[0] || Y >= NodeCount[1] || Z >= NodeCount[2])
+			return (uint64)GetBrickCount() * TreesPerBrick;
+
+		uint32 BrickIndex = ((X >> BrickBits) * BrickCount[1] + (Y >> BrickBits)) * BrickCount[2] + (Z >> BrickBits);
+		return (uint64)BrickIndex * TreesPerBrick + GetLocalIndex(X, Y, Z);
+	}
+
+	// Coordinates of the trees in the brick are OutFirst (inclusive) - OutEnd (not inclusive), cut at the edges of the volume
+	void GetBrickRange(uint32 BrickIndex, uint32 OutFirst[3], uint32 OutEnd[3]) const;
+
+	FORCEINLINE EBrickState GetState(uint32 BrickIndex) const
+	{
+		return States[BrickIndex];
+	}
+
+	FORCEINLINE CPathOctree* GetTree(uint64 OuterSlot)
+	{
+		CPathOctree* BrickTrees = Trees[GetBrickIndex(OuterSlot)].get();
+		return BrickTrees ? &BrickTrees[OuterSlot % TreesPerBrick] : &HomogeneousTree;
+	}
+
+	// Gives the brick its own childless trees and makes it Mixed. Does nothing if it's Mixed already.
+	void Materialize(uint32 BrickIndex);
+
+	// Frees trees of the brick, they must not have children anymore
+	void SetHomogeneous(uint32 BrickIndex, bool IsFree);
+
+	// Bricks that have their own trees
+	uint32 GetMixedBrickCount() const;
+
+	int64 GetAllocatedBytes() const;
+
+private:
+	uint32 NodeCount[3] = { 0, 0, 0 };
+	uint32 BrickCount[3] = { 0, 0, 0 };
+
+	// Both have one more element than there are bricks, for coordinates outside of the volume
+	std::vector<EBrickState> States;
+	std::vector<std::unique_ptr<CPathOctree[]>> Trees;
+
+	CPathOctree HomogeneousTree;
+};
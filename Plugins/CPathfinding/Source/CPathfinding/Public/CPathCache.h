@@ -0,0 +1,100 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathDefines.h"
+#include "HAL/CriticalSection.h"
+#include <vector>
+#include <list>
+#include <set>
+#include <unordered_map>
+#include <atomic>
+
+/**
+ *
+ */
+
+
+// Node of a cached path, before smoothing
+struct CPathCachedNode
+{
+	FVector WorldLocation;
+	CPathTreeID TreeID;
+	uint32 TreeUserData;
+};
+
+// LRU cache of raw A* paths, keyed by start leaf, end leaf, UserData, AgentRadius and AnyAngle of the request.
+// Each entry remembers outer trees its path goes through, so that regenerating part of the volume removes only paths that could be affected.
+// Safe to use from multiple threads.
+class CPATHFINDING_API CPathCache
+{
+public:
+	CPathCache();
+	~CPathCache();
+
+	// Oldest entries are removed if there are more than this. 0 disables the cache.
+	void SetCapacity(uint32 InCapacity);
+
+	FORCEINLINE uint32 GetCapacity() const
+	{
+		return Capacity.load();
+	}
+
+	// Copies nodes of the cached path (from start leaf to end leaf) to OutNodes. Returns false if there is no such path.
+	bool Find(CPathTreeID StartLeaf, CPathTreeID EndLeaf, int32 UserData, float AgentRadius, bool AnyAngle, std::vector<CPathCachedNode>& OutNodes);
+
+	// Regeneration is the ACPathVolume::RegenerationCount from when the search started.
+	// If the volume has regenerated since then, the path is not added, as it could go through new obstacles.
+	void Add(CPathTreeID StartLeaf, CPathTreeID EndLeaf, int32 UserData, float AgentRadius, bool AnyAngle, std::vector<CPathCachedNode>&& Nodes, uint32 Regeneration);
+
+	// Removes paths going through any of the outer trees. NewRegeneration is the volume's RegenerationCount after the update.
+	void Invalidate(const std::set<uint32>& OuterIndices, uint32 NewRegeneration);
+
+	void Clear();
+
+	uint32 Num();
+
+private:
+	struct Key
+	{
+		CPathTreeID StartLeaf;
+		CPathTreeID EndLeaf;
+		int32 UserData;
+		float AgentRadius;
+
+		// Any-angle paths skip smoothing, so they can't be mixed with grid paths
+		bool AnyAngle;
+
+		bool operator ==(const Key& Rhs) const
+		{
+			return StartLeaf == Rhs.StartLeaf && EndLeaf == Rhs.EndLeaf && UserData == Rhs.UserData && AgentRadius == Rhs.AgentRadius && AnyAngle == Rhs.AnyAngle;
+		}
+
+		struct Hash
+		{
+			size_t operator()(const Key& InKey) const
+			{
+				return ((size_t)InKey.StartLeaf * 0x9E3779B1u) ^ ((size_t)InKey.EndLeaf << 16) ^ (size_t)InKey.UserData ^ ((size_t)InKey.AnyAngle << 31);
+			}
+		};
+	};
+
+	struct Entry
+	{
+		Key EntryKey;
+		std::vector<CPathCachedNode> Nodes;
+
+		// Sorted, without duplicates
+		std::vector<uint32> OuterIndices;
+	};
+
+	// Most recently used at the front
+	std::list<Entry> Entries;
+	std::unordered_map<Key, std::list<Entry>::iterator, Key::Hash> EntriesByKey;
+
+	std::atomic<uint32> Capacity = 0;
+	uint32 Regeneration = 0;
+
+	FCriticalSection Mutex;
+};
@@ -0,0 +1,66 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathDefines.h"
+#include <vector>
+#include <set>
+
+class ACPathVolume;
+class CPathVisitedTable;
+
+/**
+ *
+ */
+
+
+// For every occupied leaf, the closest free leaf to it, built during generation so that snapping a blocked start/end location
+// to the graph is a lookup instead of a search with physics traces.
+// Stored in one slice per outer (depth 0) tree. The closest free leaf is searched for in the outer tree and its 6 adjacent ones,
+// so regenerating an outer tree only needs slices of it and its neighbours rebuilt.
+class CPATHFINDING_API CPathClosestFreeLeafTable
+{
+public:
+	CPathClosestFreeLeafTable();
+	~CPathClosestFreeLeafTable();
+
+	// Builds slices for all outer trees of the volume. Uses all available cores.
+	void Build(ACPathVolume* Volume);
+
+	// Rebuilds slices of given outer trees and of trees adjacent to them
+	void Rebuild(ACPathVolume* Volume, const std::set<uint32>& OuterIndices);
+
+	void Clear();
+
+	FORCEINLINE bool IsBuilt() const
+	{
+		return bIsBuilt;
+	}
+
+	// Returns false if TreeID is not an occupied leaf, or there is no free leaf close to it.
+	// OutDistance is the distance from the center of the occupied leaf to the border of the free one.
+	bool Find(CPathTreeID TreeID, CPathTreeID& OutFreeTreeID, float& OutDistance) const;
+
+private:
+	struct Entry
+	{
+		CPathTreeID TreeID;
+		CPathTreeID FreeTreeID;
+		float Distance;
+	};
+
+	struct Slice
+	{
+		// Sorted by TreeID
+		std::vector<Entry> Entries;
+	};
+
+	std::vector<Slice> Slices;
+
+	bool bIsBuilt = false;
+
+	// Multi source Dijkstra from free leafs through occupied ones, limited to the outer tree and its neighbours.
+	// Only occupied leafs of the outer tree are saved.
+	void BuildSlice(ACPathVolume* Volume, uint32 OuterIndex, CPathVisitedTable& Visited);
+};
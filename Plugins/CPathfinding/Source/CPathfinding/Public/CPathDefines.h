@@ -6,12 +6,40 @@
 #include "CPathDefines.generated.h"
 
 // TreeID settings
-// If you change these, you will also need to change some masks in functions like ReplaceDepth, ExtractDepth, etc
+// TreeID is [outer index - DEPTH_0_BITS][depth - DEPTH_BITS][child index at depth 1 - 3 bits][child index at depth 2 - 3 bits]...
+// 32 bit TreeIDs allow 2^21 outer trees and depth up to 3.
+// Define CPATH_64BIT_TREEID as 1 (in Build.cs or here) for 2^31 outer trees and depth up to 6, for volumes covering large worlds.
+// Outer indexes are uint32 everywhere and 0xFFFFFFFF is reserved as invalid, so depth 0 never gets more than 31 bits.
+// That doubles the memory of everything that stores TreeIDs (leaf graph, caches, flow fields) and makes pathfinding a bit slower.
+#ifndef CPATH_64BIT_TREEID
+#define CPATH_64BIT_TREEID 0
+#endif
+
+#if CPATH_64BIT_TREEID
+typedef uint64 CPathTreeID;
+#define DEPTH_0_BITS 31
+#define DEPTH_BITS 3
+#define MAX_DEPTH 6
+#else
+typedef uint32 CPathTreeID;
 #define DEPTH_0_BITS 21
-#define DEPTH_0_LIMIT (uint32)1<<DEPTH_0_BITS
-#define DEPTH_0_MASK 0x001FFFFF
-#define DEPTH_MASK 0x00600000
+#define DEPTH_BITS 2
 #define MAX_DEPTH 3
+#endif
+
+#define DEPTH_0_LIMIT ((CPathTreeID)1 << DEPTH_0_BITS)
+#define DEPTH_0_MASK (DEPTH_0_LIMIT - 1)
+#define DEPTH_MASK ((((CPathTreeID)1 << DEPTH_BITS) - 1) << DEPTH_0_BITS)
+// Bit where the child index at depth 1 starts
+#define CHILD_INDEX_OFFSET (DEPTH_0_BITS + DEPTH_BITS)
+#define INVALID_TREE_ID ((CPathTreeID)-1)
+
+// Reference to a leaf of CPathLeafGraph, packs the outer index the same way as TreeID so it needs the same width
+typedef CPathTreeID CPathLeafRef;
+
+static_assert(DEPTH_0_BITS <= 31, "CPATH - Outer indexes must fit in 31 bits");
+static_assert(MAX_DEPTH < (1 << DEPTH_BITS), "CPATH - MAX_DEPTH doesn't fit in DEPTH_BITS");
+static_assert(CHILD_INDEX_OFFSET + MAX_DEPTH * 3 <= sizeof(CPathTreeID) * 8, "CPATH - TreeID is too small for these settings");
 
 // Time measurement macros
 #define TIMENOW std::chrono::steady_clock::now()
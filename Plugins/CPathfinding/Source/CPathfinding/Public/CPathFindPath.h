@@ -5,6 +5,8 @@
 
 #include "CoreMinimal.h"
 #include "CPathNode.h"
+#include "CPathSearchContext.h"
+#include "CPathCache.h"
 #include "HAL/Runnable.h"
 #include "HAL/RunnableThread.h"
 #include "Kismet/BlueprintAsyncActionBase.h"
@@ -34,6 +36,15 @@ public:
 	// Can be called from main thread, but can freeze the game if you increase TimeLimit.
 	ECPathfindingFailReason FindPath(ACPathVolume* VolumeRef, FCPathResult* Result, FVector Start, FVector End, uint32 SmoothingPasses = 2, int32 UserData = 0, float TimeLimit = 0.15f, bool RequestRawPath = false, bool RequestUserPath = true);
 
+	// Same as above, with parameters in the request struct. Callback in the request is not used.
+	ECPathfindingFailReason FindPath(const FCPathRequest& Request, FCPathResult* Result);
+
+	// Searches for a path described by Context.Request for at most SliceTimeLimit seconds (or the rest of Request.TimeLimit, if it's lower).
+	// Returns true if the search ended and Result is filled, false if it should be called again with the same Context and Result.
+	// If the volume was regenerated since the previous slice, the search starts over, but the time already spent still counts.
+	// The caller must make sure that the volume isn't generating during the call, same as with FindPath.
+	bool FindPathSliced(CPathSearchContext& Context, FCPathResult* Result, float SliceTimeLimit);
+
 	// Set this to true to interrupt pathfinding. FindPath returns an empty array.
 	// This is set to false at the beginning of each FindPath call!
 	std::atomic_bool bStop = false;
@@ -63,7 +74,41 @@ private:
 	FVector TargetLocation; 
 	ACPathVolume* CurrentVolumeRef;
 
-	// Sweeps from Start to End using the tracing shape from volume. Returns true if no obstacles
+	// AgentRadius of the current request if leafs need to be checked for clearance, 0 otherwise
+	float CurrentMinClearance = 0;
+
+	// Used by FindPath. It is reset, not freed, so each instance (one per pathfinding thread + the synchronous one) reuses its memory.
+	CPathSearchContext DefaultContext;
+
+	// Filled by FindFreeNeighbourLeafs for every expanded node. Its capacity is kept, so the search loop doesn't allocate.
+	std::vector<CPathAStarNode> NeighbourBuffer;
+
+	// Filled by PathCache.Find
+	std::vector<CPathCachedNode> CachedPathBuffer;
+
+	// Passed to FindClosestFreeLeaf so that it doesn't build a new set on every call
+	CPathVisitedTable ClosestLeafVisited = CPathVisitedTable(256);
+
+	// Resets the context and finds the start and end leafs, Result is only touched on failure
+	ECPathfindingFailReason BeginSearch(CPathSearchContext& Context, FCPathResult* Result);
+
+	// Pops the best node of the frontier and adds its neighbours.
+	// Returns the popped node if it's where the search ends - target node, or a node already reached by Other frontier if it's not null.
+	CPathAStarNode* ExpandFrontier(CPathSearchContext& Context, CPathSearchFrontier& Frontier, const CPathSearchFrontier* Other);
+
+	// Lazy Theta* - called when an expanded node can't see its parent, links it to the best of its visited neighbours instead, closed ones first
+	void FixAnyAngleParent(CPathSearchContext& Context, CPathSearchFrontier& Frontier, CPathAStarNode& Node);
+
+	// Links the backward half of a bidirectional path to the forward one, so it can be processed like a normal path. Returns the new end of the path.
+	CPathAStarNode* JoinPaths(CPathAStarNode* ForwardNode, CPathAStarNode* BackwardNode);
+
+	// Remembers the path in the volume's PathCache, before smoothing changes it
+	void AddToCache(CPathSearchContext& Context, CPathAStarNode* FoundPathEnd);
+
+	// Post processing of a found path, fills Result
+	void FinishSearch(CPathSearchContext& Context, FCPathResult* Result, CPathAStarNode* FoundPathEnd);
+
+	// Checks line of sight in the octree, or sweeps from Start to End using the tracing shape from volume if PhysicsSmoothing is set. Returns true if no obstacles
 	bool CanSkip(FVector Start, FVector End);
 
 	// Iterates over the path from end to start, removing every other node if CanSkip returns true
@@ -0,0 +1,99 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathVisitedTable.h"
+#include <vector>
+#include <set>
+#include <atomic>
+
+class ACPathVolume;
+
+/**
+ *
+ */
+
+
+// Distances and directions to one target from every free leaf around it, computed once by a reverse Dijkstra search from the target leaf.
+// Many agents heading to the same place can share one field instead of each searching for its own path.
+// A field doesn't change after it's built, so it can be sampled from any thread. Fields are shared through std::shared_ptr,
+// the volume keeps track of them and gives the same field to requests with the same target leaf, see ACPathVolume::FindFlowField.
+class CPATHFINDING_API CPathFlowField
+{
+public:
+	CPathFlowField();
+	~CPathFlowField();
+
+	static constexpr uint32 InvalidEntry = 0xFFFFFFFF;
+
+	// Leafs further than MaxDistance from the target are not included, unless MaxDistance <= 0.
+	// Stops after TimeLimit seconds, in which case IsComplete() returns false and only the closest leafs are in the field.
+	void Build(ACPathVolume* Volume, CPathTreeID InTargetTreeID, int32 InUserData, float InMaxDistance, float TimeLimit);
+
+	// Finds the leaf at WorldLocation and returns the location of the next leaf towards the target, and distance to the target.
+	// In the target leaf, OutNextLocation is the center of that leaf and OutDistance is 0.
+	// Returns false if the location isn't in any leaf of the field.
+	bool Sample(ACPathVolume* Volume, FVector WorldLocation, FVector& OutNextLocation, float& OutDistance) const;
+
+	// Same as above, for a known free leaf
+	bool SampleLeaf(CPathTreeID TreeID, FVector& OutNextLocation, float& OutDistance) const;
+
+	// False once a dynamic obstacle regenerated any of the trees the field covers. Agents should request a new field then.
+	FORCEINLINE bool IsValid() const
+	{
+		return bValid.load();
+	}
+
+	FORCEINLINE bool IsComplete() const
+	{
+		return bComplete;
+	}
+
+	FORCEINLINE CPathTreeID GetTargetTreeID() const
+	{
+		return TargetTreeID;
+	}
+
+	FORCEINLINE int32 GetUserData() const
+	{
+		return UserData;
+	}
+
+	FORCEINLINE float GetMaxDistance() const
+	{
+		return MaxDistance;
+	}
+
+	FORCEINLINE uint32 Num() const
+	{
+		return (uint32)Entries.size();
+	}
+
+	// Marks the field invalid if it covers any of the outer trees
+	void InvalidateIfAffected(const std::set<uint32>& OuterIndices);
+
+private:
+	struct Entry
+	{
+		FVector WorldLocation;
+		float Distance;
+
+		// Entry of the next leaf towards the target, InvalidEntry for the target
+		uint32 Next;
+	};
+
+	std::vector<Entry> Entries;
+
+	// TreeID -> index in Entries
+	CPathVisitedTable EntryByTreeID;
+
+	// Sorted, without duplicates
+	std::vector<uint32> OuterIndices;
+
+	CPathTreeID TargetTreeID = INVALID_TREE_ID;
+	int32 UserData = 0;
+	float MaxDistance = 0;
+	bool bComplete = false;
+	std::atomic_bool bValid = false;
+};
@@ -0,0 +1,92 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathDefines.h"
+#include <vector>
+#include <list>
+#include <memory>
+#include <atomic>
+
+class ACPathVolume;
+class FCPathAsyncVolumeGenerator;
+
+/**
+ *
+ */
+
+
+// Generation work of one volume: all bricks of BrickMap (initial generation), or trees from TreesToRegenerate (dynamic obstacles).
+// Workers claim ChunkSize items at a time from NextItem, so a worker that got empty space just claims more chunks.
+struct CPATHFINDING_API CPathGenerationJob
+{
+	ACPathVolume* Volume = nullptr;
+
+	bool bObstacles = false;
+
+	// Outer indexes when bObstacles, otherwise items are brick indexes 0 - ItemCount
+	std::vector<uint32> OuterIndexes;
+
+	uint32 ItemCount = 0;
+	uint32 ChunkSize = 1;
+
+	// How many workers can work on this job at once, ACPathVolume::MaxGenerationThreads
+	int MaxWorkers = 1;
+
+	std::atomic<uint32> NextItem = 0;
+	std::atomic_int WorkersInJob = 0;
+
+	std::atomic<uint32> OctreeCountAtDepth[MAX_DEPTH + 1] = {};
+
+	// Workers leave after the item they're on, the volume isn't notified
+	std::atomic_bool Cancelled = false;
+
+	// Set by whoever finishes the job (last worker to leave, or CPathGeneratorPool::Cancel), so it only happens once
+	std::atomic_bool Completing = false;
+
+	// Set after ACPathVolume::OnGenerationJobFinished returned, no worker touches the volume anymore
+	std::atomic_bool Finished = false;
+};
+
+
+// Generator threads shared by all volumes. They live until the module shuts down, so generating doesn't create threads
+// every time dynamic obstacles move. Idle workers wait on their event.
+class CPATHFINDING_API CPathGeneratorPool
+{
+public:
+	CPathGeneratorPool();
+	~CPathGeneratorPool();
+
+	static CPathGeneratorPool& Get();
+
+	// Workers are created on the first call
+	void Submit(std::shared_ptr<CPathGenerationJob> Job);
+
+	// Nobody joins the job anymore, Job->Finished is set once workers that are on it leave
+	void Cancel(const std::shared_ptr<CPathGenerationJob>& Job);
+
+	// Called by workers. Returns a job that still has items and room for another worker, or nullptr
+	std::shared_ptr<CPathGenerationJob> JoinJob();
+
+	// Called by workers once they can't claim any more items. The last one to leave finishes the job.
+	void LeaveJob(const std::shared_ptr<CPathGenerationJob>& Job);
+
+	// Stops and deletes all workers, called when the module shuts down
+	void Shutdown();
+
+	FORCEINLINE int GetWorkerCount() const
+	{
+		return (int)Workers.size();
+	}
+
+private:
+	std::vector<std::unique_ptr<FCPathAsyncVolumeGenerator>> Workers;
+
+	// Jobs that still have items to claim
+	std::list<std::shared_ptr<CPathGenerationJob>> Jobs;
+
+	FCriticalSection Mutex;
+
+	void CreateWorkers();
+};
@@ -0,0 +1,94 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionShape.h"
+#include "Engine/OverlapResult.h"
+#include <vector>
+
+class ACPathVolume;
+class UPrimitiveComponent;
+
+/**
+ *
+ */
+
+
+// Simple collision of everything overlapping one outer tree, gathered with a single physics query, so that subtrees of the tree
+// can be tested against just these shapes instead of the whole physics scene.
+// Boxes and convex elements are kept as their corner points, spheres and capsules as their center point/segment with a radius,
+// and tested with GJK. Primitives that can't be represented this way (complex collision, landscape, anything that isn't static)
+// are Unresolved, so a subtree is only Free if physics agrees.
+class CPATHFINDING_API CPathGeometryGather
+{
+public:
+	CPathGeometryGather();
+	~CPathGeometryGather();
+
+	enum class EResult : uint8
+	{
+		Free,
+		Blocked,
+		// Too close to call, or not blocked by any gathered shape while something unresolved is nearby. Ask physics.
+		Unknown
+	};
+
+	// Gathers shapes that a tree at Location and depth 0, or any of its subtrees, could touch with ACPathVolume::TraceShapesByDepth
+	void Collect(const ACPathVolume* Volume, FVector Location);
+
+	void Reset();
+
+	// One of ACPathVolume::TraceShapesByDepth at Location, which must be inside the tree this was collected for
+	EResult Test(const FCollisionShape& Shape, FVector Location) const;
+
+	FORCEINLINE uint32 GetShapeCount() const
+	{
+		return (uint32)Shapes.size();
+	}
+
+	FORCEINLINE bool IsUnresolved() const
+	{
+		return Unresolved;
+	}
+
+private:
+	// Convex hull of Points[FirstPoint, FirstPoint + PointCount), inflated by Radius
+	struct GatheredShape
+	{
+		uint32 FirstPoint = 0;
+		uint32 PointCount = 0;
+		double Radius = 0;
+		FBox Bounds;
+	};
+
+	struct ShapeView
+	{
+		const FVector* Points = nullptr;
+		uint32 PointCount = 0;
+		double Radius = 0;
+	};
+
+	std::vector<GatheredShape> Shapes;
+	std::vector<FVector> Points;
+	bool Unresolved = false;
+
+	// Shapes closer than this to the query are left to physics
+	double Tolerance = 0.1;
+
+	// Reused between Collect calls
+	TArray<FOverlapResult> Overlaps;
+
+	// Adds simple collision of the primitive, returns false if it can't be represented
+	bool AddPrimitive(const UPrimitiveComponent* Primitive, int32 ItemIndex);
+
+	void AddShape(uint32 FirstPoint, double Radius);
+
+	// Query shape grown (or shrunk if negative) by Inflate. OutPoints needs room for 8 points.
+	static ShapeView MakeQueryView(const FCollisionShape& Shape, FVector Location, double Inflate, FVector OutPoints[8]);
+
+	static FVector Support(const ShapeView& Shape, const FVector& Direction);
+
+	// GJK, true if the shapes overlap. Decided is false if it ran out of iterations, the result should not be trusted then.
+	static bool Intersect(const ShapeView& A, const ShapeView& B, bool& Decided);
+};
@@ -0,0 +1,52 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathOccupancyProvider.h"
+#include <vector>
+#include "CPathHeightfieldOccupancyProvider.generated.h"
+
+/**
+ *
+ */
+
+
+// Everything below the landscapes overlapping the volume is occupied, everything above is free.
+// Heights are sampled on a grid once in BeginGeneration, after that generation doesn't touch physics.
+// Height between samples is taken as the highest sample around it, so this errs on the occupied side by up to one SampleSpacing.
+UCLASS(meta = (DisplayName = "Landscape Heightfield"))
+class CPATHFINDING_API UCPathHeightfieldOccupancyProvider : public UCPathOccupancyProvider
+{
+	GENERATED_BODY()
+
+public:
+
+	// Distance between height samples, 0 means half of the volume's VoxelSize
+	UPROPERTY(EditAnywhere, Category = "CPath", meta = (ClampMin = "0", UIMin = "0"))
+		float SampleSpacing = 0;
+
+	// Extra height added to every sample, to keep agents a bit away from the ground
+	UPROPERTY(EditAnywhere, Category = "CPath")
+		float HeightOffset = 0;
+
+	virtual void BeginGeneration(ACPathVolume* Volume) override;
+
+	virtual bool IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const override;
+
+	// Columns of cells share the height under them, so each column is sampled once per depth
+	virtual bool FillOuterTree(const ACPathVolume* Volume, CPathOccupancyBatch& Batch) const override;
+
+	virtual uint32 GetBakeHash() const override;
+
+private:
+	FVector2D Origin = FVector2D::ZeroVector;
+	float Spacing = 1;
+	int32 SampleCount[2] = { 0, 0 };
+
+	// X major, lowest float where there is no landscape
+	std::vector<float> Heights;
+
+	// Highest sample around the rectangle
+	float GetMaxHeight(double MinX, double MinY, double MaxX, double MaxY) const;
+};
@@ -0,0 +1,125 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathDefines.h"
+#include <vector>
+#include <set>
+
+class ACPathVolume;
+class CPathVisitedTable;
+
+/**
+ *
+ */
+
+
+// A free leaf of the octree, flattened for pathfinding
+struct CPathGraphLeaf
+{
+	// Precomputed WorldLocationFromTreeID
+	FVector Center;
+
+	CPathTreeID TreeID;
+
+	// Data from Octree, same as CPathAStarNode::TreeUserData
+	uint32 UserData;
+
+	// Neighbours of this leaf are Slice.Neighbours[FirstNeighbour] ... Slice.Neighbours[FirstNeighbour + NeighbourCount - 1]
+	uint32 FirstNeighbour;
+	uint32 NeighbourCount;
+
+	// Distance from Center to the closest occupied leaf, capped at the size of an outer tree.
+	// Agents with a radius above this don't fit here, unless they're not bigger than the agent the volume was generated for.
+	float Clearance;
+};
+
+// Graph of free leafs built from the octree after generation, so that A* doesn't have to walk the tree on every expansion.
+// Leafs are stored in compressed sparse row format, in one slice per outer (depth 0) tree.
+// Slices are separate so that when dynamic obstacles regenerate an outer tree, only its slice (and neighbour lists of adjacent slices) need rebuilding.
+// Leafs are referenced by LeafRef = OuterIndex << LocalBits | index of the leaf in its slice.
+class CPATHFINDING_API CPathLeafGraph
+{
+public:
+	CPathLeafGraph();
+	~CPathLeafGraph();
+
+	// An outer tree has at most 8^MAX_DEPTH leafs
+	static constexpr uint32 LocalBits = MAX_DEPTH * 3;
+	static constexpr uint32 LocalMask = (1 << LocalBits) - 1;
+	static constexpr CPathLeafRef InvalidLeaf = INVALID_TREE_ID;
+
+	// Builds slices for all outer trees of the volume. Uses all available cores.
+	void Build(ACPathVolume* Volume);
+
+	// Rebuilds slices of given outer trees and neighbour lists of slices adjacent to them
+	void Rebuild(ACPathVolume* Volume, const std::set<uint32>& OuterIndices);
+
+	void Clear();
+
+	FORCEINLINE bool IsBuilt() const
+	{
+		return bIsBuilt;
+	}
+
+	// Returns LeafRef of a free leaf with TreeID, or InvalidLeaf if TreeID is not a free leaf
+	CPathLeafRef FindLeaf(CPathTreeID TreeID) const;
+
+	// NO BOUNDS CHECK
+	FORCEINLINE const CPathGraphLeaf& GetLeaf(CPathLeafRef LeafRef) const
+	{
+		return Slices[LeafRef >> LocalBits].Leafs[LeafRef & LocalMask];
+	}
+
+	// Returns the first LeafRef adjacent to the leaf, the rest follow it. Count is in GetLeaf(LeafRef).NeighbourCount
+	FORCEINLINE const CPathLeafRef* GetNeighbours(CPathLeafRef LeafRef) const
+	{
+		const Slice& LeafSlice = Slices[LeafRef >> LocalBits];
+		return LeafSlice.Neighbours.data() + LeafSlice.Leafs[LeafRef & LocalMask].FirstNeighbour;
+	}
+
+	// Total number of free leafs in the graph
+	uint32 GetLeafCount() const;
+
+	FORCEINLINE uint32 GetSliceCount() const
+	{
+		return (uint32)Slices.size();
+	}
+
+	// Leafs of an outer tree are LeafRefs MakeLeafRef(OuterIndex, 0) ... MakeLeafRef(OuterIndex, GetSliceLeafCount(OuterIndex) - 1)
+	FORCEINLINE uint32 GetSliceLeafCount(uint32 OuterIndex) const
+	{
+		return (uint32)Slices[OuterIndex].Leafs.size();
+	}
+
+	static FORCEINLINE CPathLeafRef MakeLeafRef(uint32 OuterIndex, uint32 LocalIndex)
+	{
+		return ((CPathLeafRef)OuterIndex << LocalBits) | LocalIndex;
+	}
+
+private:
+	struct Slice
+	{
+		// Sorted by TreeID
+		std::vector<CPathGraphLeaf> Leafs;
+		std::vector<CPathLeafRef> Neighbours;
+
+		// Per leaf, the closest occupied leaf adjacent to it or InvalidLeaf. Seeds of the clearance pass.
+		std::vector<CPathTreeID> AdjacentOccupied;
+	};
+
+	std::vector<Slice> Slices;
+
+	bool bIsBuilt = false;
+
+	// Step 1 - collects free leafs of the outer tree. Doesn't touch other slices.
+	void BuildSliceLeafs(ACPathVolume* Volume, uint32 OuterIndex);
+
+	// Step 2 - fills neighbour lists and AdjacentOccupied. Slices of the adjacent outer trees must already have their leafs.
+	void BuildSliceNeighbours(ACPathVolume* Volume, uint32 OuterIndex, std::vector<CPathTreeID>& NeighbourIDsBuffer);
+
+	// Step 3 - computes Clearance of the leafs, with a Dijkstra from occupied leafs through free ones.
+	// Limited to the outer tree and its 6 adjacent ones, which must have finished step 2.
+	void BuildSliceClearance(ACPathVolume* Volume, uint32 OuterIndex, CPathVisitedTable& Visited);
+};
@@ -0,0 +1,103 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathOccupancyProvider.h"
+#include "CPathDefines.h"
+#include "CollisionQueryParams.h"
+#include <vector>
+#include <utility>
+#include "CPathMeshVoxelizerOccupancyProvider.generated.h"
+
+class UPrimitiveComponent;
+
+/**
+ *
+ */
+
+
+// Voxelizes static mesh collision instead of asking physics about every tree.
+// BeginGeneration copies collision triangles of static meshes in the volume and bins them into outer trees,
+// FillOuterTree then rasterizes a tree's triangles into its leafs with a triangle/box SAT test and dilates them by the agent shape.
+// Outer trees are filled by generators in parallel, physics is only asked about collision that isn't a static mesh
+// (landscapes, brushes, spheres and capsules, movable components) where it's near.
+// Matches physics within a leaf, coarser trees check the agent shape at the leafs around their center.
+UCLASS(meta = (DisplayName = "Static Mesh Voxelizer"))
+class CPATHFINDING_API UCPathMeshVoxelizerOccupancyProvider : public UCPathOccupancyProvider
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void BeginGeneration(ACPathVolume* Volume) override;
+
+	virtual bool IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const override;
+
+	virtual bool FillOuterTree(const ACPathVolume* Volume, CPathOccupancyBatch& Batch) const override;
+
+	// Separating axis test, touching counts as overlapping
+	static bool TriangleOverlapsBox(FVector Center, FVector Extent, FVector A, FVector B, FVector C);
+
+private:
+	struct Triangle
+	{
+		FVector A, B, C;
+	};
+
+	// Box or convex element. Its triangles only mark the surface, leafs inside are found by its planes.
+	struct Solid
+	{
+		FBox Bounds;
+		uint32 FirstPlane;
+		uint32 PlaneCount;
+	};
+
+	std::vector<Triangle> Triangles;
+	std::vector<Solid> Solids;
+
+	// Pointing out of their solid
+	std::vector<FPlane> Planes;
+
+	// (OuterIndex, index into Triangles or Solids), sorted. Everything within BinMargin of an outer tree is in its bin.
+	std::vector<std::pair<uint32, uint32>> TriangleBins;
+	std::vector<std::pair<uint32, uint32>> SolidBins;
+	FVector BinMargin = FVector::ZeroVector;
+
+	// Collision left to physics, FallbackParams make physics ignore everything that was voxelized
+	TArray<FBox> FallbackBounds;
+	FCollisionQueryParams FallbackParams;
+
+	// Leaf offsets that the agent shape touches when it's at a leaf's center, and how far they go per axis
+	std::vector<FIntVector> DilationOffsets;
+	FIntVector DilationMargin = FIntVector::ZeroValue;
+
+	// Same as ACPathVolume::TraceShapesByDepth containing the agent shape
+	bool AgentAtDepth[MAX_DEPTH + 1] = { false };
+
+	// Adds the whole primitive or nothing, false if physics has to handle it
+	bool AddPrimitive(const UPrimitiveComponent* Primitive);
+
+	// Closed convex surface, Indices are triangles into Points
+	void AddConvex(const TArray<FVector>& Points, const TArray<int32>& Indices);
+
+	void BuildDilationOffsets(const ACPathVolume* Volume);
+
+	void BuildBins(const ACPathVolume* Volume);
+
+	// Outer tree coordinates that the box, grown by BinMargin, touches. False if none.
+	bool GetOuterRange(const ACPathVolume* Volume, const FBox& Box, FIntVector& First, FIntVector& Last) const;
+
+	uint32 GetOuterIndex(const ACPathVolume* Volume, FVector OuterLocation) const;
+
+	// Range of the bin for OuterIndex
+	static void FindBin(const std::vector<std::pair<uint32, uint32>>& Bins, uint32 OuterIndex, const std::pair<uint32, uint32>*& OutBegin, const std::pair<uint32, uint32>*& OutEnd);
+
+	bool IsInsideSolid(const Solid& InSolid, FVector Location) const;
+
+	// Physics for collision that wasn't voxelized, false if it blocks the tree
+	bool IsFreeByFallback(const ACPathVolume* Volume, FVector Location, uint32 Depth, const TArray<FBox>& NearbyBounds) const;
+
+	// Top down like the generator, only trees the generator will visit are checked
+	void ApplyFallback(const ACPathVolume* Volume, CPathOccupancyBatch& Batch, uint32 Depth, uint32 X, uint32 Y, uint32 Z, const TArray<FBox>& NearbyBounds) const;
+};
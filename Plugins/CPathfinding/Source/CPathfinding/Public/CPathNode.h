@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "CPathDefines.h"
+#include <memory>
 #include "CPathNode.generated.h"
 
 /**
@@ -16,19 +17,19 @@ class CPATHFINDING_API CPathAStarNode
 {
 public:
 	CPathAStarNode();
-	CPathAStarNode(uint32 ID)
+	CPathAStarNode(CPathTreeID ID)
 		:
 		TreeID(ID)
 	{}
-	CPathAStarNode(uint32 ID, uint32 Data)
+	CPathAStarNode(CPathTreeID ID, uint32 Data)
 		:
 		TreeID(ID),
 		TreeUserData(Data)
 	{}
 
-	uint32 TreeID = 0xFFFFFFFF;
+	CPathTreeID TreeID = INVALID_TREE_ID;
 
-	// Data from Octree that you may modify by overriding `RecheckOctreeAtDepth`
+	// User data of the tree (see ACPathVolume::Occupancy) that you may modify by overriding `RecheckOctreeAtDepth`
 	// and access from `CalcFitness`
 	uint32 TreeUserData = 0;
 
@@ -41,6 +42,9 @@ public:
 
 	FVector WorldLocation;
 
+	// LeafRef in the volume's CPathLeafGraph, if the node came from it
+	CPathLeafRef GraphLeaf = INVALID_TREE_ID;
+
 	// ------ Operators for containers ----------------------------------------
 	bool operator <(const CPathAStarNode& Rhs) const
 	{
@@ -61,7 +65,7 @@ public:
 	{
 		size_t operator()(const CPathAStarNode& Node) const
 		{
-			return Node.TreeID;
+			return (size_t)Node.TreeID;
 		}
 	};
 
@@ -110,6 +114,9 @@ struct CPATHFINDING_API FCPathResult
 	// To get this data, set RequestRawPath to true in the FindPath call
 	TArray<CPathAStarNode> RawPathNodes;
 	float RawPathLength = 0;
+
+	// Only set for flow field requests, see ACPathVolume::FindFlowFieldAsync
+	std::shared_ptr<class CPathFlowField> FlowField;
 };
 
 
@@ -126,6 +133,28 @@ struct CPATHFINDING_API FCPathRequest
 	uint32 SmoothingPasses;
 	int32 UserData;
 	float TimeLimit;
+
+	// If above 0, the search runs in slices of this many seconds, and other requests are processed in between.
+	// The search is resumed where it stopped, and fails with Timeout only after spending TimeLimit in total.
+	float SliceTimeLimit = 0;
+
+	// Searches from both start and end at once, and gives up as soon as either side runs out of nodes.
+	// Fails much faster when the end (or start) is in a small enclosed space, at the cost of being a bit slower otherwise.
+	bool Bidirectional = false;
+
+	// Lazy Theta* - nodes can link to any earlier node they can see, not only to their neighbours, so the path comes out already straight.
+	// SmoothingPasses are skipped for such paths. Line of sight is checked against the octree, see ACPathVolume::HasLineOfSight.
+	bool AnyAngle = false;
+
+	// Radius of the agent the path is for. If it's bigger than ACPathVolume::AgentRadius, leafs too close to obstacles are skipped (see CPathGraphLeaf::Clearance),
+	// so one volume can be used by agents of different sizes. Requires ACPathVolume::BuildLeafGraph, ignored otherwise.
+	// Clamped to the size of an outer tree, as clearance isn't measured further than that.
+	float AgentRadius = 0;
+
+	// Instead of a path, computes a flow field towards End (Start is not used), returned in FCPathResult::FlowField.
+	// Leafs further than FlowFieldMaxDistance from End are not included, unless it's <= 0. TimeLimit applies as usual.
+	bool FlowField = false;
+	float FlowFieldMaxDistance = 0;
 	//FCPathResult* Result;
 	bool RequestRawPath;
 	bool RequestUserPath;
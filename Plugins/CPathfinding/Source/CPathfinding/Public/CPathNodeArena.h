@@ -0,0 +1,71 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathNode.h"
+#include <vector>
+#include <memory>
+
+/**
+ *
+ */
+
+
+// Storage for nodes created during a FindPath call.
+// Nodes are allocated in fixed size chunks that never move, so PreviousNode pointers stay valid until Reset().
+// Reset() only rewinds the counter - chunks are kept for the next search, so a pathfinder that has already
+// done a search of similar size doesn't allocate anything.
+class CPATHFINDING_API CPathNodeArena
+{
+public:
+	CPathNodeArena();
+	~CPathNodeArena();
+
+	// Copies Node into the arena and returns a pointer to the copy. OutIndex is the index of the node in the arena.
+	CPathAStarNode* Add(const CPathAStarNode& Node, uint32& OutIndex);
+
+	FORCEINLINE CPathAStarNode* Add(const CPathAStarNode& Node)
+	{
+		uint32 TempIndex;
+		return Add(Node, TempIndex);
+	}
+
+	// NO BOUNDS CHECK
+	FORCEINLINE CPathAStarNode& operator[](uint32 Index)
+	{
+		return Chunks[Index >> ChunkBits][Index & ChunkMask];
+	}
+
+	FORCEINLINE const CPathAStarNode& operator[](uint32 Index) const
+	{
+		return Chunks[Index >> ChunkBits][Index & ChunkMask];
+	}
+
+	// Forgets all nodes, but keeps the memory. Pointers returned before Reset() should not be used after it.
+	FORCEINLINE void Reset()
+	{
+		Count = 0;
+	}
+
+	FORCEINLINE uint32 Num() const
+	{
+		return Count;
+	}
+
+	// How many nodes can be added before the arena needs to allocate a new chunk
+	FORCEINLINE uint32 Capacity() const
+	{
+		return (uint32)Chunks.size() << ChunkBits;
+	}
+
+	// 4096 nodes per chunk
+	static constexpr uint32 ChunkBits = 12;
+	static constexpr uint32 ChunkSize = 1 << ChunkBits;
+	static constexpr uint32 ChunkMask = ChunkSize - 1;
+
+private:
+	std::vector<std::unique_ptr<CPathAStarNode[]>> Chunks;
+
+	uint32 Count = 0;
+};
@@ -0,0 +1,189 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathDefines.h"
+#include "CPathBrickMap.h"
+#include <vector>
+#include <memory>
+
+/**
+ *
+ */
+
+
+// Free/occupied state and user data of all trees in the volume, kept apart from CPathOctree so that the octree only holds its structure.
+// Stored per brick of CPathBrickMap, and only for Mixed bricks - trees of a homogeneous brick are all free or all occupied, which the brick map knows.
+// Every outer tree has a fixed range of bits for trees up to depth 3 (1 + 8 + 64 + 512), indexed by TreeID.
+// Deeper trees are stored in blocks, one per depth 3 tree that has any of them free, since most depth 3 trees never subdivide.
+// Trees that were never written are occupied.
+// User data (see ACPathVolume::RecheckOctreeAtDepth) is in side tables of the same layout, allocated only when something other than 0 is written there.
+// Trees are addressed by OuterSlot (see CPathBrickMap). Different threads can write to different outer trees at the same time.
+class CPATHFINDING_API CPathOccupancy
+{
+public:
+	CPathOccupancy();
+	~CPathOccupancy();
+
+	// Nothing is allocated until AllocateBrick
+	void Init(uint32 BrickCount, uint32 OctreeDepth);
+
+	void Clear();
+
+	// All trees of the brick start occupied, without user data
+	void AllocateBrick(uint32 BrickIndex);
+
+	void ReleaseBrick(uint32 BrickIndex);
+
+	FORCEINLINE bool IsFree(uint64 OuterSlot, CPathTreeID TreeID) const
+	{
+		uint32 Depth = GetDepth(TreeID);
+		if (Depth > DenseDepth)
+		{
+			const DeepOuter* Deep = FindDeep(OuterSlot);
+			uint32 Block = Deep ? Deep->BlockByParent[GetDeepParent(TreeID)] : 0;
+			if (!Block)
+				return false;
+
+			uint32 DeepSlot = GetDeepSlot(TreeID, Depth);
+			return (Deep->Bits[(size_t)(Block - 1) * WordsPerBlock + (DeepSlot >> 6)] >> (DeepSlot & 63)) & 1;
+		}
+
+		uint32 Slot = GetSlot(TreeID, Depth);
+		return (GetOuterBits(OuterSlot)[Slot >> 6] >> (Slot & 63)) & 1;
+	}
+
+	FORCEINLINE void SetIsFree(uint64 OuterSlot, CPathTreeID TreeID, bool IsFree)
+	{
+		uint32 Depth = GetDepth(TreeID);
+		uint64* Word;
+		uint32 Bit;
+		if (Depth > DenseDepth)
+		{
+			// Trees start occupied, no need for a block
+			if (!IsFree && !FindDeepBlock(OuterSlot, TreeID))
+				return;
+
+			uint32 DeepSlot = GetDeepSlot(TreeID, Depth);
+			DeepOuter& Deep = GetOrAddDeep(OuterSlot);
+			Word = &Deep.Bits[(size_t)(GetOrAddDeepBlock(Deep, TreeID) - 1) * WordsPerBlock + (DeepSlot >> 6)];
+			Bit = DeepSlot & 63;
+		}
+		else
+		{
+			uint32 Slot = GetSlot(TreeID, Depth);
+			Word = &GetOuterBits(OuterSlot)[Slot >> 6];
+			Bit = Slot & 63;
+		}
+		*Word = (*Word & ~(1ull << Bit)) | ((uint64)IsFree << Bit);
+	}
+
+	// Same as the old CPathOctree::Data - user data, with bit 0 being IsFree
+	uint32 GetData(uint64 OuterSlot, CPathTreeID TreeID) const;
+
+	// Bit 0 is ignored, use SetIsFree for that
+	void SetUserData(uint64 OuterSlot, CPathTreeID TreeID, uint32 Data);
+
+	// Writes or reads bits and user data of the brick, it must be allocated when reading
+	void SerializeBrick(FArchive& Ar, uint32 BrickIndex);
+
+	// Memory used by bits and allocated user data
+	int64 GetAllocatedBytes() const;
+
+private:
+	// Depths up to this one have fixed bits in every outer tree
+	static constexpr uint32 MaxDenseDepth = 3;
+	static constexpr uint32 DeepParentCount = 1u << (MaxDenseDepth * 3);
+
+	// Deeper trees of one outer tree, allocated when the first of them is free or gets user data
+	struct DeepOuter
+	{
+		// Block + 1 by the depth 3 tree (its child indexes), 0 if none of its subtrees were written
+		uint16 BlockByParent[DeepParentCount] = { 0 };
+		uint32 BlockCount = 0;
+
+		// WordsPerBlock for every block
+		std::vector<uint64> Bits;
+
+		// SlotsPerBlock for every block, empty until user data is written
+		std::vector<uint32> UserData;
+	};
+
+	struct Brick
+	{
+		std::unique_ptr<uint64[]> Bits;
+
+		// Per outer tree of the brick, null until it has user data. SlotsPerOuter of trees up to DenseDepth.
+		std::unique_ptr<std::unique_ptr<uint32[]>[]> UserData;
+
+		// Per outer tree of the brick, only with OctreeDepth above MaxDenseDepth
+		std::unique_ptr<std::unique_ptr<DeepOuter>[]> Deep;
+	};
+
+	// Trees at depths above the given one (1 + 8 + ... + 8^(Depth-1)), slot of a tree is this + its child indexes
+	static constexpr uint32 SlotOffsetByDepth(uint32 Depth)
+	{
+		return ((1u << (Depth * 3)) - 1) / 7;
+	}
+
+	static FORCEINLINE uint32 GetDepth(CPathTreeID TreeID)
+	{
+		return (uint32)((TreeID & DEPTH_MASK) >> DEPTH_0_BITS);
+	}
+
+	static FORCEINLINE uint32 GetSlot(CPathTreeID TreeID, uint32 Depth)
+	{
+		uint32 ChildIndexes = (uint32)(TreeID >> CHILD_INDEX_OFFSET) & ((1u << (Depth * 3)) - 1);
+		return SlotOffsetByDepth(Depth) + ChildIndexes;
+	}
+
+	// Child indexes of the depth 3 tree the deep tree is in
+	static FORCEINLINE uint32 GetDeepParent(CPathTreeID TreeID)
+	{
+		return (uint32)(TreeID >> CHILD_INDEX_OFFSET) & (DeepParentCount - 1);
+	}
+
+	// Slot inside of the parent's block, same layout as GetSlot without the parent itself
+	static FORCEINLINE uint32 GetDeepSlot(CPathTreeID TreeID, uint32 Depth)
+	{
+		uint32 RelativeDepth = Depth - MaxDenseDepth;
+		uint32 ChildIndexes = (uint32)(TreeID >> (CHILD_INDEX_OFFSET + MaxDenseDepth * 3)) & ((1u << (RelativeDepth * 3)) - 1);
+		return SlotOffsetByDepth(RelativeDepth) - 1 + ChildIndexes;
+	}
+
+	FORCEINLINE uint64* GetOuterBits(uint64 OuterSlot) const
+	{
+		return Bricks[OuterSlot / CPathBrickMap::TreesPerBrick].Bits.get() + (OuterSlot % CPathBrickMap::TreesPerBrick) * WordsPerOuter;
+	}
+
+	FORCEINLINE DeepOuter* FindDeep(uint64 OuterSlot) const
+	{
+		return Bricks[OuterSlot / CPathBrickMap::TreesPerBrick].Deep[OuterSlot % CPathBrickMap::TreesPerBrick].get();
+	}
+
+	FORCEINLINE bool FindDeepBlock(uint64 OuterSlot, CPathTreeID TreeID) const
+	{
+		const DeepOuter* Deep = FindDeep(OuterSlot);
+		return Deep && Deep->BlockByParent[GetDeepParent(TreeID)];
+	}
+
+	DeepOuter& GetOrAddDeep(uint64 OuterSlot);
+
+	// Block + 1
+	uint32 GetOrAddDeepBlock(DeepOuter& Deep, CPathTreeID TreeID);
+
+	void SerializeDeep(FArchive& Ar, std::unique_ptr<DeepOuter>& Deep);
+
+	// Depths stored in the fixed bits, min(OctreeDepth, MaxDenseDepth)
+	uint32 DenseDepth = 0;
+
+	uint32 WordsPerOuter = 0;
+	uint32 SlotsPerOuter = 0;
+
+	uint32 WordsPerBlock = 0;
+	uint32 SlotsPerBlock = 0;
+
+	// Empty for bricks that aren't Mixed
+	std::vector<Brick> Bricks;
+};
@@ -0,0 +1,76 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathDefines.h"
+#include <vector>
+
+class ACPathVolume;
+
+/**
+ *
+ */
+
+
+// Occupancy of every subtree of one outer tree, filled by UCPathOccupancyProvider::FillOuterTree in one call.
+// Depth D is a dense grid of (2^D)^3 cells, indexed by coordinates of the cell inside the outer tree (X major), 1 = free.
+// While a generator works on the tree, ACPathVolume::IsLocationFree answers from here (see FCPathAsyncVolumeGenerator::GetCurrent).
+class CPATHFINDING_API CPathOccupancyBatch
+{
+public:
+	CPathOccupancyBatch();
+	~CPathOccupancyBatch();
+
+	// Sizes the grids for Volume->OctreeDepth, every cell starts occupied
+	void Init(const ACPathVolume* Volume, FVector OuterLocation);
+
+	FORCEINLINE uint32 GetDepthCount() const
+	{
+		return (uint32)FreeByDepth.size();
+	}
+
+	// Cells per axis
+	static FORCEINLINE uint32 GetResolution(uint32 Depth)
+	{
+		return 1u << Depth;
+	}
+
+	static FORCEINLINE uint32 GetCellIndex(uint32 Depth, uint32 X, uint32 Y, uint32 Z)
+	{
+		return (X << (2 * Depth)) | (Y << Depth) | Z;
+	}
+
+	// World location of the cell's center, same as ACPathVolume::WorldLocationFromTreeID for the subtree
+	FORCEINLINE FVector GetCellLocation(uint32 Depth, uint32 X, uint32 Y, uint32 Z) const
+	{
+		return Min + (FVector(X, Y, Z) + 0.5) * CellSizeByDepth[Depth];
+	}
+
+	FORCEINLINE float GetCellSize(uint32 Depth) const
+	{
+		return CellSizeByDepth[Depth];
+	}
+
+	// Whole grid of the depth, for providers that fill it directly
+	FORCEINLINE uint8* GetCells(uint32 Depth)
+	{
+		return FreeByDepth[Depth].data();
+	}
+
+	FORCEINLINE void SetFree(uint32 Depth, uint32 CellIndex, bool IsFree)
+	{
+		FreeByDepth[Depth][CellIndex] = IsFree;
+	}
+
+	// Cell of the depth that contains Location
+	bool IsFree(FVector Location, uint32 Depth) const;
+
+private:
+	// Corner of the outer tree with the lowest coordinates
+	FVector Min = FVector::ZeroVector;
+
+	float CellSizeByDepth[MAX_DEPTH + 1] = { 0 };
+
+	std::vector<std::vector<uint8>> FreeByDepth;
+};
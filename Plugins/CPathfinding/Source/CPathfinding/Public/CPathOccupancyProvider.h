@@ -0,0 +1,70 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "CPathOccupancyProvider.generated.h"
+
+class ACPathVolume;
+class CPathOccupancyBatch;
+
+/**
+ *
+ */
+
+
+// Decides which space is occupied when a volume generates (see ACPathVolume::OccupancyProvider).
+// Generators call it from many threads at once, so everything except BeginGeneration must only read.
+// A provider only has to implement IsBoxEmpty, the rest is built on top of it.
+UCLASS(Abstract, EditInlineNew, DefaultToInstanced, CollapseCategories)
+class CPATHFINDING_API UCPathOccupancyProvider : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	// Called on the game thread before generators start, load or sample data here
+	virtual void BeginGeneration(ACPathVolume* Volume) {}
+
+	// True if nothing in the box is occupied
+	virtual bool IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const PURE_VIRTUAL(UCPathOccupancyProvider::IsBoxEmpty, return false;);
+
+	// True if a tree at Location and Depth is free for the volume's agent.
+	// By default the tree's box, grown to fit the agent at its center, has to be empty.
+	virtual bool IsFree(const ACPathVolume* Volume, FVector Location, uint32 Depth) const;
+
+	// Answers every subtree of the outer tree in one call. Batch is already initialized, with everything occupied.
+	// Return false to be asked per subtree instead, which skips children of free trees.
+	virtual bool FillOuterTree(const ACPathVolume* Volume, CPathOccupancyBatch& Batch) const { return false; }
+
+	// Dynamic obstacles are colliders, so trees regenerated for them also check physics.
+	// Turn off if the world has no colliders and the provider's data already changes with obstacles.
+	UPROPERTY(EditAnywhere, Category = "CPath")
+		bool DynamicObstaclesUsePhysics = true;
+
+	// Generators can gather geometry for the physics scene (ACPathVolume::GeometryCulledGeneration), other providers don't need the world's collision
+	virtual bool UsesPhysics() const { return false; }
+
+	// Part of ACPathVolume::ComputeBakeHash, should change whenever the data would generate a different octree
+	virtual uint32 GetBakeHash() const;
+
+	// Extent of a box that contains both the tree at Depth and the volume's agent shape at its center
+	static FVector GetQueryExtent(const ACPathVolume* Volume, uint32 Depth);
+};
+
+
+// Overlap tests on TraceChannel, the same as a volume without a provider
+UCLASS(meta = (DisplayName = "Physics"))
+class CPATHFINDING_API UCPathPhysicsOccupancyProvider : public UCPathOccupancyProvider
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const override;
+
+	virtual bool IsFree(const ACPathVolume* Volume, FVector Location, uint32 Depth) const override;
+
+	virtual bool UsesPhysics() const override { return true; }
+};
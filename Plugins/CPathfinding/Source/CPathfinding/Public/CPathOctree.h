@@ -17,25 +17,12 @@ public:
 	CPathOctree();
 
 
+	// IsFree and user data of the tree are in ACPathVolume::Occupancy, looked up by TreeID
 	CPathOctree* Children = nullptr;
 
-	uint32 Data = 0;
-
-
-	FORCEINLINE void SetIsFree(bool IsFree)
-	{
-		Data &= 0xFFFFFFFE;
-		Data |= (uint32)IsFree;
-	}
-
-	FORCEINLINE bool GetIsFree() const
-	{
-		return Data << 31;
-	}
-
+	// Children are owned by the volume's CPathOctreeAllocator, not by the tree
 	~CPathOctree()
 	{
-		delete[] Children;
 	};
 };
 
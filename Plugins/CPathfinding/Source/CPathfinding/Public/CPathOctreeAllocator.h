@@ -0,0 +1,81 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "CPathOctree.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+
+/**
+ *
+ */
+
+
+// Pool of child blocks (8 CPathOctree each) for one volume, so that generators don't go through the global heap for every subdivided tree.
+// Blocks are carved from big slabs and never returned to the heap until Clear(), freed blocks are reused.
+// Each generator thread has its own LocalCache of free blocks, and only locks to exchange a batch of them with the shared pool.
+class CPATHFINDING_API CPathOctreeAllocator
+{
+public:
+	CPathOctreeAllocator();
+	~CPathOctreeAllocator();
+
+	// Blocks in one slab
+	static constexpr uint32 SlabBlockCount = 512;
+
+	// How many blocks a LocalCache takes from or gives back to the shared pool at once
+	static constexpr uint32 BatchSize = 64;
+
+	// Free blocks of one thread. Must be flushed before the thread is done with the allocator.
+	struct LocalCache
+	{
+		std::vector<CPathOctree*> FreeBlocks;
+
+		// Blocks allocated minus blocks freed through this cache, since the last flush
+		int64 BlocksInUseDelta = 0;
+	};
+
+	// Returns 8 reset trees (no children). Their IsFree and user data are in ACPathVolume::Occupancy and aren't touched.
+	CPathOctree* Allocate(LocalCache& Cache);
+
+	// Frees the block and all blocks below it
+	void Free(CPathOctree* Block, LocalCache& Cache);
+
+	// Frees only this block, for blocks whose children are still used elsewhere
+	void FreeBlock(CPathOctree* Block, LocalCache& Cache);
+
+	// Gives all free blocks of the cache back to the shared pool
+	void Flush(LocalCache& Cache);
+
+	// Frees all slabs. Nothing can use blocks from this allocator after this.
+	void Clear();
+
+	// Memory of blocks that are in use. Blocks in caches that weren't flushed yet are counted as in use.
+	FORCEINLINE int64 GetBytesInUse() const
+	{
+		return BlocksInUse.load() * BlockBytes;
+	}
+
+	// Memory of all slabs, including free blocks
+	FORCEINLINE int64 GetBytesReserved() const
+	{
+		return (int64)SlabCount.load() * SlabBlockCount * BlockBytes;
+	}
+
+private:
+	static constexpr int64 BlockBytes = 8 * sizeof(CPathOctree);
+
+	std::vector<std::unique_ptr<CPathOctree[]>> Slabs;
+	std::vector<CPathOctree*> FreeBlocks;
+
+	std::atomic<uint32> SlabCount = 0;
+	std::atomic<int64> BlocksInUse = 0;
+
+	FCriticalSection Mutex;
+
+	// Moves up to BatchSize blocks from the shared pool to the cache, making a new slab if the pool is empty
+	void Refill(LocalCache& Cache);
+};
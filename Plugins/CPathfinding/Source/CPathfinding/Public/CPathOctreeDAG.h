@@ -0,0 +1,61 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+#include "CPathOctreeAllocator.h"
+#include <vector>
+#include <unordered_map>
+
+class ACPathVolume;
+
+/**
+ *
+ */
+
+
+// Merges identical child blocks of the volume's octrees, so that repeating geometry is stored once (the octree becomes a DAG).
+// Merged blocks are shared and read only. Before a generator changes an outer tree, MakePrivate gives it its own copy (copy on write).
+// Trees keep their TreeIDs, so nothing outside of generation can tell the difference.
+class CPATHFINDING_API CPathOctreeDAG
+{
+public:
+	CPathOctreeDAG();
+	~CPathOctreeDAG();
+
+	// Merges identical blocks of all outer trees. Generators and pathfinders must not use the volume while this runs.
+	void Compact(ACPathVolume* Volume);
+
+	// Copies the blocks of the outer tree that are shared, blocks only this tree uses are taken over as they are.
+	// Only one thread can call this for a given OuterIndex at a time.
+	void MakePrivate(ACPathVolume* Volume, uint32 OuterIndex, CPathOctreeAllocator::LocalCache& Cache);
+
+	void Clear();
+
+	FORCEINLINE bool IsCompacted() const
+	{
+		return bIsCompacted;
+	}
+
+	// Blocks that were removed by Compact, because an identical one already existed
+	FORCEINLINE uint32 GetMergedBlockCount() const
+	{
+		return MergedBlockCount;
+	}
+
+private:
+	// Per outer tree, 1 if its blocks aren't shared anymore. Not vector<bool>, as generators write to it from multiple threads.
+	std::vector<uint8> IsPrivate;
+
+	// Per block left by Compact, how many parents (trees or other blocks) point to it. A block is shared while it's above 1.
+	// Blocks allocated after Compact aren't in here, entries of blocks that were taken over or reused are 0.
+	std::unordered_map<const CPathOctree*, uint32> RefCounts;
+
+	// MakePrivate of different outer trees can change the same RefCounts
+	FCriticalSection Mutex;
+
+	bool bIsCompacted = false;
+
+	uint32 MergedBlockCount = 0;
+};
@@ -0,0 +1,76 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+
+/**
+ *
+ */
+
+
+// The A* open list - a 4-ary min heap of CPathNodeArena indices, ordered by FitnessResult.
+// It remembers where each node is in the heap, so the fitness of a queued node can be lowered in place
+// instead of pushing a duplicate. A node that is in the arena but not in this list is closed.
+class CPATHFINDING_API CPathOpenList
+{
+public:
+	CPathOpenList();
+	~CPathOpenList();
+
+	FORCEINLINE bool IsEmpty() const
+	{
+		return Heap.empty();
+	}
+
+	FORCEINLINE uint32 Num() const
+	{
+		return (uint32)Heap.size();
+	}
+
+	FORCEINLINE bool Contains(uint32 NodeIndex) const
+	{
+		return NodeIndex < PositionByNode.size()
+			&& PositionByNode[NodeIndex] < Heap.size()
+			&& Heap[PositionByNode[NodeIndex]].NodeIndex == NodeIndex;
+	}
+
+	// Adds a node that is not in the list
+	void Push(uint32 NodeIndex, float Fitness);
+
+	// Lowers the fitness of a node that is in the list, or adds it if it isn't (reopens a closed node)
+	void PushOrDecrease(uint32 NodeIndex, float Fitness);
+
+	// Removes and returns the node with the lowest fitness. List can't be empty.
+	uint32 Pop();
+
+	// Forgets all nodes in O(1)
+	FORCEINLINE void Reset()
+	{
+		Heap.clear();
+	}
+
+private:
+	struct Entry
+	{
+		float Fitness;
+		uint32 NodeIndex;
+	};
+
+	static constexpr uint32 Arity = 4;
+
+	std::vector<Entry> Heap;
+
+	// Position in Heap by node index. This isn't cleared on Reset(), an entry is valid only if Heap at that position points back at the node.
+	std::vector<uint32> PositionByNode;
+
+	void SiftUp(uint32 Position);
+	void SiftDown(uint32 Position);
+
+	FORCEINLINE void Place(const Entry& InEntry, uint32 Position)
+	{
+		Heap[Position] = InEntry;
+		PositionByNode[InEntry.NodeIndex] = Position;
+	}
+};
@@ -0,0 +1,92 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathNode.h"
+#include "CPathNodeArena.h"
+#include "CPathVisitedTable.h"
+#include "CPathOpenList.h"
+
+/**
+ *
+ */
+
+
+// One direction of a search. Forward one goes from start to end, backward one (only in bidirectional searches) from end to start.
+struct CPATHFINDING_API CPathSearchFrontier
+{
+	// Every node that was ever added to OpenList is stored in NodeArena,
+	// and VisitedNodes maps its TreeID to the index in NodeArena. Nodes that are in NodeArena, but not in OpenList are closed.
+	CPathNodeArena NodeArena;
+	CPathVisitedTable VisitedNodes;
+	CPathOpenList OpenList;
+
+	// Location the heuristic points to
+	FVector TargetLocation;
+
+	FORCEINLINE void Reset()
+	{
+		NodeArena.Reset();
+		VisitedNodes.Reset();
+		OpenList.Reset();
+	}
+};
+
+// State of one A* search that can be paused and continued later, see CPathAStar::FindPathSliced.
+// Everything the search allocates lives here, so a context can be kept between requests to reuse its memory.
+class CPATHFINDING_API CPathSearchContext
+{
+public:
+	CPathSearchContext();
+	CPathSearchContext(const FCPathRequest& InRequest);
+	~CPathSearchContext();
+
+	// Parameters of the search. TimeLimit is the budget for all slices together.
+	FCPathRequest Request;
+
+	// Prepares the context for a new request. Keeps the memory.
+	void Reset(const FCPathRequest& InRequest);
+
+	FORCEINLINE bool IsStarted() const
+	{
+		return bStarted;
+	}
+
+	// Time spent searching so far in miliseconds, summed over all slices.
+	// Time between the slices doesn't count, so a search isn't punished for waiting in a queue.
+	FORCEINLINE double GetSearchedTime() const
+	{
+		return SearchedTime;
+	}
+
+	// How many times the search was started from scratch, because the volume regenerated between slices
+	FORCEINLINE uint32 GetRestartCount() const
+	{
+		return RestartCount;
+	}
+
+private:
+	friend class CPathAStar;
+
+	CPathSearchFrontier Forward;
+
+	// Only used if Request.Bidirectional
+	CPathSearchFrontier Backward;
+
+	CPathAStarNode TargetNode;
+
+	// End of a path rebuilt from ACPathVolume::PathCache, A* is skipped if this is set
+	CPathAStarNode* CachedPathEnd = nullptr;
+
+	// Clusters of the volume's CPathAbstractGraph that the search is limited to, if bUseCorridor
+	CPathVisitedTable Corridor = CPathVisitedTable(256);
+	bool bUseCorridor = false;
+
+	bool bStarted = false;
+	double SearchedTime = 0;
+	uint32 RestartCount = 0;
+
+	// ACPathVolume::RegenerationCount when the search started. Octree could have changed between slices if it's different.
+	uint32 VolumeRegeneration = 0;
+};
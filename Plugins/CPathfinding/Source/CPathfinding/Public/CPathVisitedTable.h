@@ -0,0 +1,99 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathDefines.h"
+#include <vector>
+
+/**
+ *
+ */
+
+
+// Hash table from TreeID to an index in CPathNodeArena, used as the visited set in FindPath and FindClosestFreeLeaf.
+// Open addressing with linear probing, every slot remembers the search (generation) it was written in,
+// so Reset() is O(1) - it just starts a new generation. Memory is kept between searches.
+class CPATHFINDING_API CPathVisitedTable
+{
+public:
+	CPathVisitedTable(uint32 InitialCapacity = 4096);
+	~CPathVisitedTable();
+
+	static constexpr uint32 InvalidIndex = 0xFFFFFFFF;
+
+	// Returns the index stored for TreeID or InvalidIndex if TreeID wasn't added in the current search
+	FORCEINLINE uint32 Find(CPathTreeID TreeID) const
+	{
+		uint32 SlotIndex = HashTreeID(TreeID);
+		while (true)
+		{
+			const Slot& CurrSlot = Slots[SlotIndex];
+			if (CurrSlot.Generation != CurrentGeneration)
+				return InvalidIndex;
+			if (CurrSlot.TreeID == TreeID)
+				return CurrSlot.NodeIndex;
+			SlotIndex = (SlotIndex + 1) & SlotMask;
+		}
+	}
+
+	FORCEINLINE bool Contains(CPathTreeID TreeID) const
+	{
+		return Find(TreeID) != InvalidIndex;
+	}
+
+	// Adds TreeID with given NodeIndex. Returns false (and doesn't change anything) if TreeID was already added.
+	bool Add(CPathTreeID TreeID, uint32 NodeIndex);
+
+	// Adds TreeID or overwrites its NodeIndex if it was already added
+	void Set(CPathTreeID TreeID, uint32 NodeIndex);
+
+	// Forgets all entries in O(1)
+	void Reset();
+
+	FORCEINLINE uint32 Num() const
+	{
+		return Count;
+	}
+
+private:
+	struct Slot
+	{
+		CPathTreeID TreeID = 0;
+		uint32 NodeIndex = 0;
+		// 0 is never used as a current generation, so default slots are empty
+		uint32 Generation = 0;
+	};
+
+	std::vector<Slot> Slots;
+	uint32 SlotMask = 0;
+	uint32 HashShift = 0;
+	uint32 CurrentGeneration = 1;
+	uint32 Count = 0;
+
+	// Fibonacci hashing, TreeIDs of neighbours differ mostly in low bits so we want them spread out
+	FORCEINLINE uint32 HashTreeID(CPathTreeID TreeID) const
+	{
+#if CPATH_64BIT_TREEID
+		return (uint32)((TreeID * 0x9E3779B97F4A7C15ull) >> 32) >> HashShift;
+#else
+		return (TreeID * 0x9E3779B1u) >> HashShift;
+#endif
+	}
+
+	// Returns the slot for TreeID - either the one it's already in or the empty one where it should go
+	FORCEINLINE Slot& FindSlot(CPathTreeID TreeID)
+	{
+		uint32 SlotIndex = HashTreeID(TreeID);
+		while (Slots[SlotIndex].Generation == CurrentGeneration && Slots[SlotIndex].TreeID != TreeID)
+		{
+			SlotIndex = (SlotIndex + 1) & SlotMask;
+		}
+		return Slots[SlotIndex];
+	}
+
+	void Allocate(uint32 Capacity);
+
+	// Doubles the capacity, keeping the entries of the current generation
+	void Grow();
+};
@@ -15,7 +15,17 @@
 #include "CPathDefines.h"
 #include "CPathOctree.h"
 #include "CPathNode.h"
+#include "CPathLeafGraph.h"
+#include "CPathAbstractGraph.h"
+#include "CPathCache.h"
+#include "CPathClosestFreeLeafTable.h"
+#include "CPathOctreeAllocator.h"
+#include "CPathOctreeDAG.h"
+#include "CPathBrickMap.h"
+#include "CPathOccupancy.h"
+#include "CPathFlowField.h"
 #include "CPathAsyncVolumeGeneration.h"
+#include "CPathGeneratorPool.h"
 #include "CPathVolume.generated.h"
 
 class ACPathCore;
@@ -26,20 +36,33 @@ class CPATHFINDING_API ACPathVolume : public AActor
 	GENERATED_BODY()
 
 	friend class FCPathAsyncVolumeGenerator;
+	friend class CPathGeneratorPool;
+	friend class CPathGeometryGather;
+	friend class UCPathMeshVoxelizerOccupancyProvider;
 	friend class UCPathDynamicObstacle;
+	friend class CPathLeafGraph;
+	friend class CPathClosestFreeLeafTable;
+	friend class CPathOctreeDAG;
+	friend class CPathAStar;
 public:
 	ACPathVolume();
 
 	virtual void Tick(float DeltaTime) override;
 
+#if WITH_EDITOR
+	// Keeps OctreeDepth within MAX_DEPTH of this build
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
 	// This is the method to find get a path in c++, asynchronously. 
 	// Example function you can provide: void OnPathFound(FCPathResult& PathResult);
 	// You can get the function name via macro: GET_FUNCTION_NAME_CHECKED(YourUObjectType, OnPathFound);
 	// Returns false if FindPath request wasn't made (happens if somehow called before begin play or if one of the volumes has been destroyed)
+	// With SliceTimeLimit > 0, the search is done in slices interleaved with other requests, see FCPathRequest::SliceTimeLimit
 	bool FindPathAsync(UObject* CallingObject, const FName& InFunctionName,
 		FVector Start, FVector End,
 		uint32 SmoothingPasses = 2, int32 UserData = 0, float TimeLimit = 0.15f,
-		bool RequestRawPath = false, bool RequestUserPath = true);
+		bool RequestRawPath = false, bool RequestUserPath = true, float SliceTimeLimit = 0);
 
 	// Same as above, just using the FCPathRequest structure to pass parameters
 	bool FindPathAsync(FCPathRequest& Request);
@@ -55,6 +78,26 @@ public:
 		bool RequestRawPath = false, bool RequestUserPath = true);
 
 
+	// Searches for a path on this thread in slices, so that a long search can be spread over several frames.
+	// Call this every frame with the same Context and Result until it returns true, then Result is filled.
+	// Context.Request describes the search, its TimeLimit is the budget for all slices together. Callback in the request is not used.
+	// While the graph is being updated, this returns false without searching, and the search restarts if the update changed the graph.
+	bool FindPathSynchronousSliced(class CPathSearchContext& Context, FCPathResult& Result, float SliceTimeLimit = 0.002f);
+
+
+	// Returns a flow field towards Target that many agents can sample, see CPathFlowField.
+	// If there is a valid field for the same target leaf and UserData that covers MaxDistance, it is returned instead of building a new one.
+	// Builds it on this thread otherwise, so keep TimeLimit low. Returns nullptr if Target isn't in the volume, or the graph is being updated.
+	std::shared_ptr<CPathFlowField> FindFlowFieldSynchronous(FVector Target, int32 UserData = 0, float MaxDistance = 0, float TimeLimit = 0.002f);
+
+	// Same as above, but built on a pathfinding thread, OnPathFound in the request receives it in FCPathResult::FlowField.
+	// Uses End, UserData, TimeLimit and FlowFieldMaxDistance from the request.
+	bool FindFlowFieldAsync(FCPathRequest& Request);
+
+	// Finds a reusable flow field or builds a new one. Used by the two above.
+	std::shared_ptr<CPathFlowField> FindFlowField(FVector Target, int32 UserData, float MaxDistance, float TimeLimit, ECPathfindingFailReason& OutFailReason);
+
+
 	// Blueprint exposed version
 	// This searches for a path on this thread, so the result is available here and now.
 	// Increase TimeLimit at your own risk. 
@@ -67,6 +110,11 @@ public:
 			 FVector Start, FVector End, int SmoothingPasses = 2,
 			int UserData = 0, float TimeLimit = 0.002f);
 
+	// Cheap line of sight check for the agent this volume was generated for, uses the octree instead of physics.
+	// Returns false if any part of the segment is outside the volume or blocked, or if the graph is not generated/being updated.
+	UFUNCTION(BlueprintCallable, Category = "CPath")
+		bool CheckLineOfSight(FVector Start, FVector End);
+
 
 	// ------- EXTENDABLE ------
 
@@ -75,9 +123,29 @@ public:
 	virtual void CalcFitness(CPathAStarNode& Node, FVector TargetLocation, int32 UserData);
 
 	// Overwrite this function to change the default conditions of a tree being free/ocupied.
-	// You may also save other information in the Data field of an Octree, as only the least significant bit is used.
+	// You may also save other information in UserData, it comes in with what was saved for this tree before and ends up in CPathAStarNode::TreeUserData.
+	// The least significant bit is reserved for IsFree, which is the return value.
 	// This is called during graph generation, for every subtree including leafs, so potentially millions of times. 
-	virtual bool RecheckOctreeAtDepth(CPathOctree* OctreeRef, FVector TreeLocation, uint32 Depth);
+	virtual bool RecheckOctreeAtDepth(uint32& UserData, FVector TreeLocation, uint32 Depth);
+
+	// The default free check of RecheckOctreeAtDepth, asks OccupancyProvider, or IsLocationFreeByPhysics without one.
+	// During generation, this answers from the outer tree's batch if the provider filled one.
+	bool IsLocationFree(FVector TreeLocation, uint32 Depth) const;
+
+	// None of TraceShapesByDepth[Depth] at TreeLocation overlap anything on TraceChannel.
+	// During generation, this tests geometry gathered for the outer tree first (see GeometryCulledGeneration).
+	bool IsLocationFreeByPhysics(FVector TreeLocation, uint32 Depth) const;
+
+	// Nothing overlaps the box on TraceChannel
+	bool IsBoxEmptyByPhysics(FVector Center, FVector Extent) const;
+
+	// Whether IsLocationFree asks physics, when generating initially or regenerating for dynamic obstacles
+	bool UsesPhysicsOccupancy(bool RegeneratingObstacles) const;
+
+	// Before generating a brick of 4x4x4 outer trees, this is called once for its whole box. If it returns true, the brick is stored as free
+	// without calling RecheckOctreeAtDepth for its trees, so if you overwrite that to save UserData, also overwrite this to return
+	// true only where RecheckOctreeAtDepth would return true and leave UserData at 0 (or always return false).
+	virtual bool IsBrickEmpty(FVector Center, FVector Extent);
 
 
 	// -------- BP EXPOSED ----------
@@ -120,15 +188,87 @@ public:
 	// 2 Is optimal in most cases. If you have very large open speces with small amount of obstacles, then 3 will be better.
 	// For dense labirynths with little to no open space, 1 or even 0 will be faster.
 	// Check documentation for detailed performance guidance.
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (EditCondition = "GenerationStarted==false", ClampMin = "0", ClampMax = "3", UIMin = "0", UIMax = "3"))
+	// Depth above 3 needs CPATH_64BIT_TREEID, see CPathDefines.h. Values above MAX_DEPTH are clamped to it.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (EditCondition = "GenerationStarted==false", ClampMin = "0", ClampMax = "6", UIMin = "0", UIMax = "3"))
 		int OctreeDepth = 2;
 
 
+	// After generation, free leafs are flattened into a graph that pathfinding uses instead of walking the octree.
+	// Makes FindPath several times faster, at the cost of memory (roughly 60 bytes per free leaf).
+	// Parts of the graph are rebuilt when dynamic obstacles regenerate the volume.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (EditCondition = "GenerationStarted==false"))
+		bool BuildLeafGraph = true;
+
+	// Stores outer (depth 0) trees in Z-order instead of X-major, so trees close in space are close in memory, and neighbour lookups don't divide.
+	// Each dimension is padded to a power of 2, so for volumes with dimensions far from powers of 2 this takes more memory (up to 8x for the outer trees only).
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (EditCondition = "GenerationStarted==false"))
+		bool MortonOrder = false;
+
+	// After generation, identical parts of the octree are stored only once. Saves a lot of memory over repeating geometry (modular levels, city blocks).
+	// Outer trees changed by dynamic obstacles get their own copy the first time they change, so keep those areas small.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (EditCondition = "GenerationStarted==false"))
+		bool DeduplicateSubtrees = false;
+
+	// Decides which space is occupied during generation. Empty means overlap tests on TraceChannel (same as the Physics provider).
+	// Providers that don't use physics (landscape heightfield, voxel grid file, analytic shapes) generate from their own data,
+	// so they're a lot faster and don't need colliders. Static Mesh Voxelizer is the fast path for regular levels, it rasterizes
+	// static mesh collision and only asks physics about the rest. Overwritten RecheckOctreeAtDepth gets this through IsLocationFree.
+	UPROPERTY(EditAnywhere, Instanced, BlueprintReadOnly, Category = "CPath", meta = (EditCondition = "GenerationStarted==false"))
+		class UCPathOccupancyProvider* OccupancyProvider = nullptr;
+
+	// Generators gather simple collision of everything overlapping an outer tree with one query, and test its subtrees against just those shapes.
+	// Physics is only asked where that can't decide: complex collision, landscapes, anything that isn't static, or shapes that barely touch.
+	// Much faster for static geometry with simple collision. Only used when occupancy comes from physics.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (EditCondition = "GenerationStarted==false"))
+		bool GeometryCulledGeneration = true;
+
+	// Outer trees are grouped into clusters of this size (per axis) for hierarchical pathfinding.
+	// When start and end are in different clusters, a path through clusters is found first, and only leafs in clusters along it are searched.
+	// This makes long paths much faster, but they may be slightly longer. 0 (default) disables it, 4 is a good start. Requires BuildLeafGraph.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (ClampMin = "0", EditCondition = "BuildLeafGraph && GenerationStarted==false"))
+		int HierarchicalClusterSize = 0;
+
+	// How many recent paths to remember. A request with the same start leaf, end leaf and UserData as a remembered one skips A* and only smooths the path again.
+	// Paths are forgotten when dynamic obstacles regenerate any tree they go through.
+	// Off (0) by default. Keep it off if your CalcFitness depends on anything other than the node and UserData.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (ClampMin = "0", EditCondition = "GenerationStarted==false"))
+		int PathCacheSize = 0;
+
+	// By default, path smoothing checks line of sight in the octree, which is cheap and doesn't touch physics.
+	// Set this to use a physics sweep with the agent shape instead. It's exact, but a lot slower and competes with the game thread for the physics scene.
+	// Paths for agents bigger than this volume's (FCPathRequest::AgentRadius) are always smoothed in the octree.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath")
+		bool PhysicsSmoothing = false;
+
+	// After generation, every occupied leaf remembers the closest free leaf to it, so that start/end locations inside obstacles are moved to the graph
+	// with a lookup instead of a search with line traces. Costs 12 bytes per occupied leaf.
+	// Free neighbours of the leaf are still tried first, closest to the location. Further inside, without the traces,
+	// the free leaf could be on the other side of a thin wall.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath", meta = (EditCondition = "GenerationStarted==false"))
+		bool PrecomputeClosestFreeLeafs = false;
+
 	// If want to call Generate() later or with some condition.
 	// Note that volume wont be usable before it is generated
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath")
 		bool GenerateOnBeginPlay = true;
 
+	// Octree baked in the editor with the CPath.BakeVolumes command. If set, GenerateGraph loads it instead of generating,
+	// unless generation settings or static geometry in VolumeBox changed since the bake (see ComputeBakeHash).
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "CPath|Baking")
+		class UCPathBakedVolumeData* BakedData = nullptr;
+
+	// Checking costs one overlap query over the whole VolumeBox. Turn this off to trust the baked data as it is.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath|Baking", meta = (EditCondition = "GenerationStarted==false"))
+		bool CheckBakeIsStale = true;
+
+#if WITH_EDITOR
+	// Generates the octree right away (split with ParallelFor) and stores it in BakedData. Only for volumes in the editor world that weren't generated.
+	bool BakeGraph();
+#endif
+
+	// Hash of generation settings and of static geometry that overlaps VolumeBox on TraceChannel
+	uint32 ComputeBakeHash() const;
+
 	// Set a custom generation thread limit. By default, it's system's Physical Core count - 1.
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "CPath")
 		bool OverwriteMaxGenerationThreads = false;
@@ -167,6 +307,10 @@ public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "CPath|Info")
 		int TotalNodeCount = 0;
 
+	// Memory used by the octree right now, changes as dynamic obstacles regenerate it. Doesn't include the leaf graph and other data built from it.
+	UFUNCTION(BlueprintCallable, Category = "CPath|Info")
+		int64 GetOctreeBytesInUse() const;
+
 	// Draws FREE neighbouring leafs
 	UFUNCTION(BlueprintCallable, Category = "CPath|Render")
 		void DebugDrawNeighbours(FVector WorldLocation);
@@ -230,8 +374,36 @@ protected:
 
 	virtual void BeginPlay() override;
 
-	// The Octree data
-	CPathOctree* Octrees = nullptr;
+	// Outer trees. Mostly empty or mostly blocked volumes only store trees of the bricks near geometry.
+	CPathBrickMap BrickMap;
+
+	// Generators lock this to materialize a brick, as dynamic obstacles can make several of them refresh trees of the same brick
+	FCriticalSection BrickMapMutex;
+
+	// Owns children of all outer trees
+	CPathOctreeAllocator OctreeAllocator;
+
+	// Shares identical blocks of outer trees, see DeduplicateSubtrees
+	CPathOctreeDAG OctreeDAG;
+
+	// IsFree and user data of every tree in a Mixed brick, the trees only hold the structure
+	CPathOccupancy Occupancy;
+
+	// Free leafs of the octree, used by pathfinding. Only valid if BuildLeafGraph is true.
+	CPathLeafGraph LeafGraph;
+
+	// Clusters of outer trees built from LeafGraph, used to limit the search area of long paths. Only valid if HierarchicalClusterSize > 0.
+	CPathAbstractGraph AbstractGraph;
+
+	// Closest free leaf of every occupied leaf, used by FindClosestFreeLeaf. Only valid if PrecomputeClosestFreeLeafs is true.
+	CPathClosestFreeLeafTable ClosestFreeLeafTable;
+
+	// Recent paths, see PathCacheSize
+	CPathCache PathCache;
+
+	// Flow fields that someone still holds, so that they can be shared. Expired ones are removed in FindFlowField.
+	std::vector<std::weak_ptr<CPathFlowField>> FlowFields;
+	FCriticalSection FlowFieldsMutex;
 
 	// This is for find path requests, shouldn't be accessed directly unless you know what you're doing
 	// UPROPERTY() is here so that UE's garabge collector doesn't randomly
@@ -246,35 +418,122 @@ public:
 	// Dimension sizes of the Nodes array, XYZ 
 	uint32 NodeCount[3];
 
+	// Outer indexes go from 0 to this. With MortonOrder it's bigger than NodeCount[0] * NodeCount[1] * NodeCount[2], as it includes padding.
+	FORCEINLINE uint32 GetOuterTreeCount() const
+	{
+		return OuterTreeCount;
+	}
+
+	// False for padding trees of MortonOrder, they are never generated and always occupied
+	FORCEINLINE bool IsOuterTreeInVolume(uint32 OuterIndex) const
+	{
+		return !MortonOrder || IsInBounds(LocalCoordsInt3FromOuterIndex(OuterIndex));
+	}
+
 	//----------- TreeID ------------------------------------------------------------------------
 
 	// Returns the child with this tree id, or his parent at DepthReached in case the child doesnt exist
-	CPathOctree* FindTreeByID(uint32 TreeID, uint32& DepthReached);
+	CPathOctree* FindTreeByID(CPathTreeID TreeID, uint32& DepthReached);
 
-	CPathOctree* FindTreeByID(uint32 TreeID);
+	CPathOctree* FindTreeByID(CPathTreeID TreeID);
 
 	// Returns a tree and its TreeID by world location, returns null if location outside of volume. Only for Outer index
-	CPathOctree* FindTreeByWorldLocation(FVector WorldLocation, uint32& TreeID);
+	CPathOctree* FindTreeByWorldLocation(FVector WorldLocation, CPathTreeID& TreeID);
 
 	// Returns a leaf and its TreeID by world location, returns null if location outside of volume. 
-	CPathOctree* FindLeafByWorldLocation(FVector WorldLocation, uint32& TreeID, bool MustBeFree = 1);
+	CPathOctree* FindLeafByWorldLocation(FVector WorldLocation, CPathTreeID& TreeID, bool MustBeFree = 1);
 
 	// Returns a free leaf and its TreeID by world location, as long as it exists in provided search range and WorldLocation is in this Volume
 	// If SearchRange <= 0, it uses a default dynamic search range
 	// If SearchRange is too large, you might get a free node that is inaccessible from provided WorldLocation
-	CPathOctree* FindClosestFreeLeaf(FVector WorldLocation, uint32& TreeID, float SearchRange = -1);
+	// With PrecomputeClosestFreeLeafs, this is a lookup and doesn't use physics. Otherwise it searches neighbours with line traces.
+	// VisitedTable lets the caller reuse the visited set between calls, if it's null a temporary one is used.
+	CPathOctree* FindClosestFreeLeaf(FVector WorldLocation, CPathTreeID& TreeID, float SearchRange = -1, class CPathVisitedTable* VisitedTable = nullptr);
+
+	// Returns true if every leaf along the segment is free. Doesn't use physics, only the octree, so it's safe to call from any thread while the volume isn't generating.
+	// Walks leaf to leaf along the segment (3D DDA over leafs of mixed depth). Rays offset by the agent's extents are walked as well,
+	// so a free result means the agent fits along the whole segment, not just its center.
+	// With MinClearance > 0, leafs along the segment also need at least this much clearance (see CPathGraphLeaf::Clearance), which needs the leaf graph.
+	bool HasLineOfSight(FVector Start, FVector End, float MinClearance = 0);
+
+	// Walks a single ray for HasLineOfSight
+	bool HasLineOfSightSingleRay(FVector Start, FVector End, float MinClearance);
+
+	// NO BOUNDS CHECK. TreeID must be a tree that exists in the volume.
+	FORCEINLINE bool IsTreeFree(CPathTreeID TreeID) const
+	{
+		uint64 OuterSlot = GetOuterSlot(ExtractOuterIndex(TreeID));
+		CPathBrickMap::EBrickState State = BrickMap.GetState(CPathBrickMap::GetBrickIndex(OuterSlot));
+		if (State != CPathBrickMap::EBrickState::Mixed)
+			return State == CPathBrickMap::EBrickState::Free;
+
+		return Occupancy.IsFree(OuterSlot, TreeID);
+	}
+
+	// NO BOUNDS CHECK. User data saved by RecheckOctreeAtDepth, with IsFree in the least significant bit.
+	FORCEINLINE uint32 GetTreeUserData(CPathTreeID TreeID) const
+	{
+		uint64 OuterSlot = GetOuterSlot(ExtractOuterIndex(TreeID));
+		CPathBrickMap::EBrickState State = BrickMap.GetState(CPathBrickMap::GetBrickIndex(OuterSlot));
+		if (State != CPathBrickMap::EBrickState::Mixed)
+			return State == CPathBrickMap::EBrickState::Free;
+
+		return Occupancy.GetData(OuterSlot, TreeID);
+	}
+
+	// NO BOUNDS CHECK. Outer tree at OuterIndex, trees of homogeneous bricks are a shared empty tree that must not be written to.
+	FORCEINLINE CPathOctree* GetOuterTree(uint32 OuterIndex)
+	{
+		return BrickMap.GetTree(GetOuterSlot(OuterIndex));
+	}
+
+	// Where the outer tree is in BrickMap and Occupancy
+	FORCEINLINE uint64 GetOuterSlot(uint32 OuterIndex) const
+	{
+		FVector Coords = LocalCoordsInt3FromOuterIndex(OuterIndex);
+		return BrickMap.GetOuterSlot((uint32)Coords.X, (uint32)Coords.Y, (uint32)Coords.Z);
+	}
+
+	// Returns true if the free leaf has at least MinClearance, or if there is no leaf graph to check it in
+	FORCEINLINE bool HasClearance(CPathTreeID TreeID, float MinClearance) const
+	{
+		if (!LeafGraph.IsBuilt())
+			return true;
+
+		CPathLeafRef LeafRef = LeafGraph.FindLeaf(TreeID);
+		return LeafRef != CPathLeafGraph::InvalidLeaf && LeafGraph.GetLeaf(LeafRef).Clearance >= MinClearance;
+	}
 
 	// Returns a neighbour of the tree with TreeID in given direction, also returns  TreeID if the neighbour if found
-	CPathOctree* FindNeighbourByID(uint32 TreeID, ENeighbourDirection Direction, uint32& NeighbourID);
+	CPathOctree* FindNeighbourByID(CPathTreeID TreeID, ENeighbourDirection Direction, CPathTreeID& NeighbourID);
+
+	// Same as above for outer trees, takes and returns an outer index instead of TreeID
+	FORCEINLINE bool FindOuterNeighbourIndex(uint32 OuterIndex, ENeighbourDirection Direction, uint32& NeighbourIndex)
+	{
+		CPathTreeID NeighbourID;
+		if (!FindNeighbourByID(OuterIndex, Direction, NeighbourID))
+			return false;
+
+		NeighbourIndex = ExtractOuterIndex(NeighbourID);
+		return true;
+	}
 
 	// Returns a list of adjecent leafs as TreeIDs
-	std::vector<uint32> FindNeighbourLeafs(uint32 TreeID, bool MustBeFree = true);
+	std::vector<CPathTreeID> FindNeighbourLeafs(CPathTreeID TreeID, bool MustBeFree = true);
 
-	// Returns a list of adjecent free leafs as CPathAStarNode
+	// Same as above, but writes to caller's container so that it doesn't allocate when called in a loop. OutNeighbours is cleared first.
+	void FindNeighbourLeafs(CPathTreeID TreeID, std::vector<CPathTreeID>& OutNeighbours, bool MustBeFree = true);
+
+	// Returns a list of adjecent free leafs as CPathAStarNode, with WorldLocation already set
 	std::vector<CPathAStarNode> FindFreeNeighbourLeafs(CPathAStarNode& Node);
 
+	// Same as above, but writes to caller's container so that it doesn't allocate when called in a loop. OutNeighbours is cleared first.
+	// This is what pathfinding uses, keep the container alive between calls.
+	// If the leaf graph is built, neighbours are read from it instead of the octree.
+	void FindFreeNeighbourLeafs(const CPathAStarNode& Node, std::vector<CPathAStarNode>& OutNeighbours);
+
 	// Returns a parent of tree with given TreeID or null if TreeID has depth of 0
-	FORCEINLINE CPathOctree* GetParentTree(uint32 TreeId)
+	FORCEINLINE CPathOctree* GetParentTree(CPathTreeID TreeId)
 	{
 		uint32 Depth = ExtractDepth(TreeId);
 		if (Depth)
@@ -286,7 +545,7 @@ public:
 	};
 
 	// Returns world location of a voxel at this TreeID. This returns CENTER of the voxel
-	FORCEINLINE FVector WorldLocationFromTreeID(uint32 TreeID) const
+	FORCEINLINE FVector WorldLocationFromTreeID(CPathTreeID TreeID) const
 	{
 		uint32 OuterIndex = ExtractOuterIndex(TreeID);
 		uint32 Depth = ExtractDepth(TreeID);
@@ -303,87 +562,102 @@ public:
 
 	FORCEINLINE FVector LocalCoordsInt3FromOuterIndex(uint32 OuterIndex) const
 	{
+		if (MortonOrder)
+		{
+			// Deinterleaving one byte of the index at a time
+			uint32 XYZ[3];
+			for (int Axis = 0; Axis < 3; Axis++)
+			{
+				const uint32* CoordByByte = LookupTable_CoordByMortonByte[Axis].data();
+				XYZ[Axis] = CoordByByte[OuterIndex & 0xFF]
+					| CoordByByte[256 | ((OuterIndex >> 8) & 0xFF)]
+					| CoordByByte[512 | ((OuterIndex >> 16) & 0xFF)]
+					| CoordByByte[768 | (OuterIndex >> 24)];
+			}
+			return FVector(XYZ[0], XYZ[1], XYZ[2]);
+		}
+
 		uint32 X = OuterIndex / (NodeCount[1] * NodeCount[2]);
 		OuterIndex -= X * NodeCount[1] * NodeCount[2];
 		return FVector(X, OuterIndex / NodeCount[2], OuterIndex % NodeCount[2]);
 	};
 
+	// Multiplies (or interleaves, with MortonOrder) local integer coordinates into index
+	FORCEINLINE uint32 LocalCoordsInt3ToIndex(FVector V) const
+	{
+		uint32 X = (uint32)V.X, Y = (uint32)V.Y, Z = (uint32)V.Z;
+		if (MortonOrder)
+		{
+			return LookupTable_MortonByCoord[0][X] | LookupTable_MortonByCoord[1][Y] | LookupTable_MortonByCoord[2][Z];
+		}
+		return X * (NodeCount[1] * NodeCount[2]) + Y * NodeCount[2] + Z;
+	}
+
 	// Creates TreeID for AsyncOverlapByChannel
-	FORCEINLINE uint32 CreateTreeID(uint32 Index, uint32 Depth) const
+	FORCEINLINE CPathTreeID CreateTreeID(uint32 Index, uint32 Depth) const
 	{
 		checkf(Depth <= MAX_DEPTH, TEXT("CPATH - Graph Generation:::DEPTH can be up to MAX_DEPTH"));
-		Index |= Depth << DEPTH_0_BITS;
-		return Index;
+		return (CPathTreeID)Index | ((CPathTreeID)Depth << DEPTH_0_BITS);
 	}
 
-	// Extracts Octrees array index from TreeID
-	FORCEINLINE uint32 ExtractOuterIndex(uint32 TreeID) const
+	// Extracts outer index from TreeID
+	FORCEINLINE uint32 ExtractOuterIndex(CPathTreeID TreeID) const
 	{
-		return TreeID & DEPTH_0_MASK;
+		return (uint32)(TreeID & DEPTH_0_MASK);
 	}
 
 	// Replaces Depth in the TreeID with NewDepth
-	FORCEINLINE void ReplaceDepth(uint32& TreeID, uint32 NewDepth)
+	FORCEINLINE void ReplaceDepth(CPathTreeID& TreeID, uint32 NewDepth)
 	{
 		checkf(NewDepth <= MAX_DEPTH, TEXT("CPATH - Graph Generation:::DEPTH can be up to MAX_DEPTH"));
 		TreeID &= ~DEPTH_MASK;
-		TreeID |= NewDepth << DEPTH_0_BITS;
+		TreeID |= (CPathTreeID)NewDepth << DEPTH_0_BITS;
 	}
 
 	// Extracts depth from TreeID
-	FORCEINLINE uint32 ExtractDepth(uint32 TreeID) const
+	FORCEINLINE uint32 ExtractDepth(CPathTreeID TreeID) const
 	{
-		return (TreeID & DEPTH_MASK) >> DEPTH_0_BITS;
+		return (uint32)((TreeID & DEPTH_MASK) >> DEPTH_0_BITS);
 	}
 
 	// Returns a number from  0 to 7 - a child index at requested Depth
-	FORCEINLINE uint32 ExtractChildIndex(uint32 TreeID, uint32 Depth) const
+	FORCEINLINE uint32 ExtractChildIndex(CPathTreeID TreeID, uint32 Depth) const
 	{
 		checkf(Depth <= MAX_DEPTH && Depth > 0, TEXT("CPATH - Graph Generation:::DEPTH can be up to MAX_DEPTH"));
-		uint32 DepthOffset = (Depth - 1) * 3 + DEPTH_0_BITS + 2;
-		uint32 Mask = 0x00000007 << DepthOffset;
-		return (TreeID & Mask) >> DepthOffset;
+		uint32 DepthOffset = (Depth - 1) * 3 + CHILD_INDEX_OFFSET;
+		return (uint32)(TreeID >> DepthOffset) & 0x00000007;
 	}
 
 	// This assumes that child index at Depth is 000, if its not use ReplaceChildIndex
-	FORCEINLINE void AddChildIndex(uint32& TreeID, uint32 Depth, uint32 ChildIndex)
+	FORCEINLINE void AddChildIndex(CPathTreeID& TreeID, uint32 Depth, uint32 ChildIndex)
 	{
 		checkf(Depth <= MAX_DEPTH && Depth > 0, TEXT("CPATH - Graph Generation:::DEPTH can be up to MAX_DEPTH"));
 		checkf(ChildIndex < 8, TEXT("CPATH - Graph Generation:::Child Index can be up to 7"));
-		ChildIndex <<= (Depth - 1) * 3 + DEPTH_0_BITS + 2;
-		TreeID |= ChildIndex;
+		TreeID |= (CPathTreeID)ChildIndex << ((Depth - 1) * 3 + CHILD_INDEX_OFFSET);
 	};
 
 	// Replaces child index at given depth
-	FORCEINLINE void ReplaceChildIndex(uint32& TreeID, uint32 Depth, uint32 ChildIndex)
+	FORCEINLINE void ReplaceChildIndex(CPathTreeID& TreeID, uint32 Depth, uint32 ChildIndex)
 	{
 		checkf(Depth <= MAX_DEPTH && Depth > 0, TEXT("CPATH - Graph Generation:::DEPTH can be up to MAX_DEPTH"));
 		checkf(ChildIndex < 8, TEXT("CPATH - Graph Generation:::Child Index can be up to 7"));
-		uint32 DepthOffset = (Depth - 1) * 3 + DEPTH_0_BITS + 2;
+		uint32 DepthOffset = (Depth - 1) * 3 + CHILD_INDEX_OFFSET;
 
 		// Clearing previous child index
-		TreeID &= ~(0x00000007 << DepthOffset);
-		ChildIndex <<= DepthOffset;
-		TreeID |= ChildIndex;
+		TreeID &= ~((CPathTreeID)0x00000007 << DepthOffset);
+		TreeID |= (CPathTreeID)ChildIndex << DepthOffset;
 	}
 
 
 	// Replaces child index at given depth and also replaces depth to the same one
-	FORCEINLINE void ReplaceChildIndexAndDepth(uint32& TreeID, uint32 Depth, uint32 ChildIndex)
+	FORCEINLINE void ReplaceChildIndexAndDepth(CPathTreeID& TreeID, uint32 Depth, uint32 ChildIndex)
 	{
-		checkf(Depth <= MAX_DEPTH && Depth > 0, TEXT("CPATH - Graph Generation:::DEPTH can be up to MAX_DEPTH"));
-		checkf(ChildIndex < 8, TEXT("CPATH - Graph Generation:::Child Index can be up to 7"));
-		uint32 DepthOffset = (Depth - 1) * 3 + DEPTH_0_BITS + 2;
-
-		// Clearing previous child index
-		TreeID &= ~(0x00000007 << DepthOffset);
-		ChildIndex <<= DepthOffset;
-		TreeID |= ChildIndex;
+		ReplaceChildIndex(TreeID, Depth, ChildIndex);
 		ReplaceDepth(TreeID, Depth);
 	}
 
 	// Traverses the tree downwards and adds every tree to the container
-	void GetAllSubtrees(uint32 TreeID, std::vector<uint32>& Container);
+	void GetAllSubtrees(CPathTreeID TreeID, std::vector<CPathTreeID>& Container);
 
 	// Volume is not safe to access as long as this is not 0, pathfinders should wait till this is 0
 	std::atomic_int GeneratorsRunning = 0;
@@ -398,6 +672,10 @@ public:
 	// This is for other threads to check if graph is accessible
 	std::atomic_bool InitialGenerationCompleteAtom = false;
 
+	// Incremented every time dynamic obstacles regenerate part of the volume.
+	// Lets searches that are paused between slices know that nodes they hold may be outdated.
+	std::atomic<uint32> RegenerationCount = 0;
+
 	// This is filled by DynamicObstacle component
 	std::set<class UCPathDynamicObstacle*> TrackedDynamicObstacles;
 
@@ -412,7 +690,7 @@ public:
 	// Draws the voxel, this takes all the drawing options into condition. If Duraiton is below 0, it never disappears. 
 	// If Color = green, free trees are green and occupied are red.
 	// Returns true if drawn, false otherwise
-	bool DrawDebugVoxel(uint32 TreeID, bool DrawIfNotLeaf = true, float Duration = 0, FColor Color = FColor::Green, CPathVoxelDrawData* OutDrawData = nullptr);
+	bool DrawDebugVoxel(CPathTreeID TreeID, bool DrawIfNotLeaf = true, float Duration = 0, FColor Color = FColor::Green, CPathVoxelDrawData* OutDrawData = nullptr);
 	void DrawDebugVoxel(const CPathVoxelDrawData& DrawData, float Duration) const;
 
 protected:
@@ -424,17 +702,11 @@ protected:
 		return LocalCoordsInt3ToIndex(XYZ);
 	}
 
-	// Multiplies local integer coordinates into index
-	FORCEINLINE float LocalCoordsInt3ToIndex(FVector V) const
-	{
-		return (V.X * (NodeCount[1] * NodeCount[2])) + (V.Y * NodeCount[2]) + V.Z;
-	}
-
 	// Returns the X Y and Z relative to StartPosition and divided by VoxelSize. Multiply them to get the index. NO BOUNDS CHECK
 	FVector WorldLocationToLocalCoordsInt3(FVector WorldLocation) const;
 
 	// Returns world location of a tree at depth 0. Extracts only outer index from TreeID
-	FORCEINLINE FVector GetOuterTreeWorldLocation(uint32 TreeID) const
+	FORCEINLINE FVector GetOuterTreeWorldLocation(CPathTreeID TreeID) const
 	{
 		FVector LocalCoords = LocalCoordsInt3FromOuterIndex(ExtractOuterIndex(TreeID));
 		LocalCoords *= GetVoxelSizeByDepth(0);
@@ -445,47 +717,84 @@ protected:
 	bool IsInBounds(FVector LocalCoordsInt3) const;
 
 	// Helper function for 'FindLeafByWorldLocation'. Relative location is location relative to the middle of CurrentTree
-	CPathOctree* FindLeafRecursive(FVector RelativeLocation, uint32& TreeID, uint32 CurrentDepth, CPathOctree* CurrentTree);
+	CPathOctree* FindLeafRecursive(FVector RelativeLocation, CPathTreeID& TreeID, uint32 CurrentDepth, CPathOctree* CurrentTree);
 
 	// Returns IDs of all free leafs on chosen side of a tree. Sides are indexed in the same way as neighbours, and adds them to passed Vector.
 	// ASSUMES THAT PASSED TREE HAS CHILDREN
-	void FindLeafsOnSide(uint32 TreeID, ENeighbourDirection Side, std::vector<uint32>* Vector, bool MustBeFree = true);
+	void FindLeafsOnSide(CPathTreeID TreeID, ENeighbourDirection Side, std::vector<CPathTreeID>* Vector, bool MustBeFree = true);
 
 	// Same as above, but skips the part of getting a tree by TreeID so its faster
-	void FindLeafsOnSide(CPathOctree* Tree, uint32 TreeID, ENeighbourDirection Side, std::vector<uint32>* Vector, bool MustBeFree = true);
+	void FindLeafsOnSide(CPathOctree* Tree, CPathTreeID TreeID, ENeighbourDirection Side, std::vector<CPathTreeID>* Vector, bool MustBeFree = true);
 
 	// Same as above, but wrapped in CPathAStarNode
-	void FindLeafsOnSide(CPathOctree* Tree, uint32 TreeID, ENeighbourDirection Side, std::vector<CPathAStarNode>* Vector, bool MustBeFree = true);
+	void FindLeafsOnSide(CPathOctree* Tree, CPathTreeID TreeID, ENeighbourDirection Side, std::vector<CPathAStarNode>* Vector, bool MustBeFree = true);
 
 	// Internal function used in GetAllSubtrees
-	void GetAllSubtreesRec(uint32 TreeID, CPathOctree* Tree, std::vector<uint32>& Container, uint32 Depth);
+	void GetAllSubtreesRec(CPathTreeID TreeID, CPathOctree* Tree, std::vector<CPathTreeID>& Container, uint32 Depth);
 
 
 	// -------- GENERATION -----
 	FTimerHandle GenerationTimerHandle;
 
-	std::list<std::unique_ptr<FCPathAsyncVolumeGenerator>> GeneratorThreads;
+	// Job given to CPathGeneratorPool, either initial generation or the last dynamic obstacles update. Cancelled in EndPlay.
+	std::shared_ptr<CPathGenerationJob> GenerationJob;
+
+	// Increments GeneratorsRunning and submits the job
+	void StartGenerationJob(std::shared_ptr<CPathGenerationJob> Job);
+
+	// Called by the pool worker that finished the job, before the job is marked Finished
+	void OnGenerationJobFinished(const std::shared_ptr<CPathGenerationJob>& Job);
+
+	// Sets up everything generators need (NodeCount, trace shapes, BrickMap, Occupancy), doesn't start generating
+	void InitGeneration();
+
+	// Collapses bricks and builds data derived from the octree (DAG, leaf graph, ...) after initial generation or loading baked data.
+	// Called by the last worker of the initial job, or on the game thread for baked data.
+	void BuildDerivedData();
+
+	// Lets pathfinders in and starts the dynamic obstacles timer. Game thread only, after BuildDerivedData.
+	void FinishInitialGeneration();
+
+	// Loads BakedData into the empty octree, returns false if it's stale or doesn't fit the volume anymore
+	bool LoadBakedGraph();
 
-	// Garbage collection
-	void CleanFinishedGenerators();
+	void SaveOctree(FArchive& Ar);
 
-	// Checking if initial generation has finished
-	void InitialGenerationUpdate();
+	bool LoadOctree(FArchive& Ar);
+
+	// Which trees have children, children are allocated when loading
+	void SerializeTreeStructure(FArchive& Ar, CPathOctree* Tree, uint32 Depth, CPathOctreeAllocator::LocalCache& Cache);
 
 	// Checking if there are any trees to regenerate from dynamic obstacles
 	void GenerationUpdate();
 
-	std::set<int32> TreesToRegenerate;
+	std::set<uint32> TreesToRegenerate;
 
 	// This is so that when an actor moves, the previous space it was in needs to be regenerated as well
-	std::set<int32> TreesToRegeneratePreviousUpdate;
+	std::set<uint32> TreesToRegeneratePreviousUpdate;
 
-	// This is set in GenerateGraph() using a formula that estimates total voxel count
-	int OuterIndexesPerThread;
+	// Gives a homogeneous brick its own trees and occupancy, set to what its state was. Generators call this before writing to a tree.
+	void MaterializeBrick(uint32 BrickIndex);
+
+	// Turns a Mixed brick back into a single state, if all its trees are childless leafs that are all free or all occupied, without user data.
+	// Nothing else can use the volume while this runs.
+	void CollapseBrick(uint32 BrickIndex);
 
-	bool ThreadIDs[64];
+	// Fills outer indexes of the brick's trees by their index in the brick, InvalidOuterIndex for those outside of the volume. Returns how many are inside.
+	uint32 GetBrickOuterIndexes(uint32 BrickIndex, uint32 OutOuterIndexes[CPathBrickMap::TreesPerBrick]) const;
 
-	uint32 GetFreeThreadID() const;
+	// Never a real index, outer indexes have at most 31 bits (DEPTH_0_BITS)
+	static constexpr uint32 InvalidOuterIndex = 0xFFFFFFFF;
+
+	// World space box of the brick's trees
+	void GetBrickBounds(uint32 BrickIndex, FVector& OutCenter, FVector& OutExtent) const;
+
+	// Updates data derived from the octree (like the leaf graph) for TreesToRegenerate.
+	// Called by the last worker of the job, before it lets pathfinders back into the volume.
+	void OnTreesRegenerated();
+
+	// This is set in GenerateGraph() using a formula that estimates total voxel count
+	int OuterIndexesPerThread;
 
 	void PerformRandomBenchmark(uint32 UserData = 0, float TimeLimit = 0.2);
 
@@ -505,6 +814,17 @@ protected:
 	// Set in begin play
 	float LookupTable_VoxelSizeByDepth[MAX_DEPTH + 1];
 
+	// Only with MortonOrder, set in GenerateGraph. Index of an outer tree is LookupTable_MortonByCoord[0][X] | [1][Y] | [2][Z]
+	std::vector<uint32> LookupTable_MortonByCoord[3];
+
+	// Only with MortonOrder, set in GenerateGraph. [Axis][Byte of the index * 256 + Value of the byte] - bits of the coordinate that the byte holds
+	std::vector<uint32> LookupTable_CoordByMortonByte[3];
+
+	// Fills the Morton lookup tables and returns the outer tree count, with padding
+	uint32 InitMortonLookupTables();
+
+	uint32 OuterTreeCount = 0;
+
 
 	// -------- DEBUGGING -----
 	std::vector<CPathVoxelDrawData> PreviousDrawAroundLocationData;
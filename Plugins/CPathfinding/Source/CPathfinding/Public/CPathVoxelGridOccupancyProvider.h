@@ -0,0 +1,64 @@
+// Copyright Dominik Trautman. Published in 2022. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CPathOccupancyProvider.h"
+#include "Engine/EngineTypes.h"
+#include <vector>
+#include "CPathVoxelGridOccupancyProvider.generated.h"
+
+/**
+ *
+ */
+
+
+// Occupancy from a dense voxel grid imported from a file, for worlds described by data instead of colliders.
+// File layout (little endian):
+//   uint32 magic 'CPVG', int32 version 1,
+//   float origin X, Y, Z (world location of the grid's lowest corner), float cell size,
+//   int32 cell count X, Y, Z,
+//   then one bit per cell (1 = occupied), X major, least significant bit first.
+// A box is empty if none of the cells it touches are occupied, counted in constant time from a summed volume table (4 bytes per cell).
+UCLASS(meta = (DisplayName = "Voxel Grid File"))
+class CPATHFINDING_API UCPathVoxelGridOccupancyProvider : public UCPathOccupancyProvider
+{
+	GENERATED_BODY()
+
+public:
+
+	// Relative paths start in the project directory
+	UPROPERTY(EditAnywhere, Category = "CPath", meta = (FilePathFilter = "Voxel grid (*.cpvg)|*.cpvg"))
+		FFilePath VoxelFile;
+
+	// Whether space outside of the grid is occupied
+	UPROPERTY(EditAnywhere, Category = "CPath")
+		bool OutsideIsOccupied = false;
+
+	virtual void BeginGeneration(ACPathVolume* Volume) override;
+
+	virtual bool IsBoxEmpty(const ACPathVolume* Volume, FVector Center, FVector Extent) const override;
+
+	virtual uint32 GetBakeHash() const override;
+
+	static constexpr uint32 FileMagic = 0x47565043; // "CPVG"
+	static constexpr int32 FileVersion = 1;
+
+private:
+	FVector Origin = FVector::ZeroVector;
+	float CellSize = 1;
+	int32 CellCount[3] = { 0, 0, 0 };
+
+	// Occupied cells in [0, X) x [0, Y) x [0, Z), (CellCount + 1) per axis
+	std::vector<uint32> OccupiedSums;
+
+	FString GetFullPath() const;
+
+	// Clears the grid, everything is outside then
+	void LoadFailed(const FString& Reason);
+
+	FORCEINLINE uint32 GetSum(int32 X, int32 Y, int32 Z) const
+	{
+		return OccupiedSums[((size_t)X * (CellCount[1] + 1) + Y) * (CellCount[2] + 1) + Z];
+	}
+};
@@ -7,7 +7,11 @@
 #include "HAL/RunnableThread.h"
 #include "Containers/Queue.h"
 #include "CPathNode.h"
+#include "CPathSearchContext.h"
 #include <atomic>
+#include <deque>
+#include <vector>
+#include <memory>
 #include "HAL/Event.h"
 
 
@@ -68,6 +72,25 @@ private:
 
 	FString ThreadName;
 
+	// A request with SliceTimeLimit, which is searched for in turns with other such requests
+	struct FSlicedSearch
+	{
+		std::unique_ptr<CPathSearchContext> Context;
+		FCPathResult* Result = nullptr;
+	};
+
+	// Round robin queue, the front one gets the next slice
+	std::deque<FSlicedSearch> SlicedSearches;
+
+	// Contexts of finished sliced searches, so that new ones don't have to allocate
+	std::vector<std::unique_ptr<CPathSearchContext>> FreeContexts;
+
+	// Searches for the whole request at once
+	void ProcessRequest(FCPathRequest& Request);
+
+	// Runs one slice of the search. Returns true if the search is over (result submitted or dropped)
+	bool ProcessSlice(FSlicedSearch& Search);
+
 	void SubmitResult(FCPathResult* Result, PathResultDelegate Delegate);
 
 	// Returns false if volume is not valid before/after waiting
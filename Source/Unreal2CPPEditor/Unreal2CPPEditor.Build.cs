@@ -10,7 +10,7 @@ public class Unreal2CPPEditor : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "DeveloperSettings" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] { "Unreal2CPP", "UnrealEd" });
+		PrivateDependencyModuleNames.AddRange(new string[] { "Unreal2CPP", "UnrealEd", "CPathfinding" });
 
 		// Uncomment if you are using Slate UI
 		PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
@@ -2,15 +2,52 @@
 
 #include "Unreal2CPPEditor.h"
 #include "Modules/ModuleManager.h"
+#include "Editor.h"
+#include "EngineUtils.h"
+#include "CPathVolume.h"
 
 IMPLEMENT_MODULE(FIUnreal2CPPEditorModule, Unreal2CPPEditor);
 
+static void BakeCPathVolumes()
+{
+	UWorld* World = GEditor ? GEditor->GetEditorWorldContext().World() : nullptr;
+	if (!World)
+		return;
+
+	int32 BakedCount = 0;
+	for (TActorIterator<ACPathVolume> Volume(World); Volume; ++Volume)
+	{
+		if (Volume->BakeGraph())
+		{
+			Volume->MarkPackageDirty();
+			BakedCount++;
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("CPath.BakeVolumes - couldn't bake %s"), *Volume->GetName());
+		}
+	}
+	UE_LOG(LogTemp, Warning, TEXT("CPath.BakeVolumes - baked %d volumes, save the level to keep them"), BakedCount);
+}
+
 void FIUnreal2CPPEditorModule::StartupModule()
 {
 	UE_LOG(LogTemp, Warning, TEXT("Unreal2CPPEditorModule StartupModule() called"));
+
+	BakeCPathVolumesCommand = IConsoleManager::Get().RegisterConsoleCommand(
+		TEXT("CPath.BakeVolumes"),
+		TEXT("Generates octrees of all CPathVolumes in the edited level and saves them with the level, so they load instead of generating on BeginPlay."),
+		FConsoleCommandDelegate::CreateStatic(&BakeCPathVolumes),
+		ECVF_Default);
 }
 
 void FIUnreal2CPPEditorModule::ShutdownModule()
 {
 	UE_LOG(LogTemp, Warning, TEXT("Unreal2CPPEditorModule ShutdownModule() called"));
+
+	if (BakeCPathVolumesCommand)
+	{
+		IConsoleManager::Get().UnregisterConsoleObject(BakeCPathVolumesCommand);
+		BakeCPathVolumesCommand = nullptr;
+	}
 }
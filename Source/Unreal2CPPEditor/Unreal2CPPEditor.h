@@ -3,6 +3,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
 
 class FIUnreal2CPPEditorModule : public IModuleInterface
 {
@@ -11,4 +12,8 @@ public:
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
 	// End IModuleInterface implementation
+
+private:
+	// CPath.BakeVolumes, bakes octrees of all CPathVolumes in the level open in the editor
+	IConsoleObject* BakeCPathVolumesCommand = nullptr;
 };
\ No newline at end of file